@@ -1,5 +1,12 @@
+#include <chrono>
+#include <csignal>
+#include <filesystem>
+#include <memory>
+#include <optional>
+#include <thread>
 #include <string>
 #include <string_view>
+#include <vector>
 #include <iostream>
 #include <format>
 #include "SDL.h"
@@ -7,6 +14,21 @@
 #include "memory/Memory.h"
 #include "display/Display.h"
 #include "keyboard/Keyboard.h"
+#include "index/RomIndex.h"
+#include "io/MappedFile.h"
+#include "analysis/Disassembler.h"
+#include "machine/QuirkDetector.h"
+#include "machine/RomOptions.h"
+#include "capture/Capture.h"
+#include "grid/Grid.h"
+#include "terminal/Terminal.h"
+#include "link/Link.h"
+#include "link/Rollback.h"
+#include "telemetry/Telemetry.h"
+#include "log/Log.h"
+
+// set by Ctrl-C while drawing to the terminal
+volatile std::sig_atomic_t interrupted {0};
 
 bool startup(Display& display, bool romLoaded)
 {
@@ -16,7 +38,7 @@ bool startup(Display& display, bool romLoaded)
     }
 
     if (SDL_Init(SDL_INIT_VIDEO) < 0) {
-        std::cerr << std::format("SDL_Error: {:s}\n", SDL_GetError());
+        Log::global().write(Log::Level::error, "display", "sdl_error", "{:s}", SDL_GetError());
         return false;
     }
 
@@ -28,6 +50,93 @@ bool startup(Display& display, bool romLoaded)
     return true;
 }
 
+// Loads rom, applying the quirks the index suggests for it and, with autoQuirks, the ones detected for it.
+bool loadRom(const std::string& rom, Memory& memory, Interpreter& interpreter, RomIndex& index,
+             const std::filesystem::path& indexPath, bool autoQuirks, double cycles_per_frame)
+{
+    // rom is a path, or the hash (or a unique prefix of it) of a rom in the index
+    std::filesystem::path romPath;
+    if (std::filesystem::is_regular_file(rom)) {
+        romPath = rom;
+    } else if (!index.entries().empty() or index.load(indexPath)) {
+        if (const RomEntry* entry {index.find(rom)}) {
+            romPath = entry->path;
+            if (entry->platform != "chip8")
+                interpreter.setMode(entry->platform);
+            interpreter.setQuirks(entry->quirks);
+            Log::global().write(Log::Level::info, "loader", "resolved", "resolved {:s} to '{:s}' ({:s})", rom,
+                                entry->path.string(), entry->platform);
+        }
+    }
+    if (romPath.empty() or !memory.load(romPath.string())) {
+        Log::global().write(Log::Level::error, "loader", "load_failed", "failed to load rom '{:s}', it may be missing or too large", rom);
+        return false;
+    }
+
+    if (autoQuirks) {
+        MappedFile file {romPath};
+        std::string platform {Disassembler {file.bytes()}.platform()};
+        QuirkDetector detector;
+        detector.cyclesPerFrame = static_cast<int>(cycles_per_frame);
+        if (platform != "chip8")
+            detector.mode = platform;
+        if (!detector.mode.empty())
+            interpreter.setMode(detector.mode);
+
+        auto start {std::chrono::steady_clock::now()};
+        std::string best {detector.detect(file.bytes(), RomIndex::suggestedQuirks(platform))};
+        auto elapsed {std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start)};
+        interpreter.setQuirks(best);
+        Log::global().write(Log::Level::info, "loader", "quirks_detected", "detected quirks '{:s}' in {:d}ms", best, elapsed.count());
+
+        if (index.entries().empty())
+            index.load(indexPath);
+        index.update({memory.romHash(), file.bytes().size(), platform, best, std::filesystem::absolute(romPath)});
+        if (!index.save(indexPath))
+            Log::global().write(Log::Level::warning, "loader", "index_not_saved", "failed to update rom index '{:s}'", indexPath.string());
+    }
+    return true;
+}
+
+// Runs start with the other player on link at 60 frames per second until either of them quits, see Rollback.
+void play(Link& link, const Machine& start, Display& display, int cyclesPerFrame)
+{
+    Rollback rollback {start, cyclesPerFrame};
+    unsigned long long waited {0};
+    auto next {std::chrono::steady_clock::now()};
+    bool quit {false};
+    while (!quit and link.isOpen()) {
+        SDL_Event e;
+        while (SDL_PollEvent(&e) != 0) {
+            if (e.type == SDL_QUIT)
+                quit = true;
+        }
+
+        while (std::optional<Link::Message> message {link.receive()})
+            rollback.confirm(message->frame, message->keys);
+        if (rollback.canAdvance()) {
+            std::uint16_t keys {Keyboard::hostMask()};
+            link.send({rollback.frame(), keys});
+            rollback.advance(keys);
+            display.mirror(rollback.machine().display);
+            display.draw();
+        } else {
+            ++waited; // the other player is too far behind to guess any further
+        }
+
+        next += std::chrono::microseconds {16'667};
+        std::this_thread::sleep_until(next);
+    }
+
+    const Rollback::Stats& stats {rollback.stats()};
+    auto us {[](std::chrono::nanoseconds t) { return std::chrono::duration<double, std::micro>(t).count(); }};
+    std::cout << std::format("Link: {:d} frames, {:d} rollbacks ({:.1f}% of frames), {:d} frames run again, "
+                             "{:.1f}us per rollback, {:.1f}us worst, {:d} frames waited for the other player\n",
+                             stats.frames, stats.rollbacks, stats.frames == 0 ? 0.0 : 100.0 * stats.rollbacks / stats.frames,
+                             stats.resimulated, stats.rollbacks == 0 ? 0.0 : us(stats.cost) / stats.rollbacks,
+                             us(stats.worst), waited);
+}
+
 int main(int argc, char** argv) {
     SDL_LogSetPriority(SDL_LOG_CATEGORY_APPLICATION, SDL_LOG_PRIORITY_INFO);
 
@@ -39,54 +148,220 @@ int main(int argc, char** argv) {
 
     // settings
     double cycles_per_frame {20};
+    bool fixedCycles {false}; // -cycles_per_frame was given
     bool debugging {false};
     bool romLoaded {false};
-    std::string mode;
+    bool autoQuirks {false};
+    bool verifyHash {false};
+    bool headless {false};
+    bool terminal {false};
+    int frames {600};
+    bool checked {false};
+    int gridColumns {0};
+    int gridRows {0};
+    std::filesystem::path capturePath;
+    std::filesystem::path linkPath;
+    std::filesystem::path telemetryPath;
+    Telemetry telemetry;
+    bool overlay {false};
+    std::vector<RomOptions> roms;
+    RomOptions shared; // -quirk, --mode and -timing given before the first -rom apply to every rom
+    std::filesystem::path indexPath {RomIndex::defaultPath()};
 
     // command line parsing
     using namespace std::string_view_literals;
     for (int i {1}; i < argc; ++i) {
         bool hasNext {i + 1 != argc};
         if (argv[i] == "-rom"sv and hasNext) {
-            romLoaded = memory.load(argv[++i]);
+            roms.push_back({.rom = argv[++i]});
+        } else if (argv[i] == "-index"sv and hasNext) {
+            indexPath = argv[++i];
         } else if (argv[i] == "--mode"sv and hasNext) {
-            mode = argv[++i];
+            (roms.empty() ? shared : roms.back()).mode = argv[++i];
         } else if (argv[i] == "-quirk"sv and hasNext) {
-            if (!interpreter.setQuirk(argv[++i]))
-                std::cerr << std::format("error: failed to read interpreter '-quirk {:s}' option.\n", argv[i]);
+            (roms.empty() ? shared : roms.back()).quirks.emplace_back(argv[++i]);
+        } else if (argv[i] == "-timing"sv and hasNext) {
+            (roms.empty() ? shared : roms.back()).timing = argv[++i];
         } else if (argv[i] == "-cycles_per_frame"sv and hasNext) {
             try {
                 std::string n {argv[++i]};
                 cycles_per_frame = std::stoi(n);
+                fixedCycles = true;
             } catch (std::exception& e) {
                 std::cerr << std::format("error: failed to read integer for '-cycles_per_frame' option, using default={:f}.\n", cycles_per_frame);
             }
+        } else if (argv[i] == "-break"sv and hasNext) {
+            try {
+                interpreter.setBreakpoint(static_cast<std::uint16_t>(std::stoul(argv[++i], nullptr, 16)));
+            } catch (std::exception& e) {
+                std::cerr << std::format("error: failed to read address for '-break' option.\n");
+            }
         } else if (argv[i] == "-debug"sv) {
             debugging = true;
+        } else if (argv[i] == "-checked"sv) {
+            checked = true;
+        } else if (argv[i] == "-auto_quirks"sv) {
+            autoQuirks = true;
+        } else if (argv[i] == "-verify_hash"sv) {
+            verifyHash = true;
+        } else if (argv[i] == "-grid"sv and hasNext) {
+            try {
+                // columns x rows
+                std::string size {argv[++i]};
+                std::size_t x {size.find('x')};
+                gridColumns = std::max(std::stoi(size.substr(0, x)), 1);
+                gridRows = std::max(std::stoi(size.substr(x + 1)), 1);
+            } catch (std::exception& e) {
+                std::cerr << std::format("error: failed to read size for '-grid' option, expected columns x rows like 2x2.\n");
+            }
+        } else if (argv[i] == "-telemetry"sv and hasNext) {
+            telemetryPath = argv[++i];
+            telemetry.enabled = true;
+        } else if (argv[i] == "-overlay"sv) {
+            overlay = true;
+            telemetry.enabled = true;
+        } else if (argv[i] == "-link"sv and hasNext) {
+            linkPath = argv[++i];
+        } else if (argv[i] == "-log"sv and hasNext) {
+            if (!Log::global().open(argv[++i]))
+                std::cerr << std::format("error: failed to open '{:s}' for logging, logging to stderr.\n", argv[i]);
+        } else if (argv[i] == "-capture"sv and hasNext) {
+            capturePath = argv[++i];
+        } else if (argv[i] == "-headless"sv) {
+            headless = true;
+        } else if (argv[i] == "-terminal"sv) {
+            terminal = true;
+        } else if (argv[i] == "-frames"sv and hasNext) {
+            try {
+                frames = std::stoi(argv[++i]);
+            } catch (std::exception& e) {
+                std::cerr << std::format("error: failed to read integer for '-frames' option, using default={:d}.\n", frames);
+            }
         } else {
             std::cerr << std::format("error: unrecognized command line argument '{:s}'.\n", argv[i]);
         }
     }
 
-    if (!mode.empty()) {
-        if (interpreter.setMode(mode))
-            std::cout << std::format("Running emulator in '{:s}' mode!\n", mode);
-        else
-            std::cerr << "error: failed to read interpreter '-mode' option, using default=chip8.\n";
+    interpreter.setChecked(checked);
+    RomIndex index;
+    if (gridColumns != 0) {
+        Grid grid {gridColumns, gridRows};
+        bool loaded {!roms.empty()};
+        for (const RomOptions& options : roms) {
+            Machine* machine {grid.add()};
+            if (!machine) {
+                std::cerr << std::format("error: {:d} roms don't fit in a {:d}x{:d} grid, ignoring the rest.\n",
+                                         roms.size(), gridColumns, gridRows);
+                break;
+            }
+            machine->interpreter.setChecked(checked);
+            loaded = loadRom(options.rom, machine->memory, machine->interpreter, index, indexPath, autoQuirks, cycles_per_frame) and loaded;
+            configure(machine->interpreter, shared, options, fixedCycles);
+        }
+        if (!loaded) {
+            std::cerr << "error: no rom specified, exiting...\n";
+            return 1;
+        }
+        if (SDL_Init(SDL_INIT_VIDEO) < 0) {
+            Log::global().write(Log::Level::error, "display", "sdl_error", "{:s}", SDL_GetError());
+            return 1;
+        }
+
+        grid.start(static_cast<int>(cycles_per_frame));
+        grid.show(std::max(1, 1280 / grid.width()));
+        SDL_Quit();
+        return 0;
     }
 
-    // main emulator loop
-    if (startup(display, romLoaded)) {
+    if (!linkPath.empty()) {
+        Machine start;
+        start.interpreter.setChecked(checked);
+        bool loaded {!roms.empty() and loadRom(roms.back().rom, start.memory, start.interpreter, index, indexPath, autoQuirks, cycles_per_frame)};
+        if (!loaded) {
+            std::cerr << "error: no rom specified, exiting...\n";
+            return 1;
+        }
+        configure(start.interpreter, shared, roms.back(), fixedCycles);
+
+        std::cout << std::format("Waiting for the other player on '{:s}'...\n", linkPath.string());
+        Link link {linkPath};
+        if (!link.isOpen()) {
+            std::cerr << std::format("error: failed to link up through '{:s}'.\n", linkPath.string());
+            return 1;
+        }
+        std::cout << std::format("Linked up as player {:d}\n", link.player() + 1);
+        if (startup(display, loaded)) {
+            play(link, start, display, static_cast<int>(cycles_per_frame));
+            display.off();
+        }
+        SDL_Quit();
+        return 0;
+    }
+
+    if (!roms.empty()) {
+        romLoaded = loadRom(roms.back().rom, memory, interpreter, index, indexPath, autoQuirks, cycles_per_frame);
+        configure(interpreter, shared, roms.back(), fixedCycles);
+    }
+
+    std::unique_ptr<Capture> capture;
+    if (!capturePath.empty() and romLoaded) {
+        capture = std::make_unique<Capture>(capturePath);
+        if (capture->isOpen()) {
+            // headless runs as fast as the encoder keeps up instead of dropping frames
+            capture->lossless = headless;
+            interpreter.setCapture(capture.get());
+        } else {
+            std::cerr << std::format("error: failed to open '{:s}' for capturing.\n", capturePath.string());
+        }
+    }
+
+    if ((headless or terminal) and romLoaded) {
+        // No window and no keys. Headless runs -frames frames without waiting between them, the terminal is drawn
+        // to at 60 frames per second until Ctrl-C.
+        std::optional<Terminal> screen;
+        if (terminal) {
+            screen.emplace(stdout);
+            std::signal(SIGINT, [](int) { interrupted = 1; });
+        }
+        auto next {std::chrono::steady_clock::now()};
+        int budget {interpreter.frameBudget(static_cast<int>(cycles_per_frame))};
+        for (int f {0}; (!headless or f != frames) and !interrupted; ++f) {
+            for (int cycles {0}; cycles < budget;) {
+                Interpreter::Run run {interpreter.run(budget - cycles)};
+                cycles += run.cost;
+                if (run.stop == Interpreter::Stop::keyWait or run.stop == Interpreter::Stop::vblank)
+                    break;
+            }
+            interpreter.endOfFrame();
+
+            if (screen) {
+                screen->draw(display);
+                next += std::chrono::microseconds {16'667};
+                std::this_thread::sleep_until(next);
+            }
+        }
+    } else if (startup(display, romLoaded)) {
+        // main emulator loop
         SDL_Event e;
         bool quit {false};
 
         int frameLength {static_cast<int>(1.0 / 60.0 * 1e3)};
+        int budget {interpreter.frameBudget(static_cast<int>(cycles_per_frame))};
         unsigned long long tick {0};
 
+        if (telemetry.enabled)
+            display.setTelemetry(&telemetry, overlay);
+
         // TO ENTER/EXIT DEBUG MODE PRESS 'I' (QWERTY)
         // TO STEP IN DEBUG MODE PRESS 'O' (QWERTY)
         while (!quit) {
+            telemetry.beginFrame();
             while (SDL_PollEvent(&e) != 0) {
+                if (e.type == SDL_KEYDOWN and !e.key.repeat) {
+                    // events are stamped in milliseconds since SDL started
+                    auto age {std::chrono::milliseconds {SDL_GetTicks() - e.key.timestamp}};
+                    telemetry.input(std::chrono::steady_clock::now() - age);
+                }
                 if (e.type == SDL_QUIT) {
                     quit = true;
                 } else if (e.type == SDL_KEYDOWN && e.key.keysym.scancode == SDL_SCANCODE_I) {
@@ -100,36 +375,77 @@ int main(int argc, char** argv) {
                 }
             }
 
-            for (int cycles {0}; cycles != cycles_per_frame and !quit; ++cycles) {
-                interpreter.cycle();
+            telemetry.mark(Telemetry::events);
+
+            for (int cycles {0}; cycles < budget and !quit and !interpreter.vblank;) {
+                if (!debugging) {
+                    // the whole frame in one call unless something needs attention
+                    Interpreter::Run run {interpreter.run(budget - cycles)};
+                    cycles += run.cost;
+                    tick += run.cycles;
+                    if (run.stop == Interpreter::Stop::keyWait)
+                        break; // keys are only read between frames
+                    if (run.stop == Interpreter::Stop::breakpoint) {
+                        Log::global().write(Log::Level::info, "debugger", "breakpoint", "breakpoint at {:0>4X}", interpreter.pc);
+                        debugging = true;
+                    } else if (run.stop == Interpreter::Stop::outOfBounds) {
+                        // the access itself was already reported by the interpreter
+                        Log::global().write(Log::Level::info, "debugger", "paused", "paused on an out of bounds access at tick {:d}", tick);
+                        debugging = true;
+                    }
+                    continue;
+                }
+
+                // debug mode steps one instruction at a time
+                cycles += interpreter.run(1).cost;
                 ++tick;
+                std::cout << std::format("TICK [{:d}]:\n\tINSTRUCTION EXECUTED: {:0>4X}\n\tPC: {:0>4X} | IR: {:0>4X}:\n",
+                                         tick, interpreter.cir, interpreter.pc, interpreter.i);
+                for (int r{0}; r != 16; ++r)
+                    std::cout << std::format("\tREG V[{:X}]: {:0>2X}\n", r, interpreter.v[r]);
 
-                if (debugging) {
-                    std::cout << std::format("TICK [{:d}]:\n\tINSTRUCTION EXECUTED: {:0>4X}\n\tPC: {:0>4X} | IR: {:0>4X}:\n",
-                                             tick, interpreter.cir, interpreter.pc, interpreter.i);
-                    for (int r{0}; r != 16; ++r)
-                        std::cout << std::format("\tREG V[{:X}]: {:0>2X}\n", r, interpreter.v[r]);
-
-                    while (!quit and debugging) {
-                        SDL_WaitEvent(&e);
-                        if (e.type == SDL_QUIT)
-                            quit = true;
-                        else if (e.type == SDL_KEYDOWN) {
-                            if (e.key.keysym.scancode == SDL_SCANCODE_I)
-                                debugging = false;
-                            else if (e.key.keysym.scancode == SDL_SCANCODE_O)
-                                break;
-                        }
+                while (!quit and debugging) {
+                    SDL_WaitEvent(&e);
+                    if (e.type == SDL_QUIT)
+                        quit = true;
+                    else if (e.type == SDL_KEYDOWN) {
+                        if (e.key.keysym.scancode == SDL_SCANCODE_I)
+                            debugging = false;
+                        else if (e.key.keysym.scancode == SDL_SCANCODE_O)
+                            break;
                     }
                 }
             }
 
+            telemetry.mark(Telemetry::emulation);
             SDL_Delay(frameLength);
+            telemetry.mark(Telemetry::sleep);
             interpreter.endOfFrame();
+            if (overlay and !telemetry.presentedThisFrame())
+                display.draw(); // the bars move even when the screen doesn't
+
+            if (verifyHash and interpreter.stateHash() != interpreter.fullStateHash()) {
+                Log::global().write(Log::Level::error, "emulator", "hash_mismatch", "incremental state hash {:0>16x} != {:0>16x} at tick {:d}",
+                                    interpreter.stateHash(), interpreter.fullStateHash(), tick);
+                verifyHash = false;
+            }
+            telemetry.endFrame();
         }
         display.off();
+
+        if (telemetry.enabled) {
+            std::cout << telemetry.summary();
+            if (!telemetryPath.empty() and !telemetry.writeCsv(telemetryPath))
+                std::cerr << std::format("error: failed to write frame times to '{:s}'.\n", telemetryPath.string());
+        }
     }
 
+    if (capture and capture->isOpen()) {
+        interpreter.setCapture(nullptr);
+        unsigned long long dropped {capture->dropped()};
+        capture.reset(); // waits for the encoder to finish the file
+        std::cout << std::format("Captured to '{:s}', {:d} frames dropped\n", capturePath.string(), dropped);
+    }
     SDL_Quit();
     return 0;
 }
@@ -0,0 +1,422 @@
+#include "Disassembler.h"
+#include <algorithm>
+#include <format>
+
+Disassembler::Disassembler(std::span<const std::uint8_t> rom, const std::string& platform)
+    : rom_(rom.begin(), rom.begin() + std::min<std::size_t>(rom.size(), 0x10000 - origin)),
+      flags_(std::max<std::size_t>(0x1000, origin + rom_.size())),
+      xoChip_{platform.empty() or platform == "xochip"}, megaChip_{platform == "megachip"}
+{
+    analyse_();
+    // 01nn is a SUPER-CHIP machine call unless MEGA-CHIP is on, so start over once megaon turns out to be reachable
+    if (platform.empty() and megaOn_) {
+        megaChip_ = true;
+        std::ranges::fill(flags_, 0);
+        analyse_();
+    }
+    split_();
+}
+
+Disassembler::Disassembler(std::span<const std::uint8_t> rom, std::span<const std::uint8_t> flags)
+    : rom_(rom.begin(), rom.begin() + std::min<std::size_t>(rom.size(), 0x10000 - origin)),
+      flags_(std::max<std::size_t>(0x1000, origin + rom_.size()))
+{
+    std::copy_n(flags.begin(), std::min(flags.size(), flags_.size()), flags_.begin());
+    for (std::uint16_t addr {origin}; inRom_(addr) and !megaChip_; ++addr)
+        megaChip_ = isCode(addr) and isMegaChip(opcode(addr));
+    split_();
+}
+
+void Disassembler::analyse_()
+{
+    std::vector<std::uint16_t> work {origin};
+    flags_[origin] |= leader | target;
+    while (!work.empty()) {
+        std::uint16_t entry {work.back()};
+        work.pop_back();
+        trace_(entry, work);
+    }
+
+    // anything referenced by Annn that turned out to be code stays code
+    for (std::size_t addr {0}; addr != flags_.size(); ++addr) {
+        if (flags_[addr] & (code | operand))
+            flags_[addr] &= ~data;
+    }
+}
+
+const BasicBlock* Disassembler::blockAt(std::uint16_t addr) const
+{
+    auto it {blocks_.upper_bound(addr)};
+    if (it == blocks_.begin())
+        return nullptr;
+    --it;
+    return addr < it->second.end ? &it->second : nullptr;
+}
+
+std::uint16_t Disassembler::opcode(std::uint16_t addr) const
+{
+    if (!inRom_(addr))
+        return 0;
+    return rom_[addr - origin] << 8 | rom_[addr - origin + 1];
+}
+
+bool Disassembler::isSkip(std::uint16_t op, bool xoChip)
+{
+    switch (op >> 12) {
+        case 0x3: case 0x4: return true;
+        case 0x5: return (op & 0xF) == 0 or (!xoChip and ((op & 0xF) == 2 or (op & 0xF) == 3));
+        case 0x9: return (op & 0xF) == 0;
+        case 0xE: return (op & 0xFF) == 0x9E or (op & 0xFF) == 0xA1;
+        default: return false;
+    }
+}
+
+bool Disassembler::isDefined(std::uint16_t op, bool xoChip, bool megaChip)
+{
+    switch (op >> 12) {
+        case 0x0:
+            switch (op & 0xFFF) {
+                case 0x0E0: case 0x0EE: case 0x0FB: case 0x0FC:
+                case 0x0FD: case 0x0FE: case 0x0FF: return true;
+                default: return (op & 0xFF0) == 0x0C0 or (xoChip and (op & 0xFF0) == 0x0D0) or (megaChip and isMegaChip(op));
+            }
+        case 0x5: return (op & 0xF) == 0 or (op & 0xF) == 2 or (op & 0xF) == 3;
+        case 0x9: return (op & 0xF) == 0;
+        case 0x8: return (op & 0xF) <= 7 or (op & 0xF) == 0xE;
+        case 0xE: return (op & 0xFF) == 0x9E or (op & 0xFF) == 0xA1;
+        case 0xF:
+            switch (op & 0xFF) {
+                case 0x07: case 0x0A: case 0x15: case 0x18: case 0x1E: case 0x29:
+                case 0x30: case 0x33: case 0x55: case 0x65: case 0x75: case 0x85: return true;
+                case 0x01: case 0x3A: return xoChip;
+                default: return xoChip and (op == 0xF000 or op == 0xF002);
+            }
+        default: return true;
+    }
+}
+
+bool Disassembler::isSuperChip(std::uint16_t op)
+{
+    switch (op >> 12) {
+        case 0x0: return (op & 0xFFF0) == 0x00C0 or (op >= 0x00FB and op <= 0x00FF);
+        case 0xD: return (op & 0xF) == 0;
+        case 0xF: return (op & 0xFF) == 0x30 or (op & 0xFF) == 0x75 or (op & 0xFF) == 0x85;
+        default: return false;
+    }
+}
+
+bool Disassembler::isXoChip(std::uint16_t op)
+{
+    switch (op >> 12) {
+        case 0x0: return (op & 0xFFF0) == 0x00D0;
+        case 0x5: return (op & 0xF) == 2 or (op & 0xF) == 3;
+        case 0xF: return op == 0xF000 or op == 0xF002 or (op & 0xFF) == 0x01 or (op & 0xFF) == 0x3A;
+        default: return false;
+    }
+}
+
+bool Disassembler::isMegaChip(std::uint16_t op)
+{
+    switch (op >> 8) {
+        case 0x00: return op == 0x0010 or op == 0x0011 or (op & 0xFFF0) == 0x00B0;
+        case 0x01: case 0x02: case 0x03: case 0x04: case 0x05: case 0x09: return true;
+        case 0x06: case 0x08: return (op & 0xF0) == 0;
+        case 0x07: return op == 0x0700;
+        default: return false;
+    }
+}
+
+std::string Disassembler::platform() const
+{
+    bool superChip {false};
+    bool xoChip {false};
+    for (std::uint16_t addr {origin}; inRom_(addr); ++addr) {
+        if (!isCode(addr))
+            continue;
+        if (isMegaChip(opcode(addr)))
+            return "megachip";
+        xoChip |= isXoChip(opcode(addr));
+        superChip |= isSuperChip(opcode(addr));
+    }
+    return xoChip ? "xochip" : superChip ? "superchip" : "chip8";
+}
+
+void Disassembler::trace_(std::uint16_t entry, std::vector<std::uint16_t>& work)
+{
+    auto branch {[&](std::uint16_t addr, std::uint8_t kind) {
+        if (addr >= flags_.size())
+            return;
+        flags_[addr] |= leader | kind;
+        if (!(flags_[addr] & code))
+            work.push_back(addr);
+    }};
+
+    for (std::uint16_t addr {entry}; inRom_(addr); addr += length(opcode(addr), xoChip_, megaChip_)) {
+        if (flags_[addr] & code) {
+            // fell through into code that was already traced from another path
+            flags_[addr] |= leader;
+            return;
+        }
+        std::uint16_t op {opcode(addr)};
+        if (op == 0x0011 and !megaChip_ and !(flags_[addr] & operand))
+            megaOn_ = true;
+        if ((flags_[addr] & operand) or !isDefined(op, xoChip_, megaChip_) or (length(op, xoChip_, megaChip_) == 4 and !inRom_(addr + 2)))
+            return;
+
+        flags_[addr] |= code;
+        for (int b {1}; b != length(op, xoChip_, megaChip_); ++b)
+            flags_[addr + b] |= operand;
+        std::uint16_t next {static_cast<std::uint16_t>(addr + length(op, xoChip_, megaChip_))};
+        std::uint16_t nnn {static_cast<std::uint16_t>(op & 0xFFF)};
+
+        if (op == 0x00EE or op == 0x00FD) {
+            return;
+        } else if (op >> 12 == 0x1) {
+            return branch(nnn, target);
+        } else if (op >> 12 == 0x2) {
+            branch(nnn, subroutine);
+            branch(next, 0);
+        } else if (op >> 12 == 0xB) {
+            // jump0 is almost always into a table of 1nnn jumps, follow every entry of it
+            for (std::uint16_t t {nnn}; t < flags_.size(); t += 2) {
+                branch(t, target);
+                if (!inRom_(t) or opcode(t) >> 12 != 0x1)
+                    break;
+            }
+            return;
+        } else if (isSkip(op, xoChip_)) {
+            branch(next, 0);
+            branch(next + length(opcode(next), xoChip_, megaChip_), 0);
+        } else if (op >> 12 == 0xA and nnn < flags_.size()) {
+            flags_[nnn] |= data;
+        } else if (xoChip_ and op == 0xF000 and opcode(addr + 2) < flags_.size()) {
+            flags_[opcode(addr + 2)] |= data;
+        } else if (op >> 8 == 0x01 and (op & 0xFF) == 0 and opcode(addr + 2) < flags_.size()) {
+            flags_[opcode(addr + 2)] |= data;
+        }
+    }
+}
+
+void Disassembler::split_()
+{
+    for (std::uint16_t addr {origin}; inRom_(addr); ++addr) {
+        if (!(flags_[addr] & code) or !(flags_[addr] & leader))
+            continue;
+
+        BasicBlock block {.start = addr};
+        std::uint16_t pc {addr};
+        while (true) {
+            std::uint16_t op {opcode(pc)};
+            std::uint16_t next {static_cast<std::uint16_t>(pc + length(op, xoChip_, megaChip_))};
+            std::uint16_t nnn {static_cast<std::uint16_t>(op & 0xFFF)};
+            block.end = next;
+
+            if (op == 0x00EE) {
+                block.returns = true;
+                break;
+            } else if (op == 0x00FD) {
+                break;
+            } else if (op >> 12 == 0x1) {
+                block.successors.push_back(nnn);
+                break;
+            } else if (op >> 12 == 0x2) {
+                block.callee = nnn;
+                block.successors.push_back(next);
+                break;
+            } else if (op >> 12 == 0xB) {
+                block.indirect = true;
+                block.successors.push_back(nnn);
+                break;
+            } else if (isSkip(op, xoChip_)) {
+                block.successors.push_back(next);
+                block.successors.push_back(next + length(opcode(next), xoChip_, megaChip_));
+                break;
+            } else if (!isCode(next) or flags_[next] & leader) {
+                if (isCode(next))
+                    block.successors.push_back(next);
+                break;
+            }
+            pc = next;
+        }
+        blocks_.emplace(block.start, std::move(block));
+    }
+}
+
+std::string Disassembler::label_(std::uint16_t addr) const
+{
+    if (addr == origin)
+        return "main";
+    if (addr >= flags_.size() or !(flags_[addr] & (code | data)))
+        return std::format("0x{:0>3X}", addr);
+    if (flags_[addr] & subroutine)
+        return std::format("sub-{:0>3X}", addr);
+    if (flags_[addr] & code)
+        return std::format("label-{:0>3X}", addr);
+    return std::format("data-{:0>3X}", addr);
+}
+
+std::string Disassembler::mnemonic(std::uint16_t op)
+{
+    int x {op >> 8 & 0xF};
+    int y {op >> 4 & 0xF};
+    int n {op & 0xF};
+    int nn {op & 0xFF};
+    int nnn {op & 0xFFF};
+
+    switch (op >> 12) {
+        case 0x0:
+            switch (nnn) {
+                case 0x0E0: return "clear";
+                case 0x0EE: return "return";
+                case 0x0FB: return "scroll-right";
+                case 0x0FC: return "scroll-left";
+                case 0x0FD: return "exit";
+                case 0x0FE: return "lores";
+                case 0x0FF: return "hires";
+                case 0x010: return "megaoff";
+                case 0x011: return "megaon";
+                default:
+                    if (y == 0xC) return std::format("scroll-down {:d}", n);
+                    if (y == 0xD or y == 0xB) return std::format("scroll-up {:d}", n);
+                    break;
+            }
+            switch (x) {
+                case 0x1: return "ldhi";
+                case 0x2: return std::format("ldpal {:d}", nn);
+                case 0x3: return std::format("sprw {:d}", nn);
+                case 0x4: return std::format("sprh {:d}", nn);
+                case 0x5: return std::format("alpha 0x{:0>2X}", nn);
+                case 0x6: if (y == 0) return std::format("digisnd {:d}", n); break;
+                case 0x7: if (nn == 0) return "stopsnd"; break;
+                case 0x8: if (y == 0) return std::format("bmode {:d}", n); break;
+                case 0x9: return std::format("ccol {:d}", nn);
+                default: break;
+            }
+            break;
+        case 0x1: return std::format("jump 0x{:0>3X}", nnn);
+        case 0x2: return std::format(":call 0x{:0>3X}", nnn);
+        case 0x3: return std::format("if v{:x} != 0x{:0>2X} then", x, nn);
+        case 0x4: return std::format("if v{:x} == 0x{:0>2X} then", x, nn);
+        case 0x5:
+            if (n == 0) return std::format("if v{:x} != v{:x} then", x, y);
+            if (n == 2) return std::format("save v{:x} - v{:x}", x, y);
+            if (n == 3) return std::format("load v{:x} - v{:x}", x, y);
+            break;
+        case 0x6: return std::format("v{:x} := 0x{:0>2X}", x, nn);
+        case 0x7: return std::format("v{:x} += 0x{:0>2X}", x, nn);
+        case 0x8:
+            switch (n) {
+                case 0x0: return std::format("v{:x} := v{:x}", x, y);
+                case 0x1: return std::format("v{:x} |= v{:x}", x, y);
+                case 0x2: return std::format("v{:x} &= v{:x}", x, y);
+                case 0x3: return std::format("v{:x} ^= v{:x}", x, y);
+                case 0x4: return std::format("v{:x} += v{:x}", x, y);
+                case 0x5: return std::format("v{:x} -= v{:x}", x, y);
+                case 0x6: return std::format("v{:x} >>= v{:x}", x, y);
+                case 0x7: return std::format("v{:x} =- v{:x}", x, y);
+                case 0xE: return std::format("v{:x} <<= v{:x}", x, y);
+                default: break;
+            }
+            break;
+        case 0x9: if (n == 0) return std::format("if v{:x} == v{:x} then", x, y); break;
+        case 0xA: return std::format("i := 0x{:0>3X}", nnn);
+        case 0xB: return std::format("jump0 0x{:0>3X}", nnn);
+        case 0xC: return std::format("v{:x} := random 0x{:0>2X}", x, nn);
+        case 0xD: return std::format("sprite v{:x} v{:x} {:d}", x, y, n);
+        case 0xE:
+            if (nn == 0x9E) return std::format("if v{:x} -key then", x);
+            if (nn == 0xA1) return std::format("if v{:x} key then", x);
+            break;
+        case 0xF:
+            switch (nn) {
+                case 0x07: return std::format("v{:x} := delay", x);
+                case 0x0A: return std::format("v{:x} := key", x);
+                case 0x15: return std::format("delay := v{:x}", x);
+                case 0x18: return std::format("buzzer := v{:x}", x);
+                case 0x1E: return std::format("i += v{:x}", x);
+                case 0x29: return std::format("i := hex v{:x}", x);
+                case 0x30: return std::format("i := bighex v{:x}", x);
+                case 0x33: return std::format("bcd v{:x}", x);
+                case 0x55: return std::format("save v{:x}", x);
+                case 0x65: return std::format("load v{:x}", x);
+                case 0x75: return std::format("saveflags v{:x}", x);
+                case 0x85: return std::format("loadflags v{:x}", x);
+                case 0x01: return std::format("plane {:d}", x);
+                case 0x3A: return std::format("pitch := v{:x}", x);
+                case 0x00: if (x == 0) return "i := long"; break;
+                case 0x02: if (x == 0) return "audio"; break;
+                default: break;
+            }
+            break;
+        default: break;
+    }
+    return std::format("0x{:0>2X} 0x{:0>2X}", op >> 8, op & 0xFF);
+}
+
+std::string Disassembler::octo() const
+{
+    std::string out;
+    auto labelled {[&](std::uint16_t addr) {
+        return addr == origin or flags_[addr] & (subroutine | target | data);
+    }};
+
+    std::size_t end {origin + rom_.size()};
+    for (std::size_t addr {origin}; addr < end;) {
+        if (labelled(addr))
+            out += std::format("\n: {:s}\n", label_(addr));
+
+        if (isCode(addr)) {
+            std::uint16_t op {opcode(addr)};
+            std::string text;
+            switch (op >> 12) {
+                case 0x1: text = "jump " + label_(op & 0xFFF); break;
+                case 0x2: text = label_(op & 0xFFF); break;
+                case 0xA: text = "i := " + label_(op & 0xFFF); break;
+                case 0xB: text = "jump0 " + label_(op & 0xFFF); break;
+                default: text = mnemonic(op); break;
+            }
+            if (length(op, xoChip_, megaChip_) == 4) {
+                // ldhi only has a label when it points into the first 64KB
+                if (op >> 8 == 0x01 and (op & 0xFF) != 0)
+                    text += std::format(" 0x{:0>6X}", (op & 0xFF) << 16 | opcode(addr + 2));
+                else
+                    text += " " + label_(opcode(addr + 2));
+                out += std::format("\t{:<24s}# {:0>3X}: {:0>4X} {:0>4X}\n", text, addr, op, opcode(addr + 2));
+            } else {
+                out += std::format("\t{:<24s}# {:0>3X}: {:0>4X}\n", text, addr, op);
+            }
+            addr += length(op, xoChip_, megaChip_);
+            continue;
+        }
+
+        // data runs up to eight bytes per line and stops at the next label or instruction
+        out += '\t';
+        int count {0};
+        do {
+            out += std::format("0x{:0>2X} ", rom_[addr - origin]);
+            ++addr;
+        } while (++count != 8 and addr < end and !isCode(addr) and !labelled(addr));
+        out += '\n';
+    }
+    return out;
+}
+
+std::string Disassembler::dot() const
+{
+    std::string out {"digraph rom {\n\tnode [shape=box, fontname=monospace];\n"};
+    for (const auto& [start, block] : blocks_) {
+        out += std::format("\tb{:0>3X} [label=\"", start);
+        for (std::uint16_t addr {block.start}; addr != block.end; addr += length(opcode(addr), xoChip_, megaChip_))
+            out += std::format("{:0>3X}: {:s}\\l", addr, mnemonic(opcode(addr)));
+        out += "\"];\n";
+
+        for (std::uint16_t succ : block.successors) {
+            if (blocks_.contains(succ))
+                out += std::format("\tb{:0>3X} -> b{:0>3X}{:s};\n", start, succ, block.indirect ? " [style=dotted]" : "");
+        }
+        if (block.callee != 0 and blocks_.contains(block.callee))
+            out += std::format("\tb{:0>3X} -> b{:0>3X} [style=dashed];\n", start, block.callee);
+    }
+    out += "}\n";
+    return out;
+}
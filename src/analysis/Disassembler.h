@@ -0,0 +1,89 @@
+#ifndef CHIP_8_DISASSEMBLER_H
+#define CHIP_8_DISASSEMBLER_H
+
+#include <cstdint>
+#include <map>
+#include <span>
+#include <string>
+#include <vector>
+
+// A straight run of instructions with a single entry and a single exit.
+struct BasicBlock {
+    std::uint16_t start {0}; // address of the first instruction
+    std::uint16_t end {0}; // address one past the last instruction
+    std::vector<std::uint16_t> successors; // statically known targets, fall through first
+    std::uint16_t callee {0}; // target of a trailing 2nnn, 0 if none
+    bool indirect {false}; // ends in Bnnn, successors are a guess
+    bool returns {false}; // ends in 00EE
+};
+
+class Disassembler {
+public:
+    static constexpr std::uint16_t origin {0x200};
+
+    // Walks every instruction reachable from 0x200 and builds the control-flow graph for platform, one of "chip8",
+    // "superchip", "xochip" and "megachip". Left empty, XO-CHIP instructions are always decoded and MEGA-CHIP ones
+    // once a reachable megaon turns them on.
+    explicit Disassembler(std::span<const std::uint8_t> rom, const std::string& platform = "");
+    // Rebuilds the graph from the per-address flags of an earlier analysis of the same rom, see flags().
+    Disassembler(std::span<const std::uint8_t> rom, std::span<const std::uint8_t> flags);
+
+    [[nodiscard]] const std::map<std::uint16_t, BasicBlock>& blocks() const { return blocks_; }
+    [[nodiscard]] const BasicBlock* blockAt(std::uint16_t addr) const;
+    [[nodiscard]] bool isCode(std::uint16_t addr) const { return addr < flags_.size() and flags_[addr] & code; }
+    [[nodiscard]] bool isData(std::uint16_t addr) const { return addr < flags_.size() and flags_[addr] & data; }
+    [[nodiscard]] bool isSubroutine(std::uint16_t addr) const { return addr < flags_.size() and flags_[addr] & subroutine; }
+    [[nodiscard]] std::uint16_t opcode(std::uint16_t addr) const;
+    [[nodiscard]] std::size_t size() const { return rom_.size(); }
+    [[nodiscard]] std::span<const std::uint8_t> flags() const { return flags_; }
+    // true if XO-CHIP or MEGA-CHIP instructions were decoded
+    [[nodiscard]] bool xoChip() const { return xoChip_; }
+    [[nodiscard]] bool megaChip() const { return megaChip_; }
+    // "megachip", "xochip" or "superchip" if any reachable instruction only exists on that platform, otherwise "chip8"
+    [[nodiscard]] std::string platform() const;
+
+    [[nodiscard]] std::string octo() const;
+    [[nodiscard]] std::string dot() const;
+
+    // Octo mnemonic for a single instruction, jump targets are printed as raw addresses. F000 and 01nn are
+    // printed without their operand. MEGA-CHIP instructions, which Octo lacks, use the names of its assemblers.
+    static std::string mnemonic(std::uint16_t op);
+    // Bytes taken by op, 4 for XO-CHIP's F000 nnnn and MEGA-CHIP's 01nn nnnn and 2 for everything else.
+    static int length(std::uint16_t op, bool xoChip, bool megaChip)
+    {
+        return (xoChip and op == 0xF000) or (megaChip and op >> 8 == 0x01) ? 4 : 2;
+    }
+    // True for 3xnn, 4xnn, 5xy0, 9xy0, Ex9E and ExA1, and for 5xy2 and 5xy3 outside XO-CHIP.
+    static bool isSkip(std::uint16_t op, bool xoChip);
+    // True if the interpreter has an implementation for op, XO-CHIP's and MEGA-CHIP's only if those are set.
+    static bool isDefined(std::uint16_t op, bool xoChip, bool megaChip);
+    // True for instructions added by SUPER-CHIP, including the 16x16 Dxy0.
+    static bool isSuperChip(std::uint16_t op);
+    // True for instructions added by XO-CHIP.
+    static bool isXoChip(std::uint16_t op);
+    // True for instructions added by MEGA-CHIP.
+    static bool isMegaChip(std::uint16_t op);
+private:
+    static constexpr std::uint8_t code {1 << 0}; // first byte of an instruction
+    static constexpr std::uint8_t leader {1 << 1}; // first instruction of a basic block
+    static constexpr std::uint8_t data {1 << 2}; // referenced through Annn
+    static constexpr std::uint8_t subroutine {1 << 3}; // target of a 2nnn
+    static constexpr std::uint8_t operand {1 << 4}; // second byte of an instruction
+    static constexpr std::uint8_t target {1 << 5}; // target of a 1nnn or Bnnn
+
+    void analyse_();
+    void trace_(std::uint16_t entry, std::vector<std::uint16_t>& work);
+    void split_();
+    [[nodiscard]] bool inRom_(std::uint16_t addr) const { return addr >= origin and std::size_t {addr} + 1 < origin + rom_.size(); }
+    [[nodiscard]] std::string label_(std::uint16_t addr) const;
+
+    std::vector<std::uint8_t> rom_;
+    std::vector<std::uint8_t> flags_; // by address, covers at least 4KB and the whole rom
+    std::map<std::uint16_t, BasicBlock> blocks_;
+    bool xoChip_ {true};
+    bool megaChip_ {false};
+    bool megaOn_ {false}; // a reachable megaon was found while megaChip_ was off
+};
+
+
+#endif //CHIP_8_DISASSEMBLER_H
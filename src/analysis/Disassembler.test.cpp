@@ -0,0 +1,145 @@
+#include <gtest/gtest.h>
+#include "Disassembler.h"
+
+TEST(DisassemblerTest, straightLineIsOneBlock)
+{
+    std::vector<std::uint8_t> rom {0x60, 0x12, 0x71, 0x01, 0x12, 0x00};
+    Disassembler disassembler {rom};
+
+    ASSERT_EQ(disassembler.blocks().size(), 1);
+    const BasicBlock& block {disassembler.blocks().at(0x200)};
+    EXPECT_EQ(block.end, 0x206);
+    EXPECT_EQ(block.successors, std::vector<std::uint16_t>{0x200});
+}
+
+TEST(DisassemblerTest, skipSplitsBlocks)
+{
+    // 200: v0 := 1, 202: if v0 != 1 then, 204: jump 200, 206: exit
+    std::vector<std::uint8_t> rom {0x60, 0x01, 0x30, 0x01, 0x12, 0x00, 0x00, 0xFD};
+    Disassembler disassembler {rom};
+
+    ASSERT_EQ(disassembler.blocks().size(), 3);
+    EXPECT_EQ(disassembler.blocks().at(0x200).successors, (std::vector<std::uint16_t>{0x204, 0x206}));
+    EXPECT_EQ(disassembler.blocks().at(0x204).successors, std::vector<std::uint16_t>{0x200});
+    EXPECT_TRUE(disassembler.blocks().at(0x206).successors.empty());
+}
+
+TEST(DisassemblerTest, jumpIntoBlockSplitsIt)
+{
+    // 200: v0 := 1, 202: v1 := 2, 204: jump 202
+    std::vector<std::uint8_t> rom {0x60, 0x01, 0x61, 0x02, 0x12, 0x02};
+    Disassembler disassembler {rom};
+
+    ASSERT_EQ(disassembler.blocks().size(), 2);
+    EXPECT_EQ(disassembler.blocks().at(0x200).end, 0x202);
+    EXPECT_EQ(disassembler.blockAt(0x204)->start, 0x202);
+}
+
+TEST(DisassemblerTest, callAndReturn)
+{
+    // 200: call 206, 202: jump 202, 204: data, 206: clear, 208: return
+    std::vector<std::uint8_t> rom {0x22, 0x06, 0x12, 0x02, 0xAB, 0xCD, 0x00, 0xE0, 0x00, 0xEE};
+    Disassembler disassembler {rom};
+
+    const BasicBlock& caller {disassembler.blocks().at(0x200)};
+    EXPECT_EQ(caller.callee, 0x206);
+    EXPECT_EQ(caller.successors, std::vector<std::uint16_t>{0x202});
+    EXPECT_TRUE(disassembler.isSubroutine(0x206));
+    EXPECT_TRUE(disassembler.blocks().at(0x206).returns);
+    EXPECT_FALSE(disassembler.isCode(0x204));
+}
+
+TEST(DisassemblerTest, spriteDataIsNotCode)
+{
+    // 200: i := 206, 202: sprite v0 v0 2, 204: exit, 206: sprite
+    std::vector<std::uint8_t> rom {0xA2, 0x06, 0xD0, 0x02, 0x00, 0xFD, 0xF0, 0x90};
+    Disassembler disassembler {rom};
+
+    EXPECT_TRUE(disassembler.isData(0x206));
+    EXPECT_FALSE(disassembler.isCode(0x206));
+    EXPECT_NE(disassembler.octo().find(": data-206\n\t0xF0 0x90"), std::string::npos);
+    EXPECT_NE(disassembler.octo().find("i := data-206"), std::string::npos);
+}
+
+TEST(DisassemblerTest, jumpTableIsFollowed)
+{
+    // 200: jump0 204, 202: exit, 204: jump 208, 206: jump 20A, 208: exit, 20A: exit
+    std::vector<std::uint8_t> rom {0xB2, 0x04, 0x00, 0xFD, 0x12, 0x08, 0x12, 0x0A, 0x00, 0xFD, 0x00, 0xFD};
+    Disassembler disassembler {rom};
+
+    EXPECT_TRUE(disassembler.blocks().at(0x200).indirect);
+    EXPECT_TRUE(disassembler.isCode(0x206));
+    EXPECT_TRUE(disassembler.isCode(0x20A));
+    EXPECT_FALSE(disassembler.isCode(0x202));
+}
+
+TEST(DisassemblerTest, mnemonics)
+{
+    EXPECT_EQ(Disassembler::mnemonic(0x00E0), "clear");
+    EXPECT_EQ(Disassembler::mnemonic(0x00C4), "scroll-down 4");
+    EXPECT_EQ(Disassembler::mnemonic(0x3A12), "if va != 0x12 then");
+    EXPECT_EQ(Disassembler::mnemonic(0x8AB7), "va =- vb");
+    EXPECT_EQ(Disassembler::mnemonic(0xD125), "sprite v1 v2 5");
+    EXPECT_EQ(Disassembler::mnemonic(0xF230), "i := bighex v2");
+    EXPECT_EQ(Disassembler::mnemonic(0x8008), "0x80 0x08");
+}
+
+TEST(DisassemblerTest, xoChipLongLoad)
+{
+    // 200: if v0 != 0 then, 202: i := long 0x1234, 206: plane 3, 208: exit
+    std::vector<std::uint8_t> rom {0x30, 0x00, 0xF0, 0x00, 0x12, 0x34, 0xF3, 0x01, 0x00, 0xFD};
+    Disassembler disassembler {rom};
+
+    EXPECT_EQ(disassembler.platform(), "xochip");
+    EXPECT_EQ(disassembler.blocks().at(0x200).successors, (std::vector<std::uint16_t>{0x202, 0x206}));
+    EXPECT_EQ(disassembler.blocks().at(0x202).end, 0x206);
+    EXPECT_TRUE(disassembler.isCode(0x202));
+    EXPECT_FALSE(disassembler.isCode(0x204));
+    EXPECT_NE(disassembler.octo().find("i := long 0x1234"), std::string::npos);
+    EXPECT_EQ(Disassembler::mnemonic(0x5123), "load v1 - v2");
+    EXPECT_EQ(Disassembler::mnemonic(0x00D3), "scroll-up 3");
+}
+
+TEST(DisassemblerTest, megaChipInstructions)
+{
+    // 200: megaon, 202: ldhi 0x012345, 206: ldpal 2, 208: sprw 16, 20A: exit
+    std::vector<std::uint8_t> rom {0x00, 0x11, 0x01, 0x01, 0x23, 0x45, 0x02, 0x02, 0x03, 0x10, 0x00, 0xFD};
+    Disassembler disassembler {rom};
+
+    EXPECT_EQ(disassembler.platform(), "megachip");
+    EXPECT_EQ(disassembler.blocks().at(0x200).end, 0x20C);
+    EXPECT_FALSE(disassembler.isCode(0x204));
+    EXPECT_NE(disassembler.octo().find("ldhi 0x012345"), std::string::npos);
+    EXPECT_EQ(Disassembler::mnemonic(0x0802), "bmode 2");
+    EXPECT_EQ(Disassembler::mnemonic(0x00B4), "scroll-up 4");
+}
+
+TEST(DisassemblerTest, megaChipNeedsMegaon)
+{
+    // 200: high, 202: 0x01 0x23 is a machine call outside MEGA-CHIP, so the trace stops there
+    std::vector<std::uint8_t> rom {0x00, 0xFF, 0x01, 0x23, 0x45, 0x67, 0x00, 0xFD};
+    Disassembler detected {rom};
+
+    EXPECT_EQ(detected.platform(), "superchip");
+    EXPECT_FALSE(detected.megaChip());
+    EXPECT_FALSE(detected.isCode(0x202));
+    EXPECT_EQ(Disassembler::length(0x0123, true, false), 2);
+
+    Disassembler requested {rom, "megachip"};
+    EXPECT_EQ(requested.platform(), "megachip");
+    EXPECT_TRUE(requested.isCode(0x202));
+    EXPECT_EQ(requested.blocks().at(0x200).end, 0x208);
+}
+
+TEST(DisassemblerTest, xoChipInstructionsFollowThePlatform)
+{
+    // 200: if v1 == v2 then on everything but XO-CHIP, 202: i := long 0x1234 on XO-CHIP, 206: exit
+    std::vector<std::uint8_t> rom {0x51, 0x22, 0xF0, 0x00, 0x12, 0x34, 0x00, 0xFD};
+    Disassembler xoChip {rom, "xochip"};
+    Disassembler chip8 {rom, "chip8"};
+
+    EXPECT_EQ(xoChip.blocks().at(0x200).end, 0x208);
+    EXPECT_FALSE(chip8.isCode(0x202)); // F000 is undefined
+    EXPECT_EQ(chip8.blocks().at(0x200).successors, (std::vector<std::uint16_t>{0x202, 0x204}));
+    EXPECT_EQ(Disassembler::length(0xF000, false, false), 2);
+}
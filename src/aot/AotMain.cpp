@@ -0,0 +1,141 @@
+#include <algorithm>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <iostream>
+#include <format>
+#include "SDL.h"
+#include "AotRuntime.h"
+#include "../log/Log.h"
+#include "../machine/Machine.h"
+#include "../verify/Shadow.h"
+
+// Entry point for the native executables built from schip8-aot output, see schip8_add_aot().
+int main(int argc, char** argv) {
+    SDL_LogSetPriority(SDL_LOG_CATEGORY_APPLICATION, SDL_LOG_PRIORITY_INFO);
+
+    Machine machine {};
+    Memory& memory {machine.memory};
+    Display& display {machine.display};
+    Keyboard& keyboard {machine.keyboard};
+    Interpreter& interpreter {machine.interpreter};
+    AotRuntime runtime {aotProgram, interpreter, memory};
+    interpreter.setMode(std::string {aotProgram.mode}); // before any -quirk, which it would reset
+
+    double cycles_per_frame {20};
+    bool stats {false};
+    int shadowStride {0};
+    int frames {0};
+
+    using namespace std::string_view_literals;
+    for (int i {1}; i < argc; ++i) {
+        bool hasNext {i + 1 != argc};
+        if (argv[i] == "--mode"sv and hasNext) {
+            if (argv[++i] != aotProgram.mode)
+                std::cerr << std::format("error: '{:s}' was translated for mode '{:s}', ignoring '--mode {:s}'.\n",
+                                         aotProgram.title, aotProgram.mode, argv[i]);
+        } else if (argv[i] == "-quirk"sv and hasNext) {
+            if (!interpreter.setQuirk(argv[++i]))
+                std::cerr << std::format("error: failed to read interpreter '-quirk {:s}' option.\n", argv[i]);
+        } else if (argv[i] == "-cycles_per_frame"sv and hasNext) {
+            try {
+                std::string n {argv[++i]};
+                cycles_per_frame = std::stoi(n);
+            } catch (std::exception& e) {
+                std::cerr << std::format("error: failed to read integer for '-cycles_per_frame' option, using default={:f}.\n", cycles_per_frame);
+            }
+        } else if (argv[i] == "-shadow"sv and hasNext) {
+            try {
+                shadowStride = std::max(std::stoi(argv[++i]), 0);
+            } catch (std::exception& e) {
+                std::cerr << "error: failed to read integer for '-shadow' option, not shadowing.\n";
+            }
+        } else if (argv[i] == "-frames"sv and hasNext) {
+            try {
+                frames = std::max(std::stoi(argv[++i]), 0);
+            } catch (std::exception& e) {
+                std::cerr << "error: failed to read integer for '-frames' option, opening a window.\n";
+            }
+        } else if (argv[i] == "-stats"sv) {
+            stats = true;
+        } else {
+            std::cerr << std::format("error: unrecognized command line argument '{:s}'.\n", argv[i]);
+        }
+    }
+
+    memory.load(aotProgram.rom);
+    // Checks the translated code against the interpreter. Frames run again to find where they diverged run on
+    // forks of the machine, which need a runtime of their own.
+    std::optional<Shadow> shadow;
+    if (shadowStride != 0) {
+        shadow.emplace(machine, [&machine, &runtime](Machine& m, int budget) {
+            std::optional<AotRuntime> replay;
+            if (&m != &machine)
+                replay.emplace(aotProgram, m.interpreter, m.memory);
+            AotRuntime& r {replay ? *replay : runtime};
+            int n {0};
+            do {
+                n += r.step();
+            } while (n < budget and !m.interpreter.waiting and !m.interpreter.vblank);
+            return n;
+        }, shadowStride);
+    }
+    bool diverged {false};
+    auto runFrame {[&](std::uint64_t frame) {
+        if (shadow) {
+            if (!shadow->frame(static_cast<int>(cycles_per_frame), frame)) {
+                std::cerr << std::format("{:s}: translated code {:s}", aotProgram.title, shadow->divergence()->report());
+                diverged = true;
+            }
+            return;
+        }
+        // a translated block can run past the budget by a few instructions, same as a real frame boundary would
+        for (int cycles {0}; cycles < cycles_per_frame and !interpreter.vblank;)
+            cycles += runtime.step();
+        interpreter.endOfFrame();
+    }};
+
+    // -frames runs that many frames as fast as possible without a window or keys, for tests
+    if (frames != 0) {
+        for (int frame {0}; frame != frames and !diverged; ++frame)
+            runFrame(frame);
+    } else {
+        if (SDL_Init(SDL_INIT_VIDEO) < 0) {
+            Log::global().write(Log::Level::error, "display", "sdl_error", "{:s}", SDL_GetError());
+            return 1;
+        }
+
+        if (display.on()) {
+            SDL_Event e;
+            bool quit {false};
+            int frameLength {static_cast<int>(1.0 / 60.0 * 1e3)};
+
+            for (std::uint64_t frame {0}; !quit and !diverged; ++frame) {
+                while (SDL_PollEvent(&e) != 0) {
+                    if (e.type == SDL_QUIT) {
+                        quit = true;
+                    } else if (interpreter.waiting and !shadow) {
+                        if (e.type == SDL_KEYDOWN) {
+                            keyboard.onKeyDown(e.key.keysym.scancode);
+                        } else if (e.type == SDL_KEYUP) {
+                            keyboard.onKeyUp(e.key.keysym.scancode);
+                        }
+                    }
+                }
+
+                if (shadow)
+                    shadow->setKeys(Keyboard::hostMask());
+                runFrame(frame);
+                SDL_Delay(frameLength);
+            }
+            display.off();
+        }
+        SDL_Quit();
+    }
+
+    if (stats) {
+        std::cout << std::format("{:s}: {:d} native instructions, {:d} interpreted\n",
+                                 aotProgram.title, runtime.nativeInstructions, runtime.interpretedInstructions);
+    }
+    return diverged ? 1 : 0;
+}
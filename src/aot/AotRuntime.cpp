@@ -0,0 +1,34 @@
+#include "AotRuntime.h"
+#include <algorithm>
+
+int AotRuntime::step()
+{
+    int executed {program.dispatch(*this, interpreter)};
+    if (executed != 0) {
+        nativeInstructions += executed;
+        return executed;
+    }
+
+    // computed jump target, self-modified block or code the analysis never reached
+    interpreter.cycle();
+    ++interpretedInstructions;
+    return 1;
+}
+
+bool AotRuntime::unmodified(std::size_t block)
+{
+    // only writes to the pages the block is on mean it has to be compared again
+    const AotBlock& b {program.blocks[block]};
+    std::uint64_t changed {0};
+    for (std::size_t addr {b.start}; addr < b.start + b.bytes.size(); addr += Memory::pageSize - addr % Memory::pageSize)
+        changed = std::max(changed, memory.generation(static_cast<std::uint32_t>(addr)));
+    if (verified_[block] == changed)
+        return true;
+
+    for (std::size_t offset {0}; offset != b.bytes.size(); ++offset) {
+        if (memory.read(b.start + offset) != b.bytes[offset])
+            return false;
+    }
+    verified_[block] = changed;
+    return true;
+}
@@ -0,0 +1,54 @@
+#ifndef CHIP_8_AOTRUNTIME_H
+#define CHIP_8_AOTRUNTIME_H
+
+#include <cstdint>
+#include <span>
+#include <string_view>
+#include <vector>
+#include "../interpreter/Interpreter.h"
+#include "../memory/Memory.h"
+
+class AotRuntime;
+
+// A basic block translated by schip8-aot, bytes is the code it was translated from.
+struct AotBlock {
+    std::uint16_t start;
+    std::span<const std::uint8_t> bytes;
+};
+
+// Everything a translation unit written by schip8-aot exports.
+struct AotProgram {
+    std::string_view title;
+    std::string_view mode; // of the interpreter, the translation is only valid in it
+    std::span<const std::uint8_t> rom;
+    std::span<const AotBlock> blocks;
+    // runs the translated block starting at pc, returns the number of instructions executed or 0 if there is none
+    int (*dispatch)(AotRuntime&, Interpreter&);
+};
+
+// Provided by the translation unit schip8-aot generates.
+extern const AotProgram aotProgram;
+
+class AotRuntime {
+public:
+    AotRuntime(const AotProgram& prog, Interpreter& interp, Memory& mem)
+        : program{prog}, interpreter{interp}, memory{mem}, verified_(prog.blocks.size(), ~0ull) {};
+
+    // Runs one translated block, or a single interpreted instruction when pc is not the start of one.
+    // Returns the number of instructions executed.
+    int step();
+    // True if block still holds the bytes it was translated from. Translated code also asks after every
+    // instruction that stores to memory, since it could have rewritten the rest of the block.
+    bool unmodified(std::size_t block);
+
+    const AotProgram& program;
+    unsigned long long nativeInstructions {0};
+    unsigned long long interpretedInstructions {0};
+private:
+    Interpreter& interpreter;
+    Memory& memory;
+    std::vector<std::uint64_t> verified_; // generation of the block's pages when it was last checked
+};
+
+
+#endif //CHIP_8_AOTRUNTIME_H
@@ -0,0 +1,40 @@
+#include "Fusion.h"
+
+namespace {
+    bool isLoad(std::uint16_t op)
+    {
+        return op >> 12 == 6 or op >> 12 == 7;
+    }
+}
+
+std::vector<FusedOp> fuse(const Disassembler& disassembler, const BasicBlock& block)
+{
+    std::vector<FusedOp> fused;
+    for (std::uint16_t addr {block.start}; addr != block.end;) {
+        std::uint16_t op {disassembler.opcode(addr)};
+        bool hasNext {addr + 2 != block.end};
+        std::uint16_t next {hasNext ? disassembler.opcode(addr + 2) : std::uint16_t {0}};
+        FusedOp f {.addr = addr, .ops = {op}};
+
+        if (hasNext and op >> 12 == 0xA and next >> 12 == 0xD) {
+            f = {FusedOp::loadDraw, addr, {op, next}};
+        } else if (hasNext and (op & 0xF0FF) == 0xF033 and (next & 0xF0FF) == 0xF065) {
+            f = {FusedOp::bcdLoad, addr, {op, next}};
+        } else if (hasNext and isLoad(op) and isLoad(next)) {
+            f.kind = FusedOp::loads;
+            for (std::uint16_t a {static_cast<std::uint16_t>(addr + 2)}; a != block.end and isLoad(disassembler.opcode(a)); a += 2)
+                f.ops.push_back(disassembler.opcode(a));
+        } else if (!hasNext and (op >> 12 == 3 or op >> 12 == 4) and disassembler.isCode(addr + 2)
+                   and disassembler.opcode(addr + 2) >> 12 == 1) {
+            f = {FusedOp::skipJump, addr, {op, disassembler.opcode(addr + 2)}};
+        }
+
+        // a skipJump's jump is past the end of the block, the operand of an F000 or 01nn is read by the interpreter
+        if (f.kind == FusedOp::single)
+            addr += Disassembler::length(op, disassembler.xoChip(), disassembler.megaChip());
+        else
+            addr += 2 * static_cast<std::uint16_t>(f.kind == FusedOp::skipJump ? 1 : f.ops.size());
+        fused.push_back(std::move(f));
+    }
+    return fused;
+}
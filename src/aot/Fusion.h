@@ -0,0 +1,27 @@
+#ifndef CHIP_8_FUSION_H
+#define CHIP_8_FUSION_H
+
+#include <cstdint>
+#include <vector>
+#include "../analysis/Disassembler.h"
+
+// Instructions of a basic block that translated code runs with one call, see the superinstructions of Interpreter.
+struct FusedOp {
+    enum Kind {
+        single, // anything else, run with Interpreter::execute()
+        loadDraw, // Annn, Dxyn
+        bcdLoad, // Fx33, Fy65
+        loads, // two or more of 6xnn and 7xnn
+        skipJump, // 3xnn or 4xnn ending the block, then the 1nnn after it
+    };
+
+    Kind kind {single};
+    std::uint16_t addr {0};
+    std::vector<std::uint16_t> ops;
+};
+
+// Peephole pass over one block. A skipJump ends after block.end, the jump it includes is also a block of its own.
+std::vector<FusedOp> fuse(const Disassembler& disassembler, const BasicBlock& block);
+
+
+#endif //CHIP_8_FUSION_H
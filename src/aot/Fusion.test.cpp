@@ -0,0 +1,75 @@
+#include <gtest/gtest.h>
+#include "Fusion.h"
+#include "../interpreter/Interpreter.h"
+
+TEST(FusionTest, fusesIdioms)
+{
+    // 200: v0 := 1, 202: v1 += 2, 204: i := 0x300, 206: sprite v0 v1 5, 208: bcd v0, 20A: load v2,
+    // 20C: save v3, 20E: if v0 == 1 then, 210: jump 200, 212: jump 212
+    std::vector<std::uint8_t> rom {0x60, 0x01, 0x71, 0x02, 0xA3, 0x00, 0xD0, 0x15, 0xF0, 0x33, 0xF2, 0x65,
+                                   0xF3, 0x55, 0x40, 0x01, 0x12, 0x00, 0x12, 0x12};
+    Disassembler disassembler {rom};
+    std::vector<FusedOp> fused {fuse(disassembler, disassembler.blocks().at(0x200))};
+
+    ASSERT_EQ(fused.size(), 5);
+    EXPECT_EQ(fused[0].kind, FusedOp::loads);
+    EXPECT_EQ(fused[0].ops, (std::vector<std::uint16_t> {0x6001, 0x7102}));
+    EXPECT_EQ(fused[1].kind, FusedOp::loadDraw);
+    EXPECT_EQ(fused[2].kind, FusedOp::bcdLoad);
+    EXPECT_EQ(fused[3].kind, FusedOp::single);
+    EXPECT_EQ(fused[4].kind, FusedOp::skipJump);
+    EXPECT_EQ(fused[4].addr, 0x20E);
+    EXPECT_EQ(fused[4].ops, (std::vector<std::uint16_t> {0x4001, 0x1200}));
+}
+
+class SuperinstructionTest : public testing::Test {
+protected:
+    // runs ops one at a time on a and fused on b, then compares the machines
+    void expectSame(int executed, std::span<const std::uint16_t> ops)
+    {
+        for (std::uint16_t op : ops)
+            a.execute(op);
+        EXPECT_EQ(a.pc, b.pc);
+        EXPECT_EQ(a.i, b.i);
+        EXPECT_EQ(a.v, b.v);
+        EXPECT_EQ(a.cir, b.cir);
+        EXPECT_EQ(a.stateHash(), b.stateHash());
+        EXPECT_EQ(executed, static_cast<int>(ops.size()));
+    }
+
+    Memory ma {}, mb {};
+    Display da {}, db {};
+    Keyboard ka {}, kb {};
+    Interpreter a {ma, da, ka}, b {mb, db, kb};
+};
+
+TEST_F(SuperinstructionTest, bcdLoadMatchesUnderQuirks)
+{
+    for (std::string quirk : {"memory=true", "memory=false"}) {
+        a.setQuirk(quirk);
+        b.setQuirk(quirk);
+        for (std::uint16_t op : {0x60FE, 0xA400}) {
+            a.execute(op);
+            b.execute(op);
+        }
+
+        std::vector<std::uint16_t> fused {0xF033, 0xF265};
+        expectSame(b.executeBcdLoad(fused[0], fused[1]), fused);
+    }
+}
+
+TEST_F(SuperinstructionTest, loadDrawAndLoadsMatch)
+{
+    std::vector<std::uint16_t> loads {0x6005, 0x7003, 0x6F01, 0x7FFF};
+    expectSame(b.executeLoads(loads), loads);
+    std::vector<std::uint16_t> draw {0xA050, 0xD0F5};
+    expectSame(b.executeLoadDraw(draw[0], draw[1]), draw);
+}
+
+TEST_F(SuperinstructionTest, skipJumpCountsOnlyWhatRuns)
+{
+    EXPECT_EQ(b.executeSkipJump(0x3000, 0x1234), 1);
+    EXPECT_EQ(b.pc, 0x204);
+    EXPECT_EQ(b.executeSkipJump(0x4000, 0x1234), 2);
+    EXPECT_EQ(b.pc, 0x234);
+}
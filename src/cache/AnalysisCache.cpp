@@ -0,0 +1,88 @@
+#include "AnalysisCache.h"
+#include <cstdlib>
+#include <cstring>
+#include <format>
+#include <fstream>
+#include <random>
+#include "../io/MappedFile.h"
+
+std::filesystem::path AnalysisCache::defaultDirectory()
+{
+#ifdef _WIN32
+    if (const char* local {std::getenv("LOCALAPPDATA")})
+        return std::filesystem::path(local) / "schip8";
+#else
+    if (const char* xdg {std::getenv("XDG_CACHE_HOME")}; xdg and *xdg)
+        return std::filesystem::path(xdg) / "schip8";
+    if (const char* home {std::getenv("HOME")})
+        return std::filesystem::path(home) / ".cache" / "schip8";
+#endif
+    return std::filesystem::temp_directory_path() / "schip8";
+}
+
+std::filesystem::path AnalysisCache::entry(std::uint64_t hash) const
+{
+    return dir_ / std::format("{:0>16x}.cfg", hash);
+}
+
+AnalysisCache::Header AnalysisCache::header_(std::span<const std::uint8_t> rom, std::uint64_t hash, std::size_t flagsSize)
+{
+    Header header {{'S', '8', 'C', 'F'}, formatVersion, {}, hash,
+                   static_cast<std::uint32_t>(rom.size()), static_cast<std::uint32_t>(flagsSize)};
+    std::strncpy(header.version, SCHIP8_VERSION, sizeof header.version - 1);
+    return header;
+}
+
+Disassembler AnalysisCache::analyse(std::span<const std::uint8_t> rom, std::uint64_t hash)
+{
+    if (auto cached {load(rom, hash)}) {
+        ++hits;
+        return std::move(*cached);
+    }
+
+    ++misses;
+    Disassembler disassembler {rom};
+    store(rom, hash, disassembler);
+    return disassembler;
+}
+
+std::optional<Disassembler> AnalysisCache::load(std::span<const std::uint8_t> rom, std::uint64_t hash) const
+{
+    MappedFile file {entry(hash)};
+    std::span<const std::uint8_t> bytes {file.bytes()};
+    if (bytes.size() < sizeof(Header))
+        return std::nullopt;
+
+    Header expected {header_(rom, hash, 0)};
+    Header header {};
+    std::memcpy(&header, bytes.data(), sizeof header);
+    expected.flagsSize = header.flagsSize;
+    if (std::memcmp(&header, &expected, sizeof header) != 0 or bytes.size() != sizeof header + header.flagsSize)
+        return std::nullopt;
+
+    return Disassembler {rom, bytes.subspan(sizeof header)};
+}
+
+bool AnalysisCache::store(std::span<const std::uint8_t> rom, std::uint64_t hash, const Disassembler& disassembler) const
+{
+    std::error_code ec;
+    std::filesystem::create_directories(dir_, ec);
+    if (ec)
+        return false;
+
+    // written next to the entry and renamed over it so readers never map a half written file
+    std::filesystem::path tmp {entry(hash)};
+    tmp += std::format(".{:0>8x}.tmp", std::random_device{}());
+    {
+        std::ofstream out {tmp, std::ios::binary};
+        Header header {header_(rom, hash, disassembler.flags().size())};
+        out.write(reinterpret_cast<const char*>(&header), sizeof header);
+        out.write(reinterpret_cast<const char*>(disassembler.flags().data()), static_cast<std::streamsize>(disassembler.flags().size()));
+        if (!out)
+            return false;
+    }
+    std::filesystem::rename(tmp, entry(hash), ec);
+    if (ec)
+        std::filesystem::remove(tmp, ec);
+    return !ec;
+}
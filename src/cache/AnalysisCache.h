@@ -0,0 +1,49 @@
+#ifndef CHIP_8_ANALYSISCACHE_H
+#define CHIP_8_ANALYSISCACHE_H
+
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <span>
+#include "../analysis/Disassembler.h"
+
+#ifndef SCHIP8_VERSION
+#define SCHIP8_VERSION "0.0"
+#endif
+
+// On-disk cache of rom analysis results keyed by Memory::hash of the rom image.
+// Entries are memory-mapped on load and ignored when the rom or the emulator version no longer matches.
+class AnalysisCache {
+public:
+    // bump whenever the layout of an entry or the meaning of Disassembler::flags() changes
+    static constexpr std::uint32_t formatVersion {2};
+
+    explicit AnalysisCache(std::filesystem::path dir) : dir_{std::move(dir)} {};
+
+    // $XDG_CACHE_HOME/schip8, ~/.cache/schip8 or %LOCALAPPDATA%\schip8
+    static std::filesystem::path defaultDirectory();
+
+    // Returns the cached analysis of rom, analysing and storing it on a miss.
+    Disassembler analyse(std::span<const std::uint8_t> rom, std::uint64_t hash);
+    [[nodiscard]] std::optional<Disassembler> load(std::span<const std::uint8_t> rom, std::uint64_t hash) const;
+    bool store(std::span<const std::uint8_t> rom, std::uint64_t hash, const Disassembler& disassembler) const;
+    [[nodiscard]] std::filesystem::path entry(std::uint64_t hash) const;
+
+    unsigned hits {0};
+    unsigned misses {0};
+private:
+    struct Header {
+        char magic[4];
+        std::uint32_t format;
+        char version[16];
+        std::uint64_t romHash;
+        std::uint32_t romSize;
+        std::uint32_t flagsSize;
+    };
+    static Header header_(std::span<const std::uint8_t> rom, std::uint64_t hash, std::size_t flagsSize);
+
+    std::filesystem::path dir_;
+};
+
+
+#endif //CHIP_8_ANALYSISCACHE_H
@@ -0,0 +1,55 @@
+#include <gtest/gtest.h>
+#include <fstream>
+#include "AnalysisCache.h"
+#include "../memory/Memory.h"
+
+class AnalysisCacheTest : public testing::Test {
+protected:
+    AnalysisCacheTest() {
+        std::filesystem::remove_all(dir);
+    }
+    ~AnalysisCacheTest() override {
+        std::filesystem::remove_all(dir);
+    }
+
+    std::filesystem::path dir {std::filesystem::temp_directory_path() / "schip8-analysis-cache-test"};
+    // 200: i := 208, 202: call 206, 204: jump 204, 206: return, 208: sprite
+    std::vector<std::uint8_t> rom {0xA2, 0x08, 0x22, 0x06, 0x12, 0x04, 0x00, 0xEE, 0xF0, 0x90};
+    std::uint64_t hash {Memory::hash(rom)};
+};
+
+TEST_F(AnalysisCacheTest, missThenHit)
+{
+    AnalysisCache cache {dir};
+    Disassembler first {cache.analyse(rom, hash)};
+    Disassembler second {cache.analyse(rom, hash)};
+
+    EXPECT_EQ(cache.misses, 1);
+    EXPECT_EQ(cache.hits, 1);
+    EXPECT_EQ(second.blocks().size(), first.blocks().size());
+    EXPECT_TRUE(std::ranges::equal(second.flags(), first.flags()));
+    EXPECT_EQ(second.octo(), first.octo());
+}
+
+TEST_F(AnalysisCacheTest, differentRomIsAMiss)
+{
+    AnalysisCache cache {dir};
+    cache.analyse(rom, hash);
+
+    std::vector<std::uint8_t> other {rom};
+    other[1] = 0x0A;
+    EXPECT_NE(Memory::hash(other), hash);
+    EXPECT_FALSE(cache.load(other, Memory::hash(other)).has_value());
+}
+
+TEST_F(AnalysisCacheTest, corruptEntryIsIgnored)
+{
+    AnalysisCache cache {dir};
+    cache.analyse(rom, hash);
+    std::ofstream {cache.entry(hash), std::ios::binary | std::ios::trunc} << "S8CF";
+
+    EXPECT_FALSE(cache.load(rom, hash).has_value());
+    cache.analyse(rom, hash);
+    EXPECT_EQ(cache.misses, 2);
+    EXPECT_TRUE(cache.load(rom, hash).has_value());
+}
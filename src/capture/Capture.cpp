@@ -0,0 +1,328 @@
+#include "Capture.h"
+#include <algorithm>
+#include <cctype>
+#include <format>
+#include <iterator>
+#include <span>
+#include "../display/Display.h"
+
+namespace {
+    // GIF can't show a frame for less than 2/100 s, a shorter one is replaced by the frame after it
+    constexpr int minDelay {2};
+
+    // hundredths of a second from the start to frame n at 60 frames per second
+    int centiseconds(std::uint64_t n)
+    {
+        return static_cast<int>((n * 100 + 30) / 60);
+    }
+
+    void put16(std::vector<std::uint8_t>& out, int value)
+    {
+        out.push_back(value & 0xFF);
+        out.push_back(value >> 8 & 0xFF);
+    }
+
+    // GIF's LZW: codes from minCodeSize + 1 up to 12 bits wide, packed from the least significant bit and cut
+    // into sub-blocks of at most 255 bytes.
+    void lzw(std::span<const std::uint8_t> indices, int minCodeSize, std::vector<std::uint8_t>& out)
+    {
+        const int colors {1 << minCodeSize};
+        const int clear {colors};
+        const int end {clear + 1};
+        // next code of every (code, index) pair, valid when the top bits match the generation, so that clearing
+        // the dictionary doesn't have to touch it
+        static thread_local std::vector<std::uint32_t> children;
+        static thread_local std::uint32_t generation {0};
+        if (children.size() != 4096 * static_cast<std::size_t>(colors) or ++generation == 1 << 20) {
+            children.assign(4096 * colors, 0);
+            generation = 1;
+        }
+
+        std::vector<std::uint8_t> packed;
+        std::uint32_t bits {0};
+        int count {0};
+        int codeSize {minCodeSize + 1};
+        auto emit {[&](int code) {
+            bits |= static_cast<std::uint32_t>(code) << count;
+            count += codeSize;
+            for (; count >= 8; count -= 8, bits >>= 8)
+                packed.push_back(bits & 0xFF);
+        }};
+
+        emit(clear);
+        int last {end};
+        int prefix {indices[0]};
+        for (std::size_t k {1}; k != indices.size(); ++k) {
+            std::uint32_t& child {children[prefix * colors + indices[k]]};
+            if (child >> 12 == generation) {
+                prefix = static_cast<int>(child & 0xFFF);
+                continue;
+            }
+            emit(prefix);
+            child = generation << 12 | ++last;
+            if (last >= 1 << codeSize)
+                ++codeSize;
+            if (last == 4095) {
+                emit(clear);
+                if (++generation == 1 << 20) {
+                    std::ranges::fill(children, 0);
+                    generation = 1;
+                }
+                codeSize = minCodeSize + 1;
+                last = end;
+            }
+            prefix = indices[k];
+        }
+        emit(prefix);
+        emit(end);
+        if (count > 0)
+            packed.push_back(bits & 0xFF);
+
+        out.push_back(minCodeSize);
+        for (std::size_t k {0}; k < packed.size(); k += 255) {
+            std::size_t n {std::min<std::size_t>(255, packed.size() - k)};
+            out.push_back(static_cast<std::uint8_t>(n));
+            out.insert(out.end(), packed.begin() + k, packed.begin() + k + n);
+        }
+        out.push_back(0);
+    }
+}
+
+Capture::Capture(const std::filesystem::path& file) : out_{file, std::ios::binary}
+{
+    if (!out_.is_open())
+        return;
+
+    std::string ext {file.extension().string()};
+    std::ranges::transform(ext, ext.begin(), [](unsigned char c) { return std::tolower(c); });
+    format_ = ext == ".gif" ? Format::gif : ext == ".y4m" ? Format::y4m : Format::rgba;
+    // the emulation thread never allocates, even for MEGA-CHIP
+    for (Frame& frame : frames_)
+        frame.pixels.reserve(Display::megaWidth * Display::megaHeight);
+    open_ = true;
+    encoder_ = std::jthread {[this] { encode_(); }};
+}
+
+Capture::~Capture()
+{
+    if (!open_)
+        return;
+    head_.fetch_or(closing_, std::memory_order_release);
+    head_.notify_one();
+    encoder_.join();
+}
+
+bool Capture::submit(const Display& display)
+{
+    if (!open_)
+        return false;
+
+    std::uint64_t head {head_.load(std::memory_order_relaxed)};
+    std::uint64_t tail {tail_.load(std::memory_order_acquire)};
+    while (head - tail == queueSize) {
+        if (!lossless) {
+            ++dropped_;
+            return false;
+        }
+        tail_.wait(tail, std::memory_order_acquire);
+        tail = tail_.load(std::memory_order_acquire);
+    }
+
+    Frame& frame {frames_[head % queueSize]};
+    frame.width = display.width;
+    frame.height = display.height;
+    frame.pixels.resize(frame.width * frame.height);
+    for (int y {0}; y != frame.height; ++y)
+        std::ranges::copy(display.row(y), frame.pixels.begin() + y * frame.width);
+    frame.colorCount = display.mega() ? 256 : 4;
+    for (int c {0}; c != frame.colorCount; ++c)
+        frame.colors[c] = display.colorOf(c);
+
+    head_.store(head + 1, std::memory_order_release);
+    head_.notify_one();
+    return true;
+}
+
+void Capture::encode_()
+{
+    for (std::uint64_t tail {0};;) {
+        std::uint64_t head {head_.load(std::memory_order_acquire)};
+        if ((head & ~closing_) == tail) {
+            if (head & closing_)
+                break;
+            head_.wait(head, std::memory_order_acquire);
+            continue;
+        }
+
+        const Frame& frame {frames_[tail % queueSize]};
+        scale_(frame);
+        switch (format_) {
+            case Format::gif: writeGif_(frame); break;
+            case Format::y4m: writeY4m_(frame); break;
+            case Format::rgba: writeRgba_(frame); break;
+        }
+        ++encoded_;
+        tail_.store(++tail, std::memory_order_release);
+        tail_.notify_one();
+    }
+
+    if (format_ == Format::gif) {
+        flushGif_();
+        out_.put(0x3B); // trailer
+    }
+    out_.flush();
+}
+
+void Capture::scale_(const Frame& frame)
+{
+    int scale {std::max(1, canvasWidth / frame.width)};
+    if (canvas_.empty()) {
+        canvasW_ = frame.width * scale;
+        canvasH_ = frame.height * scale;
+        canvas_.resize(canvasW_ * canvasH_);
+    }
+
+    int width {std::min(frame.width * scale, canvasW_)};
+    for (int y {0}; y < canvasH_; y += scale) {
+        std::uint8_t* dst {canvas_.data() + y * canvasW_};
+        if (y / scale >= frame.height) {
+            std::fill(dst, canvas_.data() + canvas_.size(), 0);
+            break;
+        }
+        // every pixel becomes a run, which the compiler writes with wide stores, and the rest of the rows copies
+        const std::uint8_t* src {frame.pixels.data() + y / scale * frame.width};
+        for (int x {0}; x * scale < width; ++x)
+            std::fill_n(dst + x * scale, std::min(scale, width - x * scale), src[x]);
+        std::fill(dst + width, dst + canvasW_, 0);
+        for (int r {1}; r != scale and y + r < canvasH_; ++r)
+            std::copy_n(dst, canvasW_, dst + r * canvasW_);
+    }
+}
+
+void Capture::writeGif_(const Frame& frame)
+{
+    auto sameColors {[&] {
+        return frame.colorCount == pendingColorCount_
+               and std::equal(frame.colors.begin(), frame.colors.begin() + frame.colorCount, pendingColors_.begin());
+    }};
+    // an unchanged frame only keeps the one before it on screen longer
+    if (hasPending_ and canvas_ == pending_ and sameColors())
+        return;
+
+    if (hasPending_ and centiseconds(encoded_) - centiseconds(pendingSince_) >= minDelay)
+        flushGif_();
+    if (!hasPending_)
+        pendingSince_ = encoded_;
+    pending_ = canvas_;
+    pendingColors_ = frame.colors;
+    pendingColorCount_ = frame.colorCount;
+    hasPending_ = true;
+}
+
+void Capture::flushGif_()
+{
+    if (!hasPending_)
+        return;
+    hasPending_ = false;
+    bytes_.clear();
+
+    bool first {shown_.empty()};
+    if (first) {
+        bytes_.insert(bytes_.end(), {'G', 'I', 'F', '8', '9', 'a'});
+        put16(bytes_, canvasW_);
+        put16(bytes_, canvasH_);
+        bytes_.insert(bytes_.end(), {0x00, 0x00, 0x00}); // no global color table
+        // loop forever
+        bytes_.insert(bytes_.end(), {0x21, 0xFF, 0x0B, 'N', 'E', 'T', 'S', 'C', 'A', 'P', 'E', '2', '.', '0', 0x03, 0x01, 0x00, 0x00, 0x00});
+    }
+
+    // only the rectangle that changed since the last frame written, the rest stays on screen
+    int left {0}, top {0}, right {canvasW_}, bottom {canvasH_};
+    if (!first and std::equal(pendingColors_.begin(), pendingColors_.begin() + pendingColorCount_, shownColors_.begin())) {
+        left = canvasW_;
+        right = 0;
+        bottom = 0;
+        top = canvasH_;
+        for (int y {0}; y != canvasH_; ++y) {
+            const std::uint8_t* a {pending_.data() + y * canvasW_};
+            const std::uint8_t* b {shown_.data() + y * canvasW_};
+            auto [ia, ib] {std::mismatch(a, a + canvasW_, b)};
+            if (ia == a + canvasW_)
+                continue;
+            top = std::min(top, y);
+            bottom = y + 1;
+            left = std::min(left, static_cast<int>(ia - a));
+            int last {canvasW_};
+            while (a[last - 1] == b[last - 1])
+                --last;
+            right = std::max(right, last);
+        }
+        if (left >= right) {
+            left = top = 0;
+            right = bottom = 1;
+        }
+    }
+
+    int delay {std::max(minDelay, centiseconds(encoded_) - centiseconds(pendingSince_))};
+    bytes_.insert(bytes_.end(), {0x21, 0xF9, 0x04, 0x04}); // graphic control, keep the frame in place
+    put16(bytes_, delay);
+    bytes_.insert(bytes_.end(), {0x00, 0x00});
+
+    int minCodeSize {pendingColorCount_ == 256 ? 8 : 2};
+    bytes_.push_back(0x2C);
+    put16(bytes_, left);
+    put16(bytes_, top);
+    put16(bytes_, right - left);
+    put16(bytes_, bottom - top);
+    bytes_.push_back(static_cast<std::uint8_t>(0x80 | (minCodeSize - 1))); // local color table
+    for (int c {0}; c != 1 << minCodeSize; ++c) {
+        std::uint32_t rgba {pendingColors_[c]};
+        bytes_.insert(bytes_.end(), {static_cast<std::uint8_t>(rgba >> 24), static_cast<std::uint8_t>(rgba >> 16),
+                                     static_cast<std::uint8_t>(rgba >> 8)});
+    }
+
+    std::vector<std::uint8_t> region;
+    region.reserve((right - left) * (bottom - top));
+    for (int y {top}; y != bottom; ++y)
+        region.insert(region.end(), pending_.begin() + y * canvasW_ + left, pending_.begin() + y * canvasW_ + right);
+    lzw(region, minCodeSize, bytes_);
+    out_.write(reinterpret_cast<const char*>(bytes_.data()), static_cast<std::streamsize>(bytes_.size()));
+
+    std::swap(shown_, pending_);
+    shownColors_ = pendingColors_;
+}
+
+void Capture::writeY4m_(const Frame& frame)
+{
+    if (encoded_ == 0)
+        out_ << std::format("YUV4MPEG2 W{:d} H{:d} F60:1 Ip A1:1 C444\n", canvasW_, canvasH_);
+
+    // BT.601 studio range, worked out once per color instead of once per pixel
+    std::array<std::array<std::uint8_t, 256>, 3> yuv {};
+    for (int c {0}; c != frame.colorCount; ++c) {
+        int r {static_cast<int>(frame.colors[c] >> 24)};
+        int g {static_cast<int>(frame.colors[c] >> 16 & 0xFF)};
+        int b {static_cast<int>(frame.colors[c] >> 8 & 0xFF)};
+        yuv[0][c] = static_cast<std::uint8_t>(((66 * r + 129 * g + 25 * b + 128) >> 8) + 16);
+        yuv[1][c] = static_cast<std::uint8_t>(((-38 * r - 74 * g + 112 * b + 128) >> 8) + 128);
+        yuv[2][c] = static_cast<std::uint8_t>(((112 * r - 94 * g - 18 * b + 128) >> 8) + 128);
+    }
+
+    bytes_.assign({'F', 'R', 'A', 'M', 'E', '\n'});
+    for (const auto& plane : yuv)
+        std::ranges::transform(canvas_, std::back_inserter(bytes_), [&](std::uint8_t pixel) { return plane[pixel]; });
+    out_.write(reinterpret_cast<const char*>(bytes_.data()), static_cast<std::streamsize>(bytes_.size()));
+}
+
+void Capture::writeRgba_(const Frame& frame)
+{
+    bytes_.resize(4 * canvas_.size());
+    for (std::size_t k {0}; k != canvas_.size(); ++k) {
+        std::uint32_t rgba {frame.colors[canvas_[k]]};
+        bytes_[4 * k] = rgba >> 24;
+        bytes_[4 * k + 1] = rgba >> 16 & 0xFF;
+        bytes_[4 * k + 2] = rgba >> 8 & 0xFF;
+        bytes_[4 * k + 3] = rgba & 0xFF;
+    }
+    out_.write(reinterpret_cast<const char*>(bytes_.data()), static_cast<std::streamsize>(bytes_.size()));
+}
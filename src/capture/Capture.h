@@ -0,0 +1,85 @@
+#ifndef CHIP_8_CAPTURE_H
+#define CHIP_8_CAPTURE_H
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <thread>
+#include <vector>
+
+class Display;
+
+// Records every frame to a file on a background thread, as an animated GIF, a Y4M video (.y4m) or raw RGBA frames
+// (anything else), chosen by the extension. The emulation thread only copies the framebuffer into a preallocated
+// slot of a single producer, single consumer queue. Upscaling, palette mapping and compression all happen on the
+// encoder thread. The output keeps the size of the first frame, later frames of another size are cropped or padded.
+class Capture {
+public:
+    enum class Format : std::uint8_t { gif, y4m, rgba };
+    static constexpr std::size_t queueSize {64}; // frames
+    static constexpr int canvasWidth {512}; // frames are scaled up by the largest integer factor that fits
+
+    explicit Capture(const std::filesystem::path& file);
+    // Encodes whatever is still queued and finishes the file.
+    ~Capture();
+    Capture(const Capture&) = delete;
+    Capture& operator=(const Capture&) = delete;
+
+    [[nodiscard]] bool isOpen() const { return open_; }
+    [[nodiscard]] Format format() const { return format_; }
+    // Queues the screen as it is now. When the encoder is a whole queue behind the frame is dropped, or with
+    // lossless set submit() waits for it instead, which suits running headless as fast as possible.
+    bool submit(const Display& display);
+    bool lossless {false};
+    // frames submit() had to drop so far
+    [[nodiscard]] unsigned long long dropped() const { return dropped_; }
+private:
+    static constexpr std::uint64_t closing_ {1ull << 63}; // set in head_ once no more frames are coming
+
+    struct Frame {
+        int width {0};
+        int height {0};
+        std::vector<std::uint8_t> pixels; // one byte per pixel, see Display::row()
+        std::array<std::uint32_t, 256> colors {}; // RGBA of every pixel value
+        int colorCount {4}; // 4 for bitplanes, 256 for a MEGA-CHIP palette
+    };
+
+    void encode_();
+    // upscales into canvas_, sizing the canvas to the first frame
+    void scale_(const Frame& frame);
+    void writeGif_(const Frame& frame);
+    void flushGif_();
+    void writeY4m_(const Frame& frame);
+    void writeRgba_(const Frame& frame);
+
+    std::ofstream out_;
+    Format format_ {Format::rgba};
+    bool open_ {false};
+    unsigned long long dropped_ {0};
+
+    std::array<Frame, queueSize> frames_ {};
+    std::atomic<std::uint64_t> head_ {0}; // frames submitted, and closing_
+    std::atomic<std::uint64_t> tail_ {0}; // frames encoded
+
+    // encoder thread only
+    int canvasW_ {0};
+    int canvasH_ {0};
+    std::vector<std::uint8_t> canvas_; // the current frame scaled up, one byte per pixel
+    std::uint64_t encoded_ {0};
+    // gif frames wait here until the next different one says how long they stay on screen
+    std::vector<std::uint8_t> pending_;
+    std::array<std::uint32_t, 256> pendingColors_ {};
+    int pendingColorCount_ {4};
+    std::uint64_t pendingSince_ {0}; // frame number it first appeared on
+    bool hasPending_ {false};
+    std::vector<std::uint8_t> shown_; // last gif frame written, later ones only encode what changed
+    std::array<std::uint32_t, 256> shownColors_ {};
+    std::vector<std::uint8_t> bytes_; // output buffer
+
+    std::jthread encoder_; // last, so it stops before anything it uses is destroyed
+};
+
+
+#endif //CHIP_8_CAPTURE_H
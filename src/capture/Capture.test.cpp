@@ -0,0 +1,67 @@
+#include <gtest/gtest.h>
+#include <fstream>
+#include <iterator>
+#include "Capture.h"
+#include "../display/Display.h"
+
+class CaptureTest : public testing::Test {
+protected:
+    CaptureTest() {
+        std::filesystem::create_directories(dir);
+    }
+    ~CaptureTest() override {
+        std::filesystem::remove_all(dir);
+    }
+
+    static std::vector<std::uint8_t> contents(const std::filesystem::path& file) {
+        std::ifstream in {file, std::ios::binary};
+        return {std::istreambuf_iterator<char> {in}, std::istreambuf_iterator<char> {}};
+    }
+
+    std::filesystem::path dir {std::filesystem::temp_directory_path() / "schip8-capture-test"};
+    Display display {};
+};
+
+TEST_F(CaptureTest, rawFramesAreScaledUp)
+{
+    {
+        Capture capture {dir / "out.rgba"};
+        ASSERT_TRUE(capture.isOpen());
+        capture.lossless = true;
+        capture.submit(display);
+        display.flipPixel(1, 0);
+        capture.submit(display);
+    }
+    std::vector<std::uint8_t> bytes {contents(dir / "out.rgba")};
+    ASSERT_EQ(bytes.size(), 2 * 512 * 256 * 4);
+
+    auto rgba {[&](int frame, int x, int y) {
+        std::size_t k {4 * (static_cast<std::size_t>(frame) * 512 * 256 + y * 512 + x)};
+        return static_cast<std::uint32_t>(bytes[k] << 24 | bytes[k + 1] << 16 | bytes[k + 2] << 8 | bytes[k + 3]);
+    }};
+    EXPECT_EQ(rgba(0, 8, 0), display.colorOf(0));
+    EXPECT_EQ(rgba(1, 8, 0), display.colorOf(1));
+    EXPECT_EQ(rgba(1, 15, 7), display.colorOf(1));
+    EXPECT_EQ(rgba(1, 16, 0), display.colorOf(0));
+    EXPECT_EQ(rgba(1, 8, 8), display.colorOf(0));
+}
+
+TEST_F(CaptureTest, gifHasHeaderAndTrailer)
+{
+    {
+        Capture capture {dir / "out.gif"};
+        ASSERT_EQ(capture.format(), Capture::Format::gif);
+        capture.lossless = true;
+        for (int f {0}; f != 10; ++f) {
+            display.flipPixel(f, f);
+            capture.submit(display);
+        }
+        EXPECT_EQ(capture.dropped(), 0);
+    }
+    std::vector<std::uint8_t> bytes {contents(dir / "out.gif")};
+    ASSERT_GT(bytes.size(), 13);
+    EXPECT_EQ(std::string(bytes.begin(), bytes.begin() + 6), "GIF89a");
+    EXPECT_EQ(bytes[6] | bytes[7] << 8, 512);
+    EXPECT_EQ(bytes[8] | bytes[9] << 8, 256);
+    EXPECT_EQ(bytes.back(), 0x3B);
+}
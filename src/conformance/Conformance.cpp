@@ -0,0 +1,192 @@
+#include "Conformance.h"
+#include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <experimental/random>
+#include <format>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <thread>
+#include <tuple>
+#include "../io/MappedFile.h"
+#include "../machine/Machine.h"
+#include "../verify/Shadow.h"
+
+Conformance::Movie Conformance::defaultMovie()
+{
+    Movie movie;
+    for (int key {0}; key != 16; ++key) {
+        movie.emplace_back(120 + 16 * key, 1 << key);
+        movie.emplace_back(128 + 16 * key, 0);
+    }
+    return movie;
+}
+
+std::optional<Conformance::Movie> Conformance::loadMovie(const std::filesystem::path& file)
+{
+    std::ifstream in {file};
+    if (!in.is_open())
+        return std::nullopt;
+
+    Movie movie;
+    std::string line;
+    while (std::getline(in, line)) {
+        line = line.substr(0, line.find('#'));
+        std::istringstream fields {line};
+        int frame {};
+        std::string keys;
+        if (!(fields >> frame >> keys))
+            continue;
+        std::uint16_t mask {0};
+        std::from_chars(keys.data(), keys.data() + keys.size(), mask, 16);
+        movie.emplace_back(frame, mask);
+    }
+    std::ranges::stable_sort(movie, {}, &Movie::value_type::first);
+    return movie;
+}
+
+std::vector<Conformance::Checkpoint> Conformance::run(std::span<const std::uint8_t> rom, std::string_view mode, const Movie& movie,
+                                                     std::string* divergence) const
+{
+    std::vector<Checkpoint> checkpoints;
+    Machine machine;
+    machine.interpreter.setLogging(false);
+    machine.keyboard.setHostKeys(false);
+    if (!machine.memory.load(rom) or !machine.interpreter.setMode(std::string(mode)))
+        return checkpoints;
+
+    std::optional<Shadow> lockstep;
+    if (shadow != 0)
+        lockstep.emplace(machine, Shadow::interpreted, shadow);
+    std::uint64_t hash {Memory::hash(rom)};
+    std::uint16_t keys {0};
+    auto next {movie.begin()};
+    for (int f {0}; f != frames; ++f) {
+        for (; next != movie.end() and next->first <= f; ++next)
+            keys = next->second;
+        if (lockstep) {
+            lockstep->setKeys(keys);
+            if (!lockstep->frame(cyclesPerFrame, 0x5C8 + f)) {
+                if (divergence)
+                    *divergence = lockstep->divergence()->report();
+                break;
+            }
+        } else {
+            machine.keyboard.setMask(keys);
+            std::experimental::reseed(0x5C8 + f);
+            machine.frame(cyclesPerFrame);
+        }
+        if ((f + 1) % every == 0)
+            checkpoints.push_back({hash, std::string(mode), f + 1, machine.display.stateHash()});
+    }
+    return checkpoints;
+}
+
+std::vector<Conformance::Checkpoint> Conformance::runAll(const std::vector<std::filesystem::path>& roms, const std::filesystem::path& movies,
+                                                        std::vector<std::string>* divergences) const
+{
+    std::size_t cases {roms.size() * std::size(modes)};
+    std::vector<std::vector<Checkpoint>> results(cases);
+    std::vector<std::string> diverged(cases);
+    std::atomic<std::size_t> next {0};
+    auto work {[&] {
+        for (std::size_t c {next++}; c < cases; c = next++) {
+            const std::filesystem::path& path {roms[c / std::size(modes)]};
+            MappedFile file {path};
+            if (!file.isOpen())
+                continue;
+            std::optional<Movie> movie {loadMovie(movies / (path.stem().string() + ".movie"))};
+            std::string_view mode {modes[c % std::size(modes)]};
+            results[c] = run(file.bytes(), mode, movie ? *movie : defaultMovie(), &diverged[c]);
+            for (Checkpoint& checkpoint : results[c])
+                checkpoint.name = path.filename().string();
+            if (!diverged[c].empty())
+                diverged[c] = std::format("{:s} in {:s} mode {:s}", path.filename().string(), mode, diverged[c]);
+        }
+    }};
+    {
+        unsigned n {threads == 0 ? std::max(1u, std::thread::hardware_concurrency()) : threads};
+        std::vector<std::jthread> pool;
+        for (unsigned t {1}; t < std::min<std::size_t>(n, cases); ++t)
+            pool.emplace_back(work);
+        work();
+    }
+
+    std::vector<Checkpoint> checkpoints;
+    for (std::vector<Checkpoint>& result : results)
+        std::ranges::move(result, std::back_inserter(checkpoints));
+    for (std::string& divergence : diverged) {
+        if (divergences and !divergence.empty())
+            divergences->push_back(std::move(divergence));
+    }
+    std::ranges::sort(checkpoints, {}, [](const Checkpoint& c) { return std::tie(c.rom, c.mode, c.frame); });
+    return checkpoints;
+}
+
+std::vector<Conformance::Checkpoint> Conformance::load(const std::filesystem::path& file)
+{
+    std::vector<Checkpoint> checkpoints;
+    std::ifstream in {file};
+    std::string line;
+    while (std::getline(in, line)) {
+        if (line.empty() or line[0] == '#')
+            continue;
+
+        // rom hash, mode, frame, screen hash, name
+        std::istringstream fields {line};
+        Checkpoint checkpoint;
+        std::string rom;
+        std::string screen;
+        if (!(fields >> rom >> checkpoint.mode >> checkpoint.frame >> screen))
+            continue;
+        std::from_chars(rom.data(), rom.data() + rom.size(), checkpoint.rom, 16);
+        std::from_chars(screen.data(), screen.data() + screen.size(), checkpoint.screen, 16);
+        std::getline(fields >> std::ws, checkpoint.name);
+        checkpoints.push_back(std::move(checkpoint));
+    }
+    std::ranges::sort(checkpoints, {}, [](const Checkpoint& c) { return std::tie(c.rom, c.mode, c.frame); });
+    return checkpoints;
+}
+
+bool Conformance::save(const std::filesystem::path& file, const std::vector<Checkpoint>& checkpoints)
+{
+    std::ofstream out {file};
+    out << "# rom hash\tmode\tframe\tscreen hash\tname\n";
+    for (const Checkpoint& c : checkpoints)
+        out << std::format("{:0>16x}\t{:s}\t{:d}\t{:0>16x}\t{:s}\n", c.rom, c.mode, c.frame, c.screen, c.name);
+    return static_cast<bool>(out);
+}
+
+std::vector<std::string> Conformance::compare(const std::vector<Checkpoint>& golden, const std::vector<Checkpoint>& actual)
+{
+    using Case = std::pair<std::uint64_t, std::string>;
+    auto group {[](const std::vector<Checkpoint>& checkpoints) {
+        std::map<Case, std::vector<const Checkpoint*>> cases;
+        for (const Checkpoint& c : checkpoints)
+            cases[{c.rom, c.mode}].push_back(&c);
+        return cases;
+    }};
+    std::map<Case, std::vector<const Checkpoint*>> expected {group(golden)};
+    std::map<Case, std::vector<const Checkpoint*>> got {group(actual)};
+
+    std::vector<std::string> failures;
+    for (const auto& [key, checkpoints] : expected) {
+        std::string name {std::format("{:s} ({:0>16x}) in {:s} mode", checkpoints.front()->name, key.first, key.second)};
+        auto it {got.find(key)};
+        if (it == got.end()) {
+            failures.push_back(std::format("{:s}: not run", name));
+            continue;
+        }
+
+        const std::vector<const Checkpoint*>& run {it->second};
+        auto [e, a] {std::ranges::mismatch(checkpoints, run, [](const Checkpoint* x, const Checkpoint* y) {
+            return x->frame == y->frame and x->screen == y->screen;
+        })};
+        if (e != checkpoints.end() and a != run.end())
+            failures.push_back(std::format("{:s}: frame {:d} hashes to {:0>16x}, golden {:0>16x}", name, (*a)->frame, (*a)->screen, (*e)->screen));
+        else if (e != checkpoints.end() or a != run.end())
+            failures.push_back(std::format("{:s}: {:d} checkpoints, golden has {:d}", name, run.size(), checkpoints.size()));
+    }
+    return failures;
+}
@@ -0,0 +1,64 @@
+#ifndef CHIP_8_CONFORMANCE_H
+#define CHIP_8_CONFORMANCE_H
+
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+// Runs roms headless under every mode while playing back an input movie, and hashes the screen every few frames.
+// Comparing those hashes with golden ones recorded earlier shows whether a change to the interpreter changed what
+// any rom does. Cxnn is seeded from the frame number every frame, the hashes hold for one standard library's random
+// engine.
+class Conformance {
+public:
+    // keys held from a frame on, bit n is key n, sorted by frame
+    using Movie = std::vector<std::pair<int, std::uint16_t>>;
+
+    struct Checkpoint {
+        std::uint64_t rom {0}; // see Memory::hash()
+        std::string mode; // see Interpreter::setMode()
+        int frame {0}; // frames run
+        std::uint64_t screen {0}; // Display::stateHash()
+        std::string name; // of the rom file, only for people reading the golden file
+
+        bool operator==(const Checkpoint&) const = default;
+    };
+
+    static constexpr std::string_view modes[] {"default", "superchip", "xochip", "megachip"};
+
+    int frames {600};
+    int every {60}; // frames between checkpoints
+    int cyclesPerFrame {20};
+    unsigned threads {0}; // 0 uses every core
+    // instructions between checks of Interpreter::run() against the reference interpreter, 0 doesn't check, see Shadow
+    int shadow {0};
+
+    // Nothing for two seconds, then every key in turn, down for 8 frames and up for 8.
+    static Movie defaultMovie();
+    // Lines of a frame number and the keys held from then on as a hex mask, # starts a comment.
+    static std::optional<Movie> loadMovie(const std::filesystem::path& file);
+
+    // The checkpoints of one rom in one mode, none if it doesn't load. With shadow set, they stop where the two
+    // interpreters diverge and divergence gets the report.
+    [[nodiscard]] std::vector<Checkpoint> run(std::span<const std::uint8_t> rom, std::string_view mode, const Movie& movie,
+                                              std::string* divergence = nullptr) const;
+    // Every rom in every mode, in parallel. A rom plays movies/<its name>.movie if there is one, the default movie
+    // otherwise. Sorted like load() returns them. Divergences get a report of each case that diverged.
+    [[nodiscard]] std::vector<Checkpoint> runAll(const std::vector<std::filesystem::path>& roms, const std::filesystem::path& movies,
+                                                 std::vector<std::string>* divergences = nullptr) const;
+
+    // golden files are sorted by rom, mode and frame
+    static std::vector<Checkpoint> load(const std::filesystem::path& file);
+    static bool save(const std::filesystem::path& file, const std::vector<Checkpoint>& checkpoints);
+    // One line per rom and mode whose checkpoints differ from the golden ones, naming the first frame they differ
+    // at. Golden cases that weren't run count, roms run without golden hashes don't.
+    static std::vector<std::string> compare(const std::vector<Checkpoint>& golden, const std::vector<Checkpoint>& actual);
+};
+
+
+#endif //CHIP_8_CONFORMANCE_H
@@ -0,0 +1,94 @@
+#include <gtest/gtest.h>
+#include <filesystem>
+#include <fstream>
+#include "Conformance.h"
+
+class ConformanceTest : public testing::Test {
+protected:
+    ConformanceTest() {
+        conformance.frames = 40;
+        conformance.every = 10;
+    }
+
+    // 200: v0 := random 0x3F, 202: v2 := 5, 204: if v2 -key then jump 200, 208: i := hex v2,
+    // 20A: sprite v0 v0 5, 20C: jump 200. Draws a 5 somewhere random while key 5 is held.
+    std::vector<std::uint8_t> rom {0xC0, 0x3F, 0x62, 0x05, 0xE2, 0x9E, 0x12, 0x00, 0xF2, 0x29, 0xD0, 0x05, 0x12, 0x00};
+    Conformance conformance;
+};
+
+TEST_F(ConformanceTest, runsAreRepeatable)
+{
+    Conformance::Movie movie {{5, 1 << 5}, {25, 0}};
+    std::vector<Conformance::Checkpoint> first {conformance.run(rom, "default", movie)};
+    std::vector<Conformance::Checkpoint> second {conformance.run(rom, "default", movie)};
+
+    ASSERT_EQ(first.size(), 4);
+    EXPECT_EQ(first, second);
+    EXPECT_EQ(first.back().frame, 40);
+    EXPECT_NE(first.front().screen, 0);
+}
+
+TEST_F(ConformanceTest, shadowingKeepsTheHashes)
+{
+    Conformance::Movie movie {{5, 1 << 5}, {25, 0}};
+    std::vector<Conformance::Checkpoint> plain {conformance.run(rom, "xochip", movie)};
+    conformance.shadow = 15;
+    std::string divergence;
+    std::vector<Conformance::Checkpoint> shadowed {conformance.run(rom, "xochip", movie, &divergence)};
+
+    EXPECT_EQ(shadowed, plain);
+    EXPECT_EQ(divergence, "");
+}
+
+TEST_F(ConformanceTest, moviesChangeTheOutcome)
+{
+    std::vector<Conformance::Checkpoint> idle {conformance.run(rom, "default", {})};
+    std::vector<Conformance::Checkpoint> pressed {conformance.run(rom, "default", {{0, 1 << 5}, {25, 0}})};
+
+    EXPECT_EQ(idle.back().screen, 0);
+    EXPECT_NE(pressed.back().screen, 0);
+}
+
+TEST_F(ConformanceTest, moviesAreReadFromText)
+{
+    std::filesystem::path file {std::filesystem::temp_directory_path() / "schip8-conformance-test.movie"};
+    {
+        std::ofstream out {file};
+        out << "# frame keys\n60 0020\n\n10 8001 # both\n";
+    }
+    std::optional<Conformance::Movie> movie {Conformance::loadMovie(file)};
+    std::filesystem::remove(file);
+
+    ASSERT_TRUE(movie);
+    EXPECT_EQ(*movie, (Conformance::Movie {{10, 0x8001}, {60, 0x0020}}));
+    EXPECT_FALSE(Conformance::loadMovie(file));
+}
+
+TEST_F(ConformanceTest, goldenFilesRoundTrip)
+{
+    std::vector<Conformance::Checkpoint> checkpoints {conformance.run(rom, "superchip", {{0, 1 << 5}})};
+    for (Conformance::Checkpoint& checkpoint : checkpoints)
+        checkpoint.name = "test rom.ch8";
+    std::filesystem::path file {std::filesystem::temp_directory_path() / "schip8-conformance-test.tsv"};
+    ASSERT_TRUE(Conformance::save(file, checkpoints));
+    std::vector<Conformance::Checkpoint> loaded {Conformance::load(file)};
+    std::filesystem::remove(file);
+
+    EXPECT_EQ(loaded, checkpoints);
+    EXPECT_TRUE(Conformance::compare(loaded, checkpoints).empty());
+}
+
+TEST_F(ConformanceTest, compareNamesTheFirstDifference)
+{
+    std::vector<Conformance::Checkpoint> golden {conformance.run(rom, "default", {{0, 1 << 5}})};
+    std::vector<Conformance::Checkpoint> actual {golden};
+    actual[2].screen ^= 1;
+    actual[3].screen ^= 1;
+
+    std::vector<std::string> failures {Conformance::compare(golden, actual)};
+    ASSERT_EQ(failures.size(), 1);
+    EXPECT_NE(failures[0].find("frame 30 hashes to"), std::string::npos);
+    EXPECT_EQ(Conformance::compare(golden, {}).size(), 1);
+    // roms without golden hashes aren't failures
+    EXPECT_TRUE(Conformance::compare({}, actual).empty());
+}
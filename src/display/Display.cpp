@@ -1,14 +1,76 @@
 #include "Display.h"
 #include <algorithm>
-#include <iostream>
 #include <format>
+#include "../log/Log.h"
+#include "../telemetry/Telemetry.h"
 
 bool onError()
 {
-    std::cerr << std::format("SDL_Error: {:s}\n", SDL_GetError());
+    Log::global().write(Log::Level::error, "display", "sdl_error", "{:s}", SDL_GetError());
     return false;
 }
 
+namespace {
+    // Blends n colors of src into dst one byte at a time where mask is set. Written without branches on the
+    // pixels so that the compiler turns it into SIMD, the channel order doesn't matter.
+    template<typename F>
+    void blendBytes(std::uint32_t* dst, const std::uint32_t* src, const std::uint32_t* mask, std::size_t n, F f)
+    {
+        auto* d {reinterpret_cast<std::uint8_t*>(dst)};
+        auto* s {reinterpret_cast<const std::uint8_t*>(src)};
+        auto* m {reinterpret_cast<const std::uint8_t*>(mask)};
+        for (std::size_t k {0}; k != 4 * n; ++k) {
+            auto blended {static_cast<std::uint8_t>(f(d[k], s[k]))};
+            d[k] = (blended & m[k]) | (d[k] & ~m[k]);
+        }
+    }
+
+    void blendRow(Display::Blend mode, std::uint32_t* dst, const std::uint32_t* src, const std::uint32_t* mask, std::size_t n)
+    {
+        switch (mode) {
+            case Display::normal:
+                return blendBytes(dst, src, mask, n, [](unsigned, unsigned s) { return s; });
+            case Display::quarter:
+                return blendBytes(dst, src, mask, n, [](unsigned d, unsigned s) { return (3 * d + s) >> 2; });
+            case Display::half:
+                return blendBytes(dst, src, mask, n, [](unsigned d, unsigned s) { return (d + s) >> 1; });
+            case Display::threeQuarters:
+                return blendBytes(dst, src, mask, n, [](unsigned d, unsigned s) { return (d + 3 * s) >> 2; });
+            case Display::additive:
+                return blendBytes(dst, src, mask, n, [](unsigned d, unsigned s) { return std::min(d + s, 0xFFu); });
+            case Display::multiply:
+                return blendBytes(dst, src, mask, n, [](unsigned d, unsigned s) { return d * s / 0xFF; });
+        }
+    }
+}
+
+Display::Display(const Display& other)
+    : blocks_{other.blocks_}, currScale_{other.currScale_}, width_{other.width_}, height_{other.height_},
+      planes_{other.planes_}, used_{other.used_}, stateHash_{other.stateHash_}, mega_{other.mega_},
+      blend_{other.blend_}, alpha_{other.alpha_}, colors_{other.colors_}, blended_{other.blended_},
+      colorHash_{other.colorHash_}
+{
+}
+
+void Display::mirror(const Display& other)
+{
+    if (other.width_ != width_ or other.height_ != height_)
+        resize_(other.width_, other.height_);
+    blocks_ = other.blocks_;
+    currScale_ = other.currScale_;
+    planes_ = other.planes_;
+    used_ = other.used_;
+    stateHash_ = other.stateHash_;
+    mega_ = other.mega_;
+    blend_ = other.blend_;
+    alpha_ = other.alpha_;
+    colors_ = other.colors_;
+    blended_ = other.blended_;
+    colorHash_ = other.colorHash_;
+    dirtyTop_ = 0;
+    dirtyBottom_ = height_;
+}
+
 bool Display::on() {
     window_ = SDL_CreateWindow(
             "SCHIP-8",
@@ -50,14 +112,39 @@ void Display::off() {
 
 void Display::setResolution(int newScale)
 {
+    // clears every plane, not only the selected ones
+    std::uint8_t planes {planes_};
+    planes_ = 3;
     clear();
-    if (currScale_ == newScale)
+    planes_ = planes;
+    if (currScale_ == newScale and !mega_)
         return;
-    SDL_DestroyTexture(texture_);
 
     currScale_ = newScale;
-    width_ = screenWidth_ * currScale_;
-    height_ = screenHeight_ * currScale_;
+    mega_ = false;
+    blended_ = {};
+    resize_(screenWidth_ * currScale_, screenHeight_ * currScale_);
+}
+
+void Display::setMega(bool on)
+{
+    if (!on)
+        return setResolution(1);
+    if (mega_)
+        return clear();
+    mega_ = true;
+    resize_(megaWidth, megaHeight);
+}
+
+void Display::resize_(int width, int height)
+{
+    width_ = width;
+    height_ = height;
+    reset_();
+    if (!renderer_)
+        return; // headless
+
+    SDL_DestroyTexture(texture_);
     texture_ = SDL_CreateTexture(renderer_,
                                  SDL_PIXELFORMAT_RGBA8888,
                                  SDL_TEXTUREACCESS_STREAMING,
@@ -65,57 +152,310 @@ void Display::setResolution(int newScale)
     SDL_RenderSetLogicalSize(renderer_, width_, height_);
     if (!texture_)
         onError();
-    buffer_.resize(width_ * height_);
 }
 
 void Display::draw() {
-    std::uint32_t* pixels {nullptr};
-    int pitch {};
+    if (!texture_)
+        return; // headless
 
-    SDL_LockTexture(texture_, nullptr, (void**) &pixels, &pitch);
-    for (auto pixel : buffer_)
-        *pixels++ = pixel ? colorOn_ : colorOff_;
-    SDL_UnlockTexture(texture_);
+    // only the rows that changed since the last frame are converted and uploaded
+    if (dirtyTop_ < dirtyBottom_) {
+        SDL_Rect rect {0, dirtyTop_, width_, dirtyBottom_ - dirtyTop_};
+        void* locked {nullptr};
+        int pitch {};
+        SDL_LockTexture(texture_, &rect, &locked, &pitch);
+        for (int y {dirtyTop_}; y != dirtyBottom_; ++y) {
+            auto* pixels {reinterpret_cast<std::uint32_t*>(static_cast<std::uint8_t*>(locked) + (y - dirtyTop_) * pitch)};
+            if (mega_)
+                std::copy_n(blended_.begin() + y * width_, width_, pixels);
+            else
+                std::ranges::transform(row(y), pixels, [](std::uint8_t pixel) { return palette_[pixel & 3]; });
+        }
+        SDL_UnlockTexture(texture_);
+        dirtyTop_ = height_;
+        dirtyBottom_ = 0;
+    }
+
+    if (telemetry_)
+        telemetry_->mark(Telemetry::upload);
 
     SDL_RenderClear(renderer_);
     SDL_RenderCopy(renderer_, texture_, nullptr, nullptr);
+    if (overlay_ and telemetry_)
+        drawOverlay_();
     SDL_RenderPresent(renderer_);
+    if (telemetry_) {
+        telemetry_->mark(Telemetry::present);
+        telemetry_->presented();
+    }
+}
+
+void Display::drawOverlay_()
+{
+    // by Telemetry::Phase
+    static constexpr std::uint32_t colors[Telemetry::phaseCount] {0xE0C040FF, 0x9C5ECCFF, 0x5ECC9CFF, 0x5E9CCCFF, 0x404040FF};
+    static constexpr int barWidth {2};
+    static constexpr int budgetHeight {48};
+
+    // drawn in window pixels rather than the screen's
+    int logicalWidth {};
+    int logicalHeight {};
+    SDL_RenderGetLogicalSize(renderer_, &logicalWidth, &logicalHeight);
+    SDL_RenderSetLogicalSize(renderer_, 0, 0);
+    int windowWidth {};
+    int windowHeight {};
+    SDL_GetRendererOutputSize(renderer_, &windowWidth, &windowHeight);
+
+    const std::vector<Telemetry::Frame>& frames {telemetry_->frames()};
+    std::size_t count {std::min<std::size_t>(frames.size(), windowWidth / barWidth)};
+    double scale {static_cast<double>(budgetHeight) / static_cast<double>(telemetry_->budget.count())};
+    for (std::size_t i {0}; i != count; ++i) {
+        const Telemetry::Frame& frame {frames[frames.size() - count + i]};
+        int y {windowHeight};
+        for (int phase {0}; phase != Telemetry::phaseCount and y > 0; ++phase) {
+            int height {std::min(static_cast<int>(frame.phases[phase] * scale + 0.5), y)};
+            SDL_SetRenderDrawColor(renderer_, colors[phase] >> 24, colors[phase] >> 16 & 0xFF, colors[phase] >> 8 & 0xFF, 0xFF);
+            SDL_Rect bar {static_cast<int>(i) * barWidth, y - height, barWidth, height};
+            SDL_RenderFillRect(renderer_, &bar);
+            y -= height;
+        }
+    }
+    // the deadline
+    SDL_SetRenderDrawColor(renderer_, 0xFF, 0x30, 0x30, 0xFF);
+    SDL_RenderDrawLine(renderer_, 0, windowHeight - budgetHeight, windowWidth, windowHeight - budgetHeight);
+
+    SDL_SetRenderDrawColor(renderer_, 0x18, 0x14, 0x1C, 0xFF);
+    SDL_RenderSetLogicalSize(renderer_, logicalWidth, logicalHeight);
 }
 
 void Display::scrollDown(std::uint8_t n)
 {
-    std::shift_right(buffer_.begin(), buffer_.end(), n * width_);
-    std::fill(buffer_.begin(), buffer_.begin() + (n * width_), 0);
+    if (used_ & ~planes_)
+        return scrollPlanes_(0, n);
+    n = std::min<int>(n, height_);
+    for (int y {height_ - 1}; y >= n; --y) {
+        std::uint8_t* dst {mutableRow_(y)};
+        std::ranges::copy(row(y - n), dst);
+    }
+    for (int y {0}; y != n; ++y)
+        std::fill_n(mutableRow_(y), width_, 0);
+    if (mega_)
+        scrollColors_(0, n);
+    stateHash_ = pixelHash_(); // every pixel moves, nothing to gain from tracking them one by one
+}
+
+void Display::scrollUp(std::uint8_t n)
+{
+    if (used_ & ~planes_)
+        return scrollPlanes_(0, -n);
+    n = std::min<int>(n, height_);
+    for (int y {0}; y + n < height_; ++y) {
+        std::uint8_t* dst {mutableRow_(y)};
+        std::ranges::copy(row(y + n), dst);
+    }
+    for (int y {height_ - n}; y != height_; ++y)
+        std::fill_n(mutableRow_(y), width_, 0);
+    if (mega_)
+        scrollColors_(0, -n);
+    stateHash_ = pixelHash_();
 }
 
 void Display::scrollRight()
 {
-    for (int i {0}; i != width_ * height_; i += width_) {
-        auto row {buffer_.begin() + i};
+    if (used_ & ~planes_)
+        return scrollPlanes_(4, 0);
+    for (int y {0}; y != height_; ++y) {
+        std::uint8_t* row {mutableRow_(y)};
         std::shift_right(row, row + width_, 4);
         std::fill(row, row + 4, 0);
     }
+    if (mega_)
+        scrollColors_(4, 0);
+    stateHash_ = pixelHash_();
 }
 
 void Display::scrollLeft()
 {
-    for (int i {0}; i != width_ * height_; i += width_) {
-        auto row {buffer_.begin() + i};
+    if (used_ & ~planes_)
+        return scrollPlanes_(-4, 0);
+    for (int y {0}; y != height_; ++y) {
+        std::uint8_t* row {mutableRow_(y)};
         std::shift_left(row, row + width_, 4);
         std::fill(row + width_ - 4, row + width_, 0);
     }
+    if (mega_)
+        scrollColors_(-4, 0);
+    stateHash_ = pixelHash_();
+}
+
+void Display::scrollPlanes_(int dx, int dy)
+{
+    std::vector<std::uint8_t> before;
+    before.reserve(width_ * height_);
+    for (int y {0}; y != height_; ++y)
+        before.insert(before.end(), row(y).begin(), row(y).end());
+
+    for (int y {0}; y != height_; ++y) {
+        std::uint8_t* pixels {mutableRow_(y)};
+        for (int x {0}; x != width_; ++x) {
+            int sx {x - dx}, sy {y - dy};
+            bool inside {sx >= 0 and sx < width_ and sy >= 0 and sy < height_};
+            std::uint8_t moved {inside ? before[sx + sy * width_] : std::uint8_t {0}};
+            pixels[x] = (pixels[x] & ~planes_) | (moved & planes_);
+        }
+    }
+    stateHash_ = pixelHash_();
+}
+
+void Display::scrollColors_(int dx, int dy)
+{
+    // rows are contiguous, so a vertical scroll moves the whole layer at once
+    auto background {colors_[0]};
+    if (dy > 0) {
+        std::shift_right(blended_.begin(), blended_.end(), dy * width_);
+        std::fill_n(blended_.begin(), std::min(dy, height_) * width_, background);
+    } else if (dy < 0) {
+        std::shift_left(blended_.begin(), blended_.end(), -dy * width_);
+        std::fill(blended_.end() - std::min(-dy, height_) * width_, blended_.end(), background);
+    }
+    for (int y {0}; dx != 0 and y != height_; ++y) {
+        auto row {blended_.begin() + y * width_};
+        if (dx > 0) {
+            std::shift_right(row, row + width_, dx);
+            std::fill_n(row, dx, background);
+        } else {
+            std::shift_left(row, row + width_, -dx);
+            std::fill(row + width_ + dx, row + width_, background);
+        }
+    }
+}
+
+bool Display::blitRow(int x, int y, std::span<const std::uint8_t> indices, std::uint8_t collision)
+{
+    if (y < 0 or y >= height_ or x >= width_)
+        return false;
+    std::size_t n {std::min<std::size_t>(indices.size(), width_ - x)};
+    std::uint8_t* pixels {mutableRow_(y) + x};
+    int first {x + y * width_};
+
+    // indices first, which also gathers the colors and where they go for the blend below
+    std::array<std::uint32_t, megaWidth> src;
+    std::array<std::uint32_t, megaWidth> mask;
+    bool hit {false};
+    for (std::size_t k {0}; k != n; ++k) {
+        std::uint8_t index {indices[k]};
+        src[k] = colors_[index];
+        mask[k] = index == 0 ? 0 : 0xFFFFFFFF;
+        if (index == 0 or pixels[k] == index) {
+            hit |= index != 0 and index == collision;
+            continue;
+        }
+        hit |= pixels[k] == collision;
+        stateHash_ ^= zobrist::key(zobrist::pixel, first + k, pixels[k]) ^ zobrist::key(zobrist::pixel, first + k, index);
+        pixels[k] = index;
+    }
+    blendRow(blend_, blended_.data() + first, src.data(), mask.data(), n);
+    return hit;
+}
+
+void Display::setColor(std::uint8_t index, std::uint32_t rgba)
+{
+    colorHash_ ^= colorKey_(index, colors_[index]) ^ colorKey_(index, rgba);
+    colors_[index] = rgba;
+}
+
+std::uint64_t Display::colorKey_(int index, std::uint32_t rgba)
+{
+    auto key {[index](std::uint32_t c) {
+        return zobrist::key(zobrist::pixel, paletteKey_ + 2 * index, c >> 16)
+               ^ zobrist::key(zobrist::pixel, paletteKey_ + 2 * index + 1, c & 0xFFFF);
+    }};
+    return key(rgba) ^ key(defaultColor_(index));
+}
+
+bool Display::flipPixel(std::uint8_t x, std::uint8_t y, std::uint8_t planes)
+{
+    int index {(x + y * width_) % (width_ * height_)};
+    std::uint8_t& pixel {mutableRow_(index / width_)[index % width_]};
+    std::uint8_t temp {pixel};
+    pixel ^= planes;
+    used_ |= planes;
+    // each plane is hashed on its own, so flipping the first plane costs the same as on a single plane screen
+    if (planes & 1)
+        stateHash_ ^= zobrist::key(zobrist::pixel, index, 1);
+    if (planes & 2)
+        stateHash_ ^= zobrist::key(zobrist::pixel, index | secondPlane_, 1);
+    return temp & planes;
+}
+
+std::uint64_t Display::fullStateHash() const
+{
+    std::uint64_t h {pixelHash_()};
+    for (int c {0}; c != 256; ++c)
+        h ^= colorKey_(c, colors_[c]);
+    return h;
+}
+
+std::uint64_t Display::pixelHash_() const
+{
+    std::uint64_t h {0};
+    for (int y {0}; y != height_; ++y) {
+        std::span<const std::uint8_t> pixels {row(y)};
+        for (int x {0}; x != width_; ++x) {
+            if (mega_) {
+                h ^= zobrist::key(zobrist::pixel, x + y * width_, pixels[x]);
+                continue;
+            }
+            if (pixels[x] & 1)
+                h ^= zobrist::key(zobrist::pixel, x + y * width_, 1);
+            if (pixels[x] & 2)
+                h ^= zobrist::key(zobrist::pixel, (x + y * width_) | secondPlane_, 1);
+        }
+    }
+    return h;
+}
+
+std::size_t Display::privateBlocks() const
+{
+    return std::ranges::count_if(blocks_, [](const auto& block) { return block.use_count() == 1; });
+}
+
+std::uint8_t* Display::mutableRow_(int y)
+{
+    std::shared_ptr<Block>& block {blocks_[y / rowsPerBlock]};
+    if (block.use_count() != 1)
+        block = std::make_shared<Block>(*block); // copy on write
+    dirtyTop_ = std::min(dirtyTop_, y);
+    dirtyBottom_ = std::max(dirtyBottom_, y + 1);
+    return block->data() + (y % rowsPerBlock) * width_;
 }
 
-bool Display::flipPixel(std::uint8_t x, std::uint8_t y)
+void Display::reset_()
 {
-    std::uint8_t temp {buffer_[(x + y * width_) % (width_ * height_)]};
-    buffer_[(x + y * width_) % (width_ * height_)] ^= 1;
-    return temp;
+    // every block starts out as the same blank block and is copied when first drawn to
+    blocks_.assign(height_ / rowsPerBlock, std::make_shared<Block>(rowsPerBlock * width_));
+    used_ = 0;
+    stateHash_ = 0;
+    dirtyTop_ = 0;
+    dirtyBottom_ = height_;
+    if (mega_)
+        blended_.assign(width_ * height_, colors_[0]);
 }
 
 void Display::clear() {
-    SDL_RenderClear(renderer_);
-    SDL_RenderPresent(renderer_);
-    for (auto& pixel : buffer_)
-        pixel = 0;
+    if (used_ & ~planes_) {
+        // the other planes stay on screen
+        for (int y {0}; y != height_; ++y) {
+            std::uint8_t* pixels {mutableRow_(y)};
+            for (int x {0}; x != width_; ++x)
+                pixels[x] &= ~planes_;
+        }
+        stateHash_ = pixelHash_();
+        return;
+    }
+    if (renderer_) {
+        SDL_RenderClear(renderer_);
+        SDL_RenderPresent(renderer_);
+    }
+    reset_();
 }
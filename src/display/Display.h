@@ -1,38 +1,147 @@
 #ifndef CHIP_8_DISPLAY_H
 #define CHIP_8_DISPLAY_H
 
+#include <array>
 #include <vector>
 #include <cstdint>
+#include <memory>
+#include <span>
 #include "SDL.h"
+#include "../state/Zobrist.h"
 
+class Telemetry;
+
+// The framebuffer is split into blocks of rows that copies of a Display share until one of them draws.
+// Each pixel is a byte holding both XO-CHIP bitplanes, bit 0 for the first and bit 1 for the second, so
+// drawing to and scrolling both planes touches every pixel once. CHIP-8 only ever uses the first.
+// In MEGA-CHIP mode the screen is 256x192, each byte is instead an index into a palette of 256 colors and
+// sprites are blended a row at a time into a second layer of RGBA colors, which is what draw() shows.
 class Display {
 public:
+    static constexpr int rowsPerBlock {8};
+    static constexpr int megaWidth {256};
+    static constexpr int megaHeight {192};
+
+    // how sprite colors combine with the colors already on screen in MEGA-CHIP mode
+    enum Blend : std::uint8_t { normal, quarter, half, threeQuarters, additive, multiply };
+
+    Display() = default;
+    // Shares the framebuffer of other, never its window.
+    Display(const Display& other);
+    Display& operator=(const Display&) = delete;
+    // Shows the framebuffer of other from now on, sharing it like a copy does while keeping this window.
+    void mirror(const Display& other);
+
     bool on();
     void off();
+    // clears the selected planes
     void clear();
     void draw();
-    bool flipPixel(std::uint8_t, std::uint8_t);
+    // Flips the given planes of a pixel, returns whether any of them was lit.
+    bool flipPixel(std::uint8_t x, std::uint8_t y, std::uint8_t planes = 1);
+    // leaves MEGA-CHIP mode
     void setResolution(int);
+    // Switches to 256x192 and clears the screen, turning it off returns to 64x32.
+    void setMega(bool on);
+    [[nodiscard]] bool mega() const { return mega_; }
+    // Draws a row of palette indices from (x, y) in MEGA-CHIP mode, clipped at the edges. Index 0 is transparent,
+    // the others replace the index under them and blend their color. Returns whether any of them covered collision.
+    bool blitRow(int x, int y, std::span<const std::uint8_t> indices, std::uint8_t collision);
+    // scrolls move the selected planes only
     void scrollDown(std::uint8_t);
+    void scrollUp(std::uint8_t);
     void scrollRight();
     void scrollLeft();
+    // planes that clear, scroll and sprites affect, a mask of bits 0 and 1
+    void setPlanes(std::uint8_t planes) { planes_ = planes & 3; }
+    [[nodiscard]] std::uint8_t planes() const { return planes_; }
+    // MEGA-CHIP palette, RGBA like the texture. Entry 0 is the background.
+    void setColor(std::uint8_t index, std::uint32_t rgba);
+    void setBlend(std::uint8_t mode) { blend_ = mode <= multiply ? static_cast<Blend>(mode) : normal; }
+    [[nodiscard]] Blend blend() const { return blend_; }
+    // MEGA-CHIP screen alpha, kept as state but not applied
+    void setAlpha(std::uint8_t alpha) { alpha_ = alpha; }
+    [[nodiscard]] std::uint8_t alpha() const { return alpha_; }
+
+    // one byte per pixel, see above
+    [[nodiscard]] std::span<const std::uint8_t> row(int y) const {
+        return {blocks_[y / rowsPerBlock]->data() + (y % rowsPerBlock) * width_, static_cast<std::size_t>(width_)};
+    }
+    [[nodiscard]] bool pixel(int x, int y) const { return row(y)[x] != 0; }
+    // RGBA color of a pixel value as row() holds it, before any blending
+    [[nodiscard]] std::uint32_t colorOf(std::uint8_t value) const { return mega_ ? colors_[value] : palette_[value & 3]; }
+    // RGBA color draw() shows for a pixel
+    [[nodiscard]] std::uint32_t color(int x, int y) const {
+        return mega_ ? blended_[x + y * width_] : colorOf(row(y)[x]);
+    }
+    // Times the upload and present of every draw() from now on, nullptr stops. With overlay the recent frame times
+    // are drawn over the screen as stacked bars, a frame's budget tall.
+    void setTelemetry(Telemetry* telemetry, bool overlay) { telemetry_ = telemetry; overlay_ = overlay; }
+    // number of row blocks this instance doesn't share with any other
+    [[nodiscard]] std::size_t privateBlocks() const;
+    // Zobrist hash of the lit pixels and of the MEGA-CHIP palette, kept up to date by every change to either.
+    // Blended colors follow from those and aren't hashed.
+    [[nodiscard]] std::uint64_t stateHash() const { return stateHash_ ^ colorHash_; }
+    [[nodiscard]] std::uint64_t fullStateHash() const;
 
     const int& width {width_};
     const int& height {height_};
 private:
     static constexpr int screenWidth_ {64};
     static constexpr int screenHeight_ {32};
-    static constexpr long long colorOn_ {0x9C5ECCFF};
-    static constexpr long long colorOff_ {0x18141CFF};
+    // by plane mask: off, first plane, second plane, both
+    static constexpr std::uint32_t palette_[4] {0x18141CFF, 0x9C5ECCFF, 0x5ECC9CFF, 0xF2E6FAFF};
     static constexpr int scaleFactor_ {10};
+    static constexpr std::uint32_t secondPlane_ {1 << 16}; // added to the pixel index in hash keys
+    static constexpr std::uint32_t paletteKey_ {1 << 17}; // added to twice the palette index in hash keys
 
     SDL_Window* window_ {nullptr};
     SDL_Renderer* renderer_ {nullptr};
     SDL_Texture* texture_ {nullptr};
-    std::vector<std::uint8_t> buffer_ {std::vector<std::uint8_t>(screenWidth_ * screenHeight_)};
+    Telemetry* telemetry_ {nullptr};
+    bool overlay_ {false};
+    using Block = std::vector<std::uint8_t>;
+    // row y for writing, copying its block first if it is shared
+    std::uint8_t* mutableRow_(int y);
+    void reset_();
+    // blanks the framebuffer at a new size and recreates the texture to match
+    void resize_(int width, int height);
+    [[nodiscard]] std::uint64_t pixelHash_() const;
+    // hash of a palette entry relative to its default, so the default palette hashes to 0
+    [[nodiscard]] static std::uint64_t colorKey_(int index, std::uint32_t rgba);
+    // moves the blended colors along with the indices in MEGA-CHIP mode
+    void scrollColors_(int dx, int dy);
+    // moves the selected planes by dx, dy when other planes are in use, see scrollDown() for the usual case
+    void scrollPlanes_(int dx, int dy);
+    void drawOverlay_();
+
+    std::vector<std::shared_ptr<Block>> blocks_ {std::vector<std::shared_ptr<Block>>(
+            screenHeight_ / rowsPerBlock, std::make_shared<Block>(rowsPerBlock * screenWidth_))};
     int currScale_ {1};
     int width_ {screenWidth_};
     int height_ {screenHeight_};
+    std::uint8_t planes_ {1};
+    std::uint8_t used_ {0}; // planes drawn to since the framebuffer was last blank
+    std::uint64_t stateHash_ {0};
+    // rows changed since the last draw(), only those are uploaded to the texture
+    int dirtyTop_ {0};
+    int dirtyBottom_ {screenHeight_};
+
+    bool mega_ {false};
+    Blend blend_ {normal};
+    std::uint8_t alpha_ {0xFF};
+    std::array<std::uint32_t, 256> colors_ {defaultColors_()};
+    std::vector<std::uint32_t> blended_ {}; // by pixel, empty outside MEGA-CHIP mode
+    std::uint64_t colorHash_ {0}; // of the palette entries that differ from the default
+
+    // the plane colors, then white
+    static constexpr std::uint32_t defaultColor_(int index) { return index < 4 ? palette_[index] : 0xFFFFFFFF; }
+    static constexpr std::array<std::uint32_t, 256> defaultColors_() {
+        std::array<std::uint32_t, 256> colors {};
+        for (int c {0}; c != 256; ++c)
+            colors[c] = defaultColor_(c);
+        return colors;
+    }
 };
 
 
@@ -0,0 +1,146 @@
+#include "BatchEnv.h"
+#include <algorithm>
+#include <stdexcept>
+
+namespace {
+    // out of bounds accesses are only counted in checked mode
+    std::uint64_t faults(const Machine& machine)
+    {
+        return machine.interpreter.faults.undefined + machine.interpreter.faults.stack
+                + machine.interpreter.faults.outOfBounds;
+    }
+}
+
+unsigned BatchEnv::threads_(const schip8_env_config& config)
+{
+    unsigned n {config.threads == 0 ? std::max(1u, std::thread::hardware_concurrency()) : config.threads};
+    return std::clamp(n, 1u, std::max(config.count, 1u));
+}
+
+BatchEnv::BatchEnv(const schip8_env_config& config)
+    : initial_{std::make_unique<Machine>()}, frameSkip_{static_cast<int>(std::max(config.frame_skip, 1u))},
+      cyclesPerFrame_{config.cycles_per_frame == 0 ? 20 : static_cast<int>(config.cycles_per_frame)},
+      packed_{config.observation == SCHIP8_OBS_PACKED},
+      start_{threads_(config)}, done_{threads_(config)}
+{
+    Interpreter& interpreter {initial_->interpreter};
+    interpreter.setLogging(false);
+    // keys only come from step(), forks and resets inherit this
+    initial_->keyboard.setHostKeys(false);
+    interpreter.setChecked(config.checked != 0);
+    if (config.mode and !interpreter.setMode(config.mode))
+        throw std::invalid_argument("unknown mode");
+    if (config.quirks and !interpreter.setQuirks(config.quirks))
+        throw std::invalid_argument("unknown quirks");
+    if (config.observation != SCHIP8_OBS_U8 and config.observation != SCHIP8_OBS_PACKED)
+        throw std::invalid_argument("unknown observation format");
+    if (!config.rom or !initial_->memory.load({config.rom, config.rom_size}))
+        throw std::invalid_argument("rom doesn't fit in ram");
+
+    for (std::uint32_t r {0}; r != config.reward_count; ++r) {
+        if (config.reward_addresses[r] >= initial_->memory.size())
+            throw std::invalid_argument("reward address outside of ram");
+        rewards_.push_back({config.reward_addresses[r], config.reward_weights ? config.reward_weights[r] : 1.0f});
+    }
+
+    // every machine shares the initial machine's memory until it writes to it
+    for (std::uint32_t i {0}; i != config.count; ++i)
+        machines_.push_back(initial_->fork());
+    for (unsigned t {1}; t < threads_(config); ++t)
+        pool_.emplace_back([this] { work_(); });
+}
+
+BatchEnv::~BatchEnv()
+{
+    stopping_ = true;
+    start_.arrive_and_wait();
+}
+
+std::size_t BatchEnv::observationSize() const
+{
+    return SCHIP8_OBS_WIDTH * SCHIP8_OBS_HEIGHT / (packed_ ? 8 : 1);
+}
+
+void BatchEnv::observe_(const Machine& machine, std::uint8_t* out) const
+{
+    const Display& display {machine.display};
+    // lower resolutions are scaled up, MEGA-CHIP's is sampled down
+    auto source {[&](int x) { return x * display.width / SCHIP8_OBS_WIDTH; }};
+    for (int y {0}; y != SCHIP8_OBS_HEIGHT; ++y) {
+        std::span<const std::uint8_t> pixels {display.row(y * display.height / SCHIP8_OBS_HEIGHT)};
+        if (!packed_) {
+            for (int x {0}; x != SCHIP8_OBS_WIDTH; ++x)
+                *out++ = pixels[source(x)];
+            continue;
+        }
+        for (int x {0}; x != SCHIP8_OBS_WIDTH; x += 8) {
+            std::uint8_t byte {0};
+            for (int b {0}; b != 8; ++b)
+                byte = byte << 1 | (pixels[source(x + b)] != 0);
+            *out++ = byte;
+        }
+    }
+}
+
+void BatchEnv::stepOne_(std::size_t i)
+{
+    Machine& machine {*machines_[i]};
+    machine.keyboard.setMask(keys_[i]);
+    std::uint64_t faultsBefore {faults(machine)};
+    float reward {0};
+    for (const Reward& r : rewards_)
+        reward -= r.weight * machine.memory.read(r.address);
+
+    for (int f {0}; f != frameSkip_; ++f)
+        machine.frame(cyclesPerFrame_);
+
+    for (const Reward& r : rewards_)
+        reward += r.weight * machine.memory.read(r.address);
+    if (rewardsOut_)
+        rewardsOut_[i] = reward;
+    if (dones_)
+        dones_[i] = faults(machine) != faultsBefore;
+    if (observations_)
+        observe_(machine, observations_ + i * observationSize());
+}
+
+void BatchEnv::work_()
+{
+    for (;;) {
+        start_.arrive_and_wait();
+        if (stopping_)
+            return;
+        for (std::size_t i {next_++}; i < machines_.size(); i = next_++)
+            stepOne_(i);
+        done_.arrive_and_wait();
+    }
+}
+
+void BatchEnv::runAll_()
+{
+    next_ = 0;
+    start_.arrive_and_wait(); // publishes the step's arguments to the pool
+    for (std::size_t i {next_++}; i < machines_.size(); i = next_++)
+        stepOne_(i);
+    done_.arrive_and_wait();
+}
+
+void BatchEnv::step(const std::uint16_t* keys, std::uint8_t* observations, float* rewards, std::uint8_t* dones)
+{
+    keys_ = keys;
+    observations_ = observations;
+    rewardsOut_ = rewards;
+    dones_ = dones;
+    runAll_();
+}
+
+void BatchEnv::reset(const std::uint8_t* which, std::uint8_t* observations)
+{
+    for (std::size_t i {0}; i != machines_.size(); ++i) {
+        if (which and !which[i])
+            continue;
+        machines_[i] = initial_->fork();
+        if (observations)
+            observe_(*machines_[i], observations + i * observationSize());
+    }
+}
@@ -0,0 +1,64 @@
+#ifndef CHIP_8_BATCHENV_H
+#define CHIP_8_BATCHENV_H
+
+#include <atomic>
+#include <barrier>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <thread>
+#include <vector>
+#include "schip8_env.h"
+#include "../machine/Machine.h"
+
+// The machines behind schip8_env. Steps run on a pool of threads that lives as long as the environment,
+// and observations are written straight from the framebuffers into the caller's buffer.
+class BatchEnv {
+public:
+    // throws std::invalid_argument if the rom or an option is rejected
+    explicit BatchEnv(const schip8_env_config& config);
+    ~BatchEnv();
+    BatchEnv(const BatchEnv&) = delete;
+    BatchEnv& operator=(const BatchEnv&) = delete;
+
+    [[nodiscard]] std::size_t observationSize() const;
+    void step(const std::uint16_t* keys, std::uint8_t* observations, float* rewards, std::uint8_t* dones);
+    void reset(const std::uint8_t* which, std::uint8_t* observations);
+
+    [[nodiscard]] const Machine& machine(std::size_t i) const { return *machines_[i]; }
+private:
+    struct Reward {
+        std::uint16_t address;
+        float weight;
+    };
+
+    void observe_(const Machine& machine, std::uint8_t* out) const;
+    void stepOne_(std::size_t i);
+    // runs stepOne_ for every machine on the pool and the calling thread
+    void runAll_();
+    void work_();
+    // threads stepping machines, counting the caller
+    static unsigned threads_(const schip8_env_config& config);
+
+    std::unique_ptr<Machine> initial_;
+    std::vector<std::unique_ptr<Machine>> machines_;
+    std::vector<Reward> rewards_;
+    int frameSkip_;
+    int cyclesPerFrame_;
+    bool packed_;
+
+    // arguments of the step in progress
+    const std::uint16_t* keys_ {nullptr};
+    std::uint8_t* observations_ {nullptr};
+    float* rewardsOut_ {nullptr};
+    std::uint8_t* dones_ {nullptr};
+    std::atomic<std::size_t> next_ {0};
+
+    bool stopping_ {false};
+    std::barrier<> start_;
+    std::barrier<> done_;
+    std::vector<std::jthread> pool_;
+};
+
+
+#endif //CHIP_8_BATCHENV_H
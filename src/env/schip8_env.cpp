@@ -0,0 +1,40 @@
+#include "schip8_env.h"
+#include <stdexcept>
+#include "BatchEnv.h"
+
+struct schip8_env {
+    BatchEnv batch;
+};
+
+schip8_env* schip8_env_create(const schip8_env_config* config)
+{
+    if (!config)
+        return nullptr;
+    try {
+        return new schip8_env {BatchEnv {*config}};
+    } catch (const std::exception&) {
+        return nullptr; // exceptions must not cross the C boundary
+    }
+}
+
+void schip8_env_destroy(schip8_env* env)
+{
+    delete env;
+}
+
+size_t schip8_env_observation_size(const schip8_env* env)
+{
+    return env->batch.observationSize();
+}
+
+int schip8_env_step_batch(schip8_env* env, const uint16_t* keys, uint8_t* observations, float* rewards, uint8_t* dones)
+{
+    env->batch.step(keys, observations, rewards, dones);
+    return 0;
+}
+
+int schip8_env_reset(schip8_env* env, const uint8_t* which, uint8_t* observations)
+{
+    env->batch.reset(which, observations);
+    return 0;
+}
@@ -0,0 +1,71 @@
+#ifndef CHIP_8_SCHIP8_ENV_H
+#define CHIP_8_SCHIP8_ENV_H
+
+/* C interface for running many headless machines in lockstep, for reinforcement learning and other batch work.
+ * Every call on one environment must come from the same thread; the environment spreads the machines over its
+ * own threads. */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(_WIN32)
+#  define SCHIP8_API __declspec(dllexport)
+#else
+#  define SCHIP8_API __attribute__((visibility("default")))
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Observations are always 128x64, lores frames have every pixel doubled. */
+#define SCHIP8_OBS_WIDTH 128
+#define SCHIP8_OBS_HEIGHT 64
+
+enum schip8_obs_format {
+    SCHIP8_OBS_U8 = 0,     /* one byte per pixel, bit 0 for the first plane and bit 1 for XO-CHIP's second,
+                              the palette index for MEGA-CHIP, whose 256x192 screen is sampled down */
+    SCHIP8_OBS_PACKED = 1, /* one bit per pixel lit on any plane, leftmost pixel in the most significant bit */
+};
+
+typedef struct schip8_env_config {
+    const uint8_t* rom;
+    size_t rom_size;
+    uint32_t count;             /* number of machines */
+    uint32_t frame_skip;        /* frames per step, 0 is treated as 1 */
+    uint32_t cycles_per_frame;  /* 0 is treated as 20 */
+    uint32_t threads;           /* 0 uses every core */
+    const char* mode;           /* "default", "superchip", "xochip", "megachip" or NULL */
+    const char* quirks;         /* "vf_reset=true,memory=false,..." or NULL */
+    int observation;            /* schip8_obs_format */
+    const uint16_t* reward_addresses; /* reward is the weighted change of these bytes of ram over a step */
+    const float* reward_weights;      /* NULL weighs every address 1 */
+    uint32_t reward_count;
+    int checked;                /* nonzero also ends on accesses past the end of ram, which slows memory instructions */
+} schip8_env_config;
+
+typedef struct schip8_env schip8_env;
+
+/* Returns NULL if the rom doesn't fit in ram or an option is invalid. */
+SCHIP8_API schip8_env* schip8_env_create(const schip8_env_config* config);
+SCHIP8_API void schip8_env_destroy(schip8_env* env);
+
+/* Bytes of one machine's observation. Machine i writes to observations + i * schip8_env_observation_size(). */
+SCHIP8_API size_t schip8_env_observation_size(const schip8_env* env);
+
+/* Holds keys[i] (bit n is key n) on machine i for frame_skip frames, then writes its screen to observations,
+ * the reward to rewards[i] and whether it faulted (undefined opcode, stack, or out of bounds access if checked)
+ * to dones[i].
+ * observations, rewards and dones may be NULL. Returns 0. */
+SCHIP8_API int schip8_env_step_batch(schip8_env* env, const uint16_t* keys, uint8_t* observations, float* rewards,
+                                     uint8_t* dones);
+
+/* Puts every machine with a nonzero which[i], or all of them if which is NULL, back to the state after loading
+ * the rom and writes their observations. Returns 0. */
+SCHIP8_API int schip8_env_reset(schip8_env* env, const uint8_t* which, uint8_t* observations);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CHIP_8_SCHIP8_ENV_H */
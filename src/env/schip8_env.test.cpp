@@ -0,0 +1,132 @@
+#include <gtest/gtest.h>
+#include <vector>
+#include "schip8_env.h"
+#include "BatchEnv.h"
+
+class EnvTest : public testing::Test {
+protected:
+    schip8_env_config config(int observation)
+    {
+        return {.rom = rom.data(), .rom_size = rom.size(), .count = 4, .frame_skip = 2, .threads = 2,
+                .observation = observation, .reward_addresses = rewardAddresses, .reward_count = 1};
+    }
+
+    // scores 3 once key 5 is held and shows the score: 200: v1 := 5, 202: if v1 -key then jump 202,
+    // 206: v0 := 3, 208: i := 0x300, 20A: save v0, 20C: i := hex v0, 20E: sprite v1 v1 5, 210: jump 210
+    std::vector<std::uint8_t> rom {0x61, 0x05, 0xE1, 0x9E, 0x12, 0x02, 0x60, 0x03, 0xA3, 0x00, 0xF0, 0x55,
+                                   0xF0, 0x29, 0xD1, 0x15, 0x12, 0x10};
+    const std::uint16_t rewardAddresses[1] {0x300};
+};
+
+TEST_F(EnvTest, stepsEachMachineWithItsKeys)
+{
+    schip8_env_config c {config(SCHIP8_OBS_U8)};
+    schip8_env* env {schip8_env_create(&c)};
+    ASSERT_NE(env, nullptr);
+    std::size_t size {schip8_env_observation_size(env)};
+    ASSERT_EQ(size, 128 * 64);
+
+    std::vector<std::uint16_t> keys {0, 1 << 5, 1 << 4, 1 << 5 | 1};
+    std::vector<std::uint8_t> observations(4 * size);
+    std::vector<float> rewards(4);
+    std::vector<std::uint8_t> dones(4, 1);
+    EXPECT_EQ(schip8_env_step_batch(env, keys.data(), observations.data(), rewards.data(), dones.data()), 0);
+
+    EXPECT_EQ(rewards, (std::vector<float> {0, 3, 0, 3}));
+    EXPECT_EQ(dones, (std::vector<std::uint8_t> {0, 0, 0, 0}));
+    // the top row of the digit is drawn at (5, 5) as #### and doubled in lores
+    std::uint8_t* lit {observations.data() + size + 10 * 128};
+    EXPECT_EQ(lit[9], 0);
+    EXPECT_EQ(lit[10], 1);
+    EXPECT_EQ(lit[17], 1);
+    EXPECT_EQ(lit[18], 0);
+    EXPECT_EQ(std::count(observations.begin(), observations.begin() + size, 1), 0);
+
+    // nothing changes the next step
+    EXPECT_EQ(schip8_env_step_batch(env, keys.data(), nullptr, rewards.data(), nullptr), 0);
+    EXPECT_EQ(rewards, (std::vector<float> {0, 0, 0, 0}));
+    schip8_env_destroy(env);
+}
+
+TEST_F(EnvTest, packedObservationsAndReset)
+{
+    schip8_env_config c {config(SCHIP8_OBS_PACKED)};
+    schip8_env* env {schip8_env_create(&c)};
+    ASSERT_NE(env, nullptr);
+    std::size_t size {schip8_env_observation_size(env)};
+    ASSERT_EQ(size, 128 * 64 / 8);
+
+    std::vector<std::uint16_t> keys(4, 1 << 5);
+    std::vector<std::uint8_t> observations(4 * size);
+    schip8_env_step_batch(env, keys.data(), observations.data(), nullptr, nullptr);
+    // pixels 10 to 17 of row 10
+    EXPECT_EQ(observations[10 * 16 + 1], 0b0011'1111);
+    EXPECT_EQ(observations[10 * 16 + 2], 0b1100'0000);
+
+    std::vector<std::uint8_t> which {0, 1, 0, 0};
+    EXPECT_EQ(schip8_env_reset(env, which.data(), observations.data()), 0);
+    EXPECT_EQ(observations[size + 10 * 16 + 1], 0);
+    EXPECT_EQ(observations[10 * 16 + 1], 0b0011'1111);
+    schip8_env_destroy(env);
+}
+
+TEST_F(EnvTest, donesFollowFaults)
+{
+    // 200: i := 0xFFF, 202: load v1 reads past the end of ram, 204: 0x80 0x08 is undefined, 206: jump 206
+    std::vector<std::uint8_t> faulting {0xAF, 0xFF, 0xF1, 0x65, 0x80, 0x08, 0x12, 0x06};
+    schip8_env_config c {config(SCHIP8_OBS_U8)};
+    c.rom = faulting.data();
+    c.rom_size = faulting.size();
+    std::vector<std::uint16_t> keys(4);
+    std::vector<std::uint8_t> dones(4);
+
+    schip8_env* env {schip8_env_create(&c)};
+    ASSERT_NE(env, nullptr);
+    schip8_env_step_batch(env, keys.data(), nullptr, nullptr, dones.data());
+    EXPECT_EQ(dones, (std::vector<std::uint8_t> {1, 1, 1, 1}));
+    EXPECT_EQ(schip8_env_step_batch(env, keys.data(), nullptr, nullptr, dones.data()), 0);
+    EXPECT_EQ(dones, (std::vector<std::uint8_t> {0, 0, 0, 0}));
+    schip8_env_destroy(env);
+
+    // out of bounds alone only ends a machine in checked mode
+    faulting[4] = 0x12;
+    faulting[5] = 0x04;
+    for (int checked : {0, 1}) {
+        c.checked = checked;
+        env = schip8_env_create(&c);
+        ASSERT_NE(env, nullptr);
+        schip8_env_step_batch(env, keys.data(), nullptr, nullptr, dones.data());
+        EXPECT_EQ(dones, (std::vector<std::uint8_t>(4, checked))) << checked;
+        schip8_env_destroy(env);
+    }
+}
+
+TEST_F(EnvTest, hostKeyboardIsIgnored)
+{
+    BatchEnv env {config(SCHIP8_OBS_U8)};
+    // hold key 5 (W) on the host keyboard
+    Uint8& w {const_cast<Uint8*>(SDL_GetKeyboardState(nullptr))[SDL_SCANCODE_W]};
+    w = 1;
+    std::vector<std::uint16_t> keys(4);
+    std::vector<float> rewards(4);
+    env.step(keys.data(), nullptr, rewards.data(), nullptr);
+    EXPECT_FALSE(env.machine(0).keyboard.isPressed(5));
+    env.reset(nullptr, nullptr);
+    EXPECT_FALSE(env.machine(3).keyboard.isPressed(5));
+    w = 0;
+
+    EXPECT_EQ(rewards, (std::vector<float> {0, 0, 0, 0}));
+}
+
+TEST_F(EnvTest, rejectsBadConfig)
+{
+    schip8_env_config c {config(SCHIP8_OBS_U8)};
+    c.quirks = "wrapping=true";
+    EXPECT_EQ(schip8_env_create(&c), nullptr);
+
+    std::vector<std::uint8_t> big(0x1000000); // too large even for MEGA-CHIP
+    c = config(SCHIP8_OBS_U8);
+    c.rom = big.data();
+    c.rom_size = big.size();
+    EXPECT_EQ(schip8_env_create(&c), nullptr);
+}
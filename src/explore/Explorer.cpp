@@ -0,0 +1,198 @@
+#include "Explorer.h"
+#include <algorithm>
+#include <atomic>
+#include <experimental/random>
+#include <format>
+#include <memory>
+#include <thread>
+#include "VisitedSet.h"
+
+namespace {
+    // input sequences share their prefixes
+    struct Path {
+        std::shared_ptr<const Path> parent;
+        std::uint16_t keys;
+    };
+
+    struct Node {
+        std::unique_ptr<Machine> machine;
+        std::shared_ptr<const Path> path;
+        int depth {0};
+        int score {0}; // addresses this state executed first
+    };
+
+    // heap order for best first, ties go to the shallower state
+    bool worse(const Node& a, const Node& b)
+    {
+        return a.score != b.score ? a.score < b.score : a.depth > b.depth;
+    }
+
+    std::uint64_t faults(const Machine& machine)
+    {
+        return machine.interpreter.faults.undefined + machine.interpreter.faults.stack
+                + machine.interpreter.faults.outOfBounds;
+    }
+
+    std::uint64_t stateKey(const Machine& machine)
+    {
+        return machine.interpreter.stateHash() ^ zobrist::key(zobrist::keys, 0, machine.keyboard.mask());
+    }
+}
+
+std::vector<std::uint16_t> Explorer::defaultInputs()
+{
+    std::vector<std::uint16_t> masks {0};
+    for (int key {0}; key != 16; ++key)
+        masks.push_back(1 << key);
+    return masks;
+}
+
+bool Explorer::matches(const Display& display, const std::vector<std::string>& pattern)
+{
+    int height {static_cast<int>(pattern.size())};
+    int width {0};
+    for (const std::string& row : pattern)
+        width = std::max(width, static_cast<int>(row.size()));
+    if (height == 0 or height > display.height or width > display.width)
+        return false;
+
+    auto at {[&](int x, int y) {
+        for (int r {0}; r != height; ++r) {
+            std::span<const std::uint8_t> pixels {display.row(y + r)};
+            for (int c {0}; c != static_cast<int>(pattern[r].size()); ++c) {
+                char expected {pattern[r][c]};
+                if ((expected == '#' and pixels[x + c] == 0) or (expected == '.' and pixels[x + c] != 0))
+                    return false;
+            }
+        }
+        return true;
+    }};
+    for (int y {0}; y + height <= display.height; ++y) {
+        for (int x {0}; x + width <= display.width; ++x) {
+            if (at(x, y))
+                return true;
+        }
+    }
+    return false;
+}
+
+Explorer::Result Explorer::explore(const Machine& start, const Goal& goal) const
+{
+    Result result;
+    VisitedSet visited;
+    std::atomic<std::size_t> states {1};
+    std::vector<std::atomic<bool>> executed(0x10000);
+    visited.insert(stateKey(start));
+
+    std::vector<Node> frontier;
+    frontier.push_back({start.fork(), nullptr, 0, 0});
+    frontier.front().machine->keyboard.setHostKeys(false); // every fork runs on the pool with only its own keys
+    if (goal.fault)
+        frontier.front().machine->interpreter.setChecked(true); // out of bounds accesses are only seen in checked mode
+    unsigned pool {threads == 0 ? std::max(1u, std::thread::hardware_concurrency()) : threads};
+
+    // runs input from parent, returns the reason if the child meets the goal
+    auto expand {[&](const Node& parent, std::uint16_t keys, Node& child) -> std::string {
+        child = {parent.machine->fork(), std::make_shared<const Path>(parent.path, keys), parent.depth + 1, 0};
+        Machine& machine {*child.machine};
+        std::experimental::reseed(stateKey(*parent.machine) ^ keys);
+        machine.keyboard.setMask(keys);
+        std::uint64_t faultsBefore {faults(machine)};
+
+        std::string reason;
+        for (int f {0}; f != framesPerStep; ++f) {
+            // one instruction at a time, but otherwise the same frame as Machine::frame() runs
+            for (int left {machine.interpreter.frameBudget(cyclesPerFrame)}; left > 0;) {
+                std::uint16_t pc {machine.interpreter.pc};
+                if (!executed[pc].exchange(true, std::memory_order_relaxed))
+                    ++child.score;
+                if (goal.pc and pc == *goal.pc and reason.empty())
+                    reason = std::format("pc {:#05x} reached", pc);
+                Interpreter::Run run {machine.interpreter.run(1)};
+                left -= run.cost;
+                if (run.stop == Interpreter::Stop::keyWait or run.stop == Interpreter::Stop::vblank)
+                    break;
+            }
+            machine.interpreter.endOfFrame();
+            if (goal.ram and reason.empty() and machine.memory.read(goal.ram->first) == goal.ram->second)
+                reason = std::format("ram[{:#05x}] == {:#04x}", goal.ram->first, goal.ram->second);
+            if (!reason.empty())
+                return reason;
+        }
+        if (goal.fault and faults(machine) != faultsBefore)
+            return "fault";
+        if (!goal.pattern.empty() and matches(machine.display, goal.pattern))
+            return "pattern on screen";
+        return {};
+    }};
+
+    while (!frontier.empty() and !result.found and states < maxStates) {
+        // breadth first expands a whole level at a time, best first the most promising few states
+        std::vector<Node> batch;
+        if (strategy == Strategy::breadthFirst) {
+            batch = std::move(frontier);
+            frontier.clear();
+        } else {
+            for (std::size_t n {0}; n != 2 * pool and !frontier.empty(); ++n) {
+                std::ranges::pop_heap(frontier, worse);
+                batch.push_back(std::move(frontier.back()));
+                frontier.pop_back();
+            }
+        }
+
+        // every worker claims the next unexpanded state and writes only its own slots
+        std::vector<std::vector<Node>> children(batch.size());
+        std::vector<std::pair<std::string, std::shared_ptr<const Path>>> hits(batch.size());
+        std::atomic<std::size_t> next {0};
+        std::atomic<bool> stop {false};
+        auto work {[&] {
+            for (std::size_t i {next++}; i < batch.size() and !stop; i = next++) {
+                if (batch[i].depth >= maxDepth)
+                    continue;
+                for (std::uint16_t keys : inputs) {
+                    Node child;
+                    std::string reason {expand(batch[i], keys, child)};
+                    if (!reason.empty()) {
+                        hits[i] = {std::move(reason), child.path};
+                        stop = true;
+                        break;
+                    }
+                    if (states >= maxStates or !visited.insert(stateKey(*child.machine)))
+                        continue;
+                    ++states;
+                    children[i].push_back(std::move(child));
+                }
+            }
+        }};
+        {
+            std::vector<std::jthread> workers;
+            for (unsigned t {1}; t < std::min<std::size_t>(pool, batch.size()); ++t)
+                workers.emplace_back(work);
+            work();
+        }
+
+        for (const Node& node : batch)
+            result.depth = std::max(result.depth, node.depth);
+        // the earliest state in the batch wins so breadth first still returns a shortest sequence
+        auto hit {std::ranges::find_if(hits, [](const auto& h) { return !h.first.empty(); })};
+        if (hit != hits.end()) {
+            result.found = true;
+            result.reason = hit->first;
+            for (const Path* p {hit->second.get()}; p != nullptr; p = p->parent.get())
+                result.inputs.push_back(p->keys);
+            std::ranges::reverse(result.inputs);
+        }
+
+        for (std::vector<Node>& nodes : children) {
+            for (Node& node : nodes) {
+                frontier.push_back(std::move(node));
+                if (strategy == Strategy::bestFirst)
+                    std::ranges::push_heap(frontier, worse);
+            }
+        }
+    }
+
+    result.states = states;
+    result.coverage = std::ranges::count_if(executed, [](const std::atomic<bool>& e) { return e.load(); });
+    return result;
+}
@@ -0,0 +1,56 @@
+#ifndef CHIP_8_EXPLORER_H
+#define CHIP_8_EXPLORER_H
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+#include "../machine/Machine.h"
+
+// Searches the states a rom can reach from a starting machine by holding each of a set of key masks for a few
+// frames at a time. States are told apart by Interpreter::stateHash() and the keys held, so each one is
+// expanded once however many input sequences lead to it. Cxnn is reseeded from the state before every
+// expansion, which makes the outcome of an input a function of the state alone.
+class Explorer {
+public:
+    enum class Strategy {
+        breadthFirst, // shortest input sequence first
+        bestFirst, // states that executed code no other state had reached first
+    };
+
+    // The search stops at the first state that meets any of the set conditions.
+    struct Goal {
+        std::optional<std::uint16_t> pc; // an instruction at this address is executed
+        std::optional<std::pair<std::uint16_t, std::uint8_t>> ram; // address holds value at the end of a frame
+        std::vector<std::string> pattern; // rows of '#' (lit) and '.' (unlit) found anywhere on screen, other characters match either
+        bool fault {false}; // an undefined opcode, stack fault or access outside of ram
+    };
+
+    struct Result {
+        bool found {false};
+        std::string reason; // which goal was met
+        std::vector<std::uint16_t> inputs; // key mask held for framesPerStep frames per step, from the start state
+        std::size_t states {0}; // distinct states visited
+        std::size_t coverage {0}; // distinct addresses executed
+        int depth {0}; // steps from the start state of the deepest state expanded
+    };
+
+    Strategy strategy {Strategy::breadthFirst};
+    int framesPerStep {10};
+    int cyclesPerFrame {20};
+    int maxDepth {64};
+    std::size_t maxStates {100'000};
+    unsigned threads {0}; // 0 uses every core
+    std::vector<std::uint16_t> inputs {defaultInputs()}; // key masks tried in every state
+
+    // no keys, then every key on its own
+    static std::vector<std::uint16_t> defaultInputs();
+    // true if pattern, see Goal::pattern, is on the screen of display
+    static bool matches(const Display& display, const std::vector<std::string>& pattern);
+
+    [[nodiscard]] Result explore(const Machine& start, const Goal& goal) const;
+};
+
+
+#endif //CHIP_8_EXPLORER_H
@@ -0,0 +1,90 @@
+#include <gtest/gtest.h>
+#include "Explorer.h"
+#include "VisitedSet.h"
+
+class ExplorerTest : public testing::Test {
+protected:
+    ExplorerTest() {
+        machine.interpreter.setLogging(false);
+        machine.memory.load(rom);
+        explorer.threads = 2;
+        explorer.framesPerStep = 2;
+    }
+
+    // 200: v0 := 5, 202: if v0 -key then jump 202, 206: v1 := 1, 208: i := 0x300, 20A: save v1,
+    // 20C: i := 0x300, 20E: sprite v0 v0 1, 210: jump 210
+    std::vector<std::uint8_t> rom {0x60, 0x05, 0xE0, 0x9E, 0x12, 0x02, 0x61, 0x01, 0xA3, 0x00, 0xF1, 0x55,
+                                   0xA3, 0x00, 0xD0, 0x01, 0x12, 0x10};
+    Machine machine;
+    Explorer explorer;
+};
+
+TEST_F(ExplorerTest, findsKeyForRamGoal)
+{
+    Explorer::Result result {explorer.explore(machine, {.ram = {{0x301, 1}}})};
+
+    EXPECT_TRUE(result.found);
+    EXPECT_EQ(result.inputs, std::vector<std::uint16_t> {1 << 5});
+}
+
+TEST_F(ExplorerTest, findsKeyForPcGoal)
+{
+    explorer.strategy = Explorer::Strategy::bestFirst;
+    Explorer::Result result {explorer.explore(machine, {.pc = 0x206})};
+
+    EXPECT_TRUE(result.found);
+    EXPECT_EQ(result.inputs, std::vector<std::uint16_t> {1 << 5});
+}
+
+TEST_F(ExplorerTest, findsPatternOnScreen)
+{
+    // 0x300 holds v0 = 5 after the save, drawn as .....#.#
+    Explorer::Result result {explorer.explore(machine, {.pattern = {"#.#."}})};
+
+    EXPECT_TRUE(result.found);
+    EXPECT_EQ(result.reason, "pattern on screen");
+}
+
+TEST_F(ExplorerTest, revisitedStatesAreNotExpanded)
+{
+    explorer.inputs = {0};
+    Explorer::Result result {explorer.explore(machine, {.pc = 0x206})};
+
+    EXPECT_FALSE(result.found);
+    EXPECT_LE(result.states, 3);
+}
+
+TEST_F(ExplorerTest, hostKeysAreIgnored)
+{
+    // hold key 5 (W) on the host keyboard
+    Uint8& w {const_cast<Uint8*>(SDL_GetKeyboardState(nullptr))[SDL_SCANCODE_W]};
+    w = 1;
+    explorer.inputs = {0};
+    Explorer::Result result {explorer.explore(machine, {.pc = 0x206})};
+    w = 0;
+
+    EXPECT_FALSE(result.found);
+}
+
+TEST_F(ExplorerTest, framesEndAfterADraw)
+{
+    // 200: v1 += 1, 202: i := 0x300, 204: save v1, 206: sprite v0 v0 1, 208: jump 200
+    // with display_wait each frame ends at the sprite, so v1 is 2 at the end of the first step
+    machine.memory.load(std::vector<std::uint8_t> {0x71, 0x01, 0xA3, 0x00, 0xF1, 0x55, 0xD0, 0x01, 0x12, 0x00});
+    explorer.inputs = {0};
+    explorer.maxDepth = 4;
+    Explorer::Result result {explorer.explore(machine, {.ram = {{0x301, 2}}})};
+
+    EXPECT_TRUE(result.found);
+    EXPECT_EQ(result.inputs.size(), 1);
+}
+
+TEST(VisitedSetTest, insertsOnce)
+{
+    VisitedSet visited;
+
+    EXPECT_TRUE(visited.insert(0x1234));
+    EXPECT_FALSE(visited.insert(0x1234));
+    EXPECT_TRUE(visited.insert(0x1234ull << 48));
+    EXPECT_EQ(visited.size(), 2);
+}
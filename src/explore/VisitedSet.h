@@ -0,0 +1,41 @@
+#ifndef CHIP_8_VISITEDSET_H
+#define CHIP_8_VISITEDSET_H
+
+#include <array>
+#include <cstdint>
+#include <mutex>
+#include <unordered_set>
+
+// Set of state hashes that many threads insert into at once. The hashes are already uniformly
+// distributed, so their top bits pick one of the shards and threads rarely wait on the same lock.
+class VisitedSet {
+public:
+    // true if hash wasn't in the set yet
+    bool insert(std::uint64_t hash)
+    {
+        Shard& shard {shards_[hash >> (64 - shardBits_)]};
+        std::scoped_lock lock {shard.mutex};
+        return shard.hashes.insert(hash).second;
+    }
+
+    [[nodiscard]] std::size_t size()
+    {
+        std::size_t n {0};
+        for (Shard& shard : shards_) {
+            std::scoped_lock lock {shard.mutex};
+            n += shard.hashes.size();
+        }
+        return n;
+    }
+private:
+    static constexpr int shardBits_ {6};
+
+    struct Shard {
+        std::mutex mutex;
+        std::unordered_set<std::uint64_t> hashes;
+    };
+    std::array<Shard, 1 << shardBits_> shards_;
+};
+
+
+#endif //CHIP_8_VISITEDSET_H
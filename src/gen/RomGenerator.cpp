@@ -0,0 +1,214 @@
+#include "RomGenerator.h"
+#include <algorithm>
+#include <charconv>
+#include <numeric>
+#include <random>
+#include <ranges>
+#include <string_view>
+
+namespace {
+    constexpr std::uint16_t origin {0x200};
+    constexpr int subroutines {8};
+    constexpr std::size_t spriteBytes {48}; // a 16x16 sprite from any of the first 16 bytes
+
+    // where an operand is only known once the rom is laid out
+    struct Fixup {
+        enum Target : std::uint8_t { group, subroutine, sprite };
+        std::size_t word; // index of the instruction
+        Target target;
+        int index; // of the group or subroutine, or the offset into the sprite data
+    };
+}
+
+std::optional<RomGenerator::Mix> RomGenerator::workload(std::string_view name)
+{
+    if (name == "mixed")
+        return Mix {1, 1, 1, 0, 1, 1};
+    for (int kind {0}; kind != kindCount; ++kind) {
+        if (name == kindNames[kind]) {
+            Mix mix {};
+            mix[alu] = 1;
+            mix[branch] = 1;
+            mix[kind] += 8;
+            return mix;
+        }
+    }
+    return std::nullopt;
+}
+
+std::optional<RomGenerator::Mix> RomGenerator::parseMix(std::string_view text)
+{
+    Mix mix {};
+    for (auto part : std::views::split(text, ',')) {
+        std::string_view pair {part.begin(), part.end()};
+        std::size_t equals {pair.find('=')};
+        if (equals == std::string_view::npos)
+            return std::nullopt;
+        std::string_view name {pair.substr(0, equals)};
+        std::string_view weight {pair.substr(equals + 1)};
+        auto kind {std::ranges::find(kindNames, name)};
+        int value {0};
+        auto [end, error] {std::from_chars(weight.data(), weight.data() + weight.size(), value)};
+        if (kind == std::end(kindNames) or error != std::errc {} or end != weight.data() + weight.size() or value < 0)
+            return std::nullopt;
+        mix[kind - std::begin(kindNames)] = value;
+    }
+    if (std::ranges::all_of(mix, [](int weight) { return weight == 0; }))
+        return std::nullopt;
+    return mix;
+}
+
+std::vector<std::uint8_t> RomGenerator::generate() const
+{
+    // the engine's output is the same everywhere, unlike the standard distributions
+    std::mt19937_64 rng {seed};
+    auto below {[&rng](unsigned n) { return static_cast<unsigned>(rng() % n); }};
+    auto reg {[&below] { return static_cast<std::uint16_t>(below(15)); }}; // any but VF
+    auto byte {[&below] { return static_cast<std::uint16_t>(below(256)); }};
+    bool super {superchip()};
+    int total {std::max(1, std::accumulate(mix.begin(), mix.end(), 0))};
+
+    std::vector<std::uint16_t> code;
+    std::vector<Fixup> fixups;
+    std::vector<std::size_t> groups; // first word of each group, the last is the jump back to the first
+    auto arithmetic {[&] {
+        switch (below(4)) {
+            case 0: return static_cast<std::uint16_t>(0x6000 | reg() << 8 | byte());
+            case 1: return static_cast<std::uint16_t>(0x7000 | reg() << 8 | byte());
+            case 2: return static_cast<std::uint16_t>(0xC000 | reg() << 8 | byte());
+            default: {
+                static constexpr std::uint16_t ops[] {0x0, 0x1, 0x2, 0x3, 0x4, 0x5, 0x6, 0x7, 0xE};
+                return static_cast<std::uint16_t>(0x8000 | reg() << 8 | reg() << 4 | ops[below(std::size(ops))]);
+            }
+        }
+    }};
+
+    // low resolution sprites are drawn at the same coordinates in high resolution, so either is fine
+    if (super)
+        code.push_back(0x00FF);
+    for (std::uint16_t x {0}; x != 16; ++x)
+        code.push_back(0x6000 | x << 8 | byte());
+    // so that loads never read ram nothing wrote, see Interpreter::setChecked()
+    if (mix[memory] != 0) {
+        for (std::uint16_t chunk {0}; chunk != scratchSize; chunk += 16) {
+            code.push_back(0xA000 | (scratchAddr + chunk));
+            code.push_back(0xFF55);
+        }
+    }
+
+    std::size_t body {code.size()};
+    int budget {std::clamp(instructions, 1, maxInstructions)};
+    while (static_cast<int>(code.size() - body) < budget) {
+        groups.push_back(code.size());
+        int pick {static_cast<int>(below(total))};
+        int kind {0};
+        for (; kind != kindCount - 1 and pick >= mix[kind]; ++kind)
+            pick -= mix[kind];
+
+        switch (kind) {
+            case alu:
+                code.push_back(arithmetic());
+                break;
+            case branch:
+                switch (below(3)) {
+                    case 0: { // skip over an arithmetic instruction or a jump
+                        static constexpr std::uint16_t skips[] {0x3000, 0x4000, 0x5000, 0x9000, 0xE09E, 0xE0A1};
+                        std::uint16_t skip {skips[below(std::size(skips))]};
+                        if (skip == 0x5000 or skip == 0x9000)
+                            code.push_back(skip | reg() << 8 | reg() << 4);
+                        else if (skip >> 12 == 0xE)
+                            code.push_back(skip | reg() << 8);
+                        else
+                            code.push_back(skip | reg() << 8 | byte());
+                        if (below(2) == 0) {
+                            code.push_back(arithmetic());
+                            break;
+                        }
+                        [[fallthrough]];
+                    }
+                    case 1: // forward, to one of the next few groups or the end of the body
+                        fixups.push_back({code.size(), Fixup::group, static_cast<int>(groups.size() + below(4))});
+                        code.push_back(0x1000);
+                        break;
+                    default:
+                        fixups.push_back({code.size(), Fixup::subroutine, static_cast<int>(below(subroutines))});
+                        code.push_back(0x2000);
+                        break;
+                }
+                break;
+            case draw: {
+                fixups.push_back({code.size(), Fixup::sprite, static_cast<int>(below(16))});
+                code.push_back(0xA000);
+                std::uint16_t x {reg()};
+                std::uint16_t y {reg()};
+                if (below(2) == 0)
+                    code.push_back(0x7000 | x << 8 | byte());
+                code.push_back(0xD000 | x << 8 | y << 4 | spriteHeight);
+                break;
+            }
+            case scroll:
+                switch (below(3)) {
+                    case 0: code.push_back(0x00C0 | (1 + below(15))); break;
+                    case 1: code.push_back(0x00FB); break;
+                    default: code.push_back(0x00FC); break;
+                }
+                break;
+            case memory: {
+                code.push_back(0xA000 | scratchAddr);
+                if (below(2) == 0)
+                    code.push_back(0xF01E | reg() << 8); // at most 0xFF on
+                std::uint16_t x {static_cast<std::uint16_t>(below(16))};
+                switch (below(super ? 4 : 3)) {
+                    case 0: code.push_back(0xF055 | x << 8); break;
+                    case 1: code.push_back(0xF065 | x << 8); break;
+                    case 2: code.push_back(0xF033 | reg() << 8); break;
+                    default: code.push_back((below(2) == 0 ? 0xF075 : 0xF085) | (x & 7) << 8); break;
+                }
+                break;
+            }
+            default: { // self-modifying, the saved instruction runs right after it is written
+                std::uint16_t op {static_cast<std::uint16_t>((below(2) == 0 ? 0x6000 : 0x7000) | (2 + below(13)) << 8 | byte())};
+                std::uint16_t slot {static_cast<std::uint16_t>(origin + 2 * (code.size() + 4))};
+                code.push_back(0xA000 | slot);
+                code.push_back(0x6000 | op >> 8);
+                code.push_back(0x6100 | (op & 0xFF));
+                code.push_back(0xF155);
+                code.push_back(0x7000 | (op & 0x0F00)); // what the slot holds until it is first written
+                break;
+            }
+        }
+    }
+    groups.push_back(code.size());
+    code.push_back(0x1000 | (origin + 2 * body));
+
+    std::vector<std::uint16_t> starts;
+    for (int s {0}; s != subroutines; ++s) {
+        starts.push_back(static_cast<std::uint16_t>(origin + 2 * code.size()));
+        code.push_back(arithmetic());
+        code.push_back(arithmetic());
+        code.push_back(0x00EE);
+    }
+    std::uint16_t sprites {static_cast<std::uint16_t>(origin + 2 * code.size())};
+    for (const Fixup& fixup : fixups) {
+        switch (fixup.target) {
+            case Fixup::group:
+                code[fixup.word] |= origin + 2 * groups[std::min<std::size_t>(fixup.index, groups.size() - 1)];
+                break;
+            case Fixup::subroutine:
+                code[fixup.word] |= starts[fixup.index];
+                break;
+            case Fixup::sprite:
+                code[fixup.word] |= sprites + fixup.index;
+                break;
+        }
+    }
+
+    std::vector<std::uint8_t> rom;
+    for (std::uint16_t op : code) {
+        rom.push_back(op >> 8);
+        rom.push_back(op & 0xFF);
+    }
+    for (std::size_t b {0}; b != spriteBytes; ++b)
+        rom.push_back(static_cast<std::uint8_t>(byte()));
+    return rom;
+}
@@ -0,0 +1,52 @@
+#ifndef CHIP_8_ROMGENERATOR_H
+#define CHIP_8_ROMGENERATOR_H
+
+#include <array>
+#include <cstdint>
+#include <optional>
+#include <string_view>
+#include <vector>
+
+// Writes roms with a chosen mix of instructions to benchmark the interpreter on the work an optimization targets.
+// A rom sets up the registers and then loops over a body of random groups of instructions forever, each group
+// one of the kinds below, without faulting: calls return, jumps only go forward to the start of a group, skips
+// only skip a single instruction and ram is only accessed through addresses set right before. The same settings
+// always give the same rom.
+class RomGenerator {
+public:
+    enum Kind : std::uint8_t {
+        alu, // 6xnn, 7xnn, 8xyn and Cxnn
+        branch, // skips, forward jumps and calls of short subroutines
+        draw, // i := sprite data, then a sprite of spriteHeight
+        scroll, // SUPER-CHIP scrolls
+        memory, // i := scratch ram, then a save, load or bcd
+        selfModifying, // saves an instruction over the one after it, which runs next
+        kindCount,
+    };
+    static constexpr const char* kindNames[kindCount] {"alu", "branch", "draw", "scroll", "memory", "selfmod"};
+    // relative weights of the kinds of groups
+    using Mix = std::array<int, kindCount>;
+
+    // ram outside the rom that memory groups use, enough for i := scratchAddr, i += 0xFF and a save of 16 bytes
+    static constexpr std::uint16_t scratchAddr {0xE00};
+    static constexpr std::uint16_t scratchSize {0x110};
+    static constexpr int maxInstructions {1200}; // in the body, so that the rom ends before scratchAddr
+
+    // A workload named after a kind weighs it 8 to 1 against alu and branch, "mixed" weighs the CHIP-8 kinds the
+    // same. Nullopt for an unknown name.
+    static std::optional<Mix> workload(std::string_view name);
+    // comma separated kind=weight pairs like "alu=3,draw=1", kinds left out weigh nothing
+    static std::optional<Mix> parseMix(std::string_view mix);
+
+    Mix mix {1, 1, 1, 0, 1, 1};
+    std::uint64_t seed {1};
+    int instructions {1000}; // in the body, at least
+    int spriteHeight {5}; // rows, 0 draws SUPER-CHIP's 16x16 sprites
+
+    // Scrolls and 16x16 sprites need SUPER-CHIP, which also allows saving to its flag registers.
+    [[nodiscard]] bool superchip() const { return mix[scroll] != 0 or (mix[draw] != 0 and spriteHeight == 0); }
+    [[nodiscard]] std::vector<std::uint8_t> generate() const;
+};
+
+
+#endif //CHIP_8_ROMGENERATOR_H
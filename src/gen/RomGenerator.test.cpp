@@ -0,0 +1,72 @@
+#include <gtest/gtest.h>
+#include "RomGenerator.h"
+#include "../analysis/Disassembler.h"
+#include "../machine/Machine.h"
+
+TEST(RomGeneratorTest, sameSeedSameRom)
+{
+    RomGenerator generator;
+    std::vector<std::uint8_t> first {generator.generate()};
+    EXPECT_EQ(generator.generate(), first);
+    generator.seed = 2;
+    EXPECT_NE(generator.generate(), first);
+}
+
+TEST(RomGeneratorTest, everyWorkloadRunsWithoutFaults)
+{
+    for (std::string_view workload : {"alu", "branch", "draw", "scroll", "memory", "selfmod", "mixed"}) {
+        for (int spriteHeight : {0, 5, 15}) {
+            RomGenerator generator;
+            generator.mix = *RomGenerator::workload(workload);
+            generator.spriteHeight = spriteHeight;
+            generator.seed = spriteHeight;
+            std::vector<std::uint8_t> rom {generator.generate()};
+
+            Disassembler disassembler {rom};
+            EXPECT_EQ(disassembler.platform(), generator.superchip() ? "superchip" : "chip8") << workload;
+
+            Machine machine;
+            machine.interpreter.setLogging(false);
+            machine.interpreter.setChecked(true);
+            machine.keyboard.setHostKeys(false);
+            ASSERT_TRUE(machine.memory.load(rom));
+            machine.interpreter.setMode(generator.superchip() ? "superchip" : "default");
+            for (int f {0}; f != 200; ++f)
+                machine.frame(200);
+            EXPECT_EQ(machine.interpreter.faults.undefined, 0) << workload;
+            EXPECT_EQ(machine.interpreter.faults.stack, 0) << workload;
+            EXPECT_TRUE(machine.interpreter.diagnostics().empty()) << workload;
+        }
+    }
+}
+
+TEST(RomGeneratorTest, workloadsShapeTheMix)
+{
+    auto count {[](std::string_view workload, auto matches) {
+        RomGenerator generator;
+        generator.mix = *RomGenerator::workload(workload);
+        std::vector<std::uint8_t> rom {generator.generate()};
+        Disassembler disassembler {rom};
+        int n {0};
+        for (std::uint16_t addr {Disassembler::origin}; addr < Disassembler::origin + rom.size(); addr += 2)
+            n += disassembler.isCode(addr) and matches(disassembler.opcode(addr));
+        return n;
+    }};
+    auto isDraw {[](std::uint16_t op) { return op >> 12 == 0xD; }};
+    auto isSave {[](std::uint16_t op) { return (op & 0xF0FF) == 0xF055; }};
+
+    EXPECT_GT(count("draw", isDraw), 4 * count("mixed", isDraw));
+    EXPECT_GT(count("selfmod", isSave), 100); // of 1000 instructions, 5 to a group
+    EXPECT_EQ(count("draw", isSave), 0);
+    EXPECT_EQ(count("alu", [](std::uint16_t op) { return op >> 12 == 0xA or op >> 12 == 0xF; }), 0);
+}
+
+TEST(RomGeneratorTest, parsesMixes)
+{
+    EXPECT_EQ(RomGenerator::parseMix("alu=3,draw=1"), (RomGenerator::Mix {3, 0, 1, 0, 0, 0}));
+    EXPECT_EQ(RomGenerator::parseMix("selfmod=2"), (RomGenerator::Mix {0, 0, 0, 0, 0, 2}));
+    EXPECT_FALSE(RomGenerator::parseMix("alu"));
+    EXPECT_FALSE(RomGenerator::parseMix("jit=1"));
+    EXPECT_FALSE(RomGenerator::parseMix("alu=0"));
+    EXPECT_FALSE(RomGenerator::workload("games"));
+}
@@ -0,0 +1,229 @@
+#include "Grid.h"
+#include <algorithm>
+#include <chrono>
+#include <format>
+#include "SDL.h"
+#include "../log/Log.h"
+
+namespace {
+    constexpr std::uint32_t border {0x000000FF}; // around and between cells
+
+    bool onError()
+    {
+        Log::global().write(Log::Level::error, "display", "sdl_error", "{:s}", SDL_GetError());
+        return false;
+    }
+}
+
+Grid::Grid(int columns, int rows)
+    : columns_{std::max(columns, 1)}, rows_{std::max(rows, 1)}
+{
+}
+
+Grid::~Grid()
+{
+    for (std::jthread& worker : workers_)
+        worker.request_stop();
+    // wakes the workers up to notice
+    frame_.fetch_add(1);
+    frame_.notify_all();
+}
+
+Machine* Grid::add()
+{
+    if (cells_.size() == static_cast<std::size_t>(columns_ * rows_))
+        return nullptr;
+    cells_.push_back(std::make_unique<Cell>());
+    return &cells_.back()->machine;
+}
+
+void Grid::start(int cyclesPerFrame)
+{
+    cyclesPerFrame_ = cyclesPerFrame;
+    for (const std::unique_ptr<Cell>& cell : cells_) {
+        cell->machine.keyboard.setHostKeys(false); // the keys come with advance()
+        workers_.emplace_back([this, &cell = *cell](std::stop_token stop) { work_(cell, stop); });
+    }
+}
+
+void Grid::advance(std::uint64_t frame, std::uint16_t keys)
+{
+    keys_ = keys;
+    if (frame <= frame_)
+        return;
+    frame_ = frame;
+    frame_.notify_all();
+}
+
+void Grid::sync() const
+{
+    if (workers_.empty())
+        return;
+    for (const std::unique_ptr<Cell>& cell : cells_) {
+        for (std::uint64_t done {cell->done}; done < frame_; done = cell->done)
+            cell->done.wait(done);
+    }
+}
+
+void Grid::work_(Cell& cell, std::stop_token stop)
+{
+    std::uint64_t done {0};
+    // also checked before waiting, the frames just run may include the destructor's wake-up bump of frame_
+    while (!stop.stop_requested()) {
+        frame_.wait(done);
+        if (stop.stop_requested())
+            return;
+
+        std::uint64_t target {frame_};
+        if (target - done > maxLag)
+            done = target - maxLag;
+        cell.machine.keyboard.setMask(keys_);
+        for (; done != target; ++done)
+            cell.machine.frame(cyclesPerFrame_);
+
+        Picture& picture {cell.pictures[cell.back]};
+        const Display& display {cell.machine.display};
+        picture.width = display.width;
+        picture.height = display.height;
+        picture.pixels.resize(picture.width * picture.height);
+        for (int y {0}; y != picture.height; ++y) {
+            for (int x {0}; x != picture.width; ++x)
+                picture.pixels[x + y * picture.width] = display.color(x, y);
+        }
+        cell.back = cell.middle.exchange(cell.back | fresh_) & ~fresh_;
+
+        cell.done = done;
+        cell.done.notify_all();
+    }
+}
+
+bool Grid::composite()
+{
+    std::vector<bool> changed(cells_.size());
+    bool grown {false};
+    for (std::size_t c {0}; c != cells_.size(); ++c) {
+        Cell& cell {*cells_[c]};
+        if ((cell.middle & fresh_) == 0)
+            continue;
+        cell.front = cell.middle.exchange(cell.front) & ~fresh_;
+        changed[c] = true;
+
+        const Picture& picture {cell.pictures[cell.front]};
+        if (picture.width > cellWidth_ or picture.height > cellHeight_) {
+            cellWidth_ = std::max(cellWidth_, picture.width);
+            cellHeight_ = std::max(cellHeight_, picture.height);
+            grown = true;
+        }
+    }
+
+    // a new size redraws every cell
+    if (grown or canvas_.size() != static_cast<std::size_t>(width() * height())) {
+        canvas_.assign(width() * height(), border);
+        changed.assign(changed.size(), true);
+    }
+    for (std::size_t c {0}; c != cells_.size(); ++c) {
+        if (changed[c])
+            drawCell_(static_cast<int>(c), cells_[c]->pictures[cells_[c]->front]);
+    }
+    return std::ranges::find(changed, true) != changed.end();
+}
+
+void Grid::drawCell_(int index, const Picture& picture)
+{
+    int left {index % columns_ * (cellWidth_ + gap)};
+    int top {index / columns_ * (cellHeight_ + gap)};
+    int stride {width()};
+    for (int y {top}; y != top + cellHeight_; ++y)
+        std::fill_n(canvas_.begin() + left + y * stride, cellWidth_, border);
+    if (picture.width == 0)
+        return; // nothing finished yet
+
+    int factor {std::max(1, std::min(cellWidth_ / picture.width, cellHeight_ / picture.height))};
+    left += (cellWidth_ - picture.width * factor) / 2;
+    top += (cellHeight_ - picture.height * factor) / 2;
+    for (int y {0}; y != picture.height; ++y) {
+        auto first {canvas_.begin() + left + (top + y * factor) * stride};
+        auto out {first};
+        for (int x {0}; x != picture.width; ++x)
+            out = std::fill_n(out, factor, picture.pixels[x + y * picture.width]);
+        // the other rows of the scaled up row are copies of the first
+        for (int r {1}; r != factor; ++r)
+            std::copy_n(first, picture.width * factor, first + r * stride);
+    }
+}
+
+bool Grid::show(int scale)
+{
+    composite();
+    SDL_Window* window {SDL_CreateWindow("SCHIP-8", SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED,
+                                         width() * scale, height() * scale, SDL_WINDOW_SHOWN)};
+    if (!window)
+        return onError();
+    SDL_Renderer* renderer {SDL_CreateRenderer(window, -1, SDL_RENDERER_ACCELERATED | SDL_RENDERER_PRESENTVSYNC)};
+    if (!renderer) {
+        SDL_DestroyWindow(window);
+        return onError();
+    }
+    SDL_RendererInfo info {};
+    SDL_GetRendererInfo(renderer, &info);
+    bool vsync {(info.flags & SDL_RENDERER_PRESENTVSYNC) != 0};
+
+    SDL_Texture* texture {nullptr};
+    int textureWidth {0};
+    int textureHeight {0};
+    bool ok {true};
+
+    using clock = std::chrono::steady_clock;
+    clock::time_point start {clock::now()};
+    bool quit {false};
+    while (!quit) {
+        SDL_Event e;
+        while (SDL_PollEvent(&e) != 0) {
+            if (e.type == SDL_QUIT)
+                quit = true;
+        }
+
+        // frames are due by the clock rather than by presents, so a display faster than 60Hz doesn't speed the games up
+        auto due {static_cast<std::uint64_t>((clock::now() - start) * 60 / std::chrono::seconds(1)) + 1};
+        advance(due, Keyboard::hostMask());
+
+        bool changed {composite()};
+        if (textureWidth != width() or textureHeight != height()) {
+            SDL_DestroyTexture(texture);
+            textureWidth = width();
+            textureHeight = height();
+            texture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_RGBA8888, SDL_TEXTUREACCESS_STREAMING,
+                                        textureWidth, textureHeight);
+            if (!texture) {
+                ok = onError();
+                break;
+            }
+            SDL_RenderSetLogicalSize(renderer, textureWidth, textureHeight);
+            changed = true;
+        }
+        if (changed) {
+            void* locked {nullptr};
+            int pitch {};
+            SDL_LockTexture(texture, nullptr, &locked, &pitch);
+            for (int y {0}; y != textureHeight; ++y)
+                std::copy_n(canvas_.begin() + y * textureWidth, textureWidth,
+                            reinterpret_cast<std::uint32_t*>(static_cast<std::uint8_t*>(locked) + y * pitch));
+            SDL_UnlockTexture(texture);
+        }
+
+        SDL_RenderClear(renderer);
+        SDL_RenderCopy(renderer, texture, nullptr, nullptr);
+        SDL_RenderPresent(renderer); // waits for vsync
+        if (!vsync) {
+            auto next {start + std::chrono::duration_cast<clock::duration>(std::chrono::microseconds {1'000'000} * due / 60)};
+            auto left {std::chrono::duration_cast<std::chrono::milliseconds>(next - clock::now())};
+            if (left.count() > 0)
+                SDL_Delay(static_cast<std::uint32_t>(left.count()));
+        }
+    }
+
+    SDL_DestroyTexture(texture);
+    SDL_DestroyRenderer(renderer);
+    SDL_DestroyWindow(window);
+    return ok;
+}
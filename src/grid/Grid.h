@@ -0,0 +1,83 @@
+#ifndef CHIP_8_GRID_H
+#define CHIP_8_GRID_H
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <thread>
+#include <vector>
+#include "../machine/Machine.h"
+
+// Runs several machines side by side in one window, each on a worker thread of its own. The window thread only
+// tells the workers how many frames should have run by now and which keys are held, and composites the last
+// frame each of them finished into a single texture. Frames are handed over through a triple buffer per
+// machine, so neither side ever waits for the other.
+class Grid {
+public:
+    static constexpr int gap {1}; // pixels between cells
+    static constexpr int maxLag {4}; // frames a worker runs to catch up before it drops the rest
+
+    Grid(int columns, int rows);
+    // stops the workers
+    ~Grid();
+    Grid(const Grid&) = delete;
+    Grid& operator=(const Grid&) = delete;
+
+    // The machine in the next free cell, left to right and top to bottom, nullptr once every cell is taken.
+    // Only valid to change before start().
+    Machine* add();
+    [[nodiscard]] std::size_t size() const { return cells_.size(); }
+    void start(int cyclesPerFrame);
+    // Lets the workers run up to frame number frame with keys held, bit n is key n.
+    void advance(std::uint64_t frame, std::uint16_t keys);
+    // waits until every worker has run every frame advance() asked for
+    void sync() const;
+    // Copies the newest finished frame of every machine into pixels(), returns whether any of them changed.
+    bool composite();
+
+    // RGBA, width() by height(). Cells are as big as the largest screen seen so far, smaller screens are
+    // scaled up by an integer factor and centered.
+    [[nodiscard]] std::span<const std::uint32_t> pixels() const { return canvas_; }
+    [[nodiscard]] int width() const { return columns_ * cellWidth_ + (columns_ - 1) * gap; }
+    [[nodiscard]] int height() const { return rows_ * cellHeight_ + (rows_ - 1) * gap; }
+
+    // Opens the window and runs at 60 frames per second until it is closed, presenting on vsync.
+    bool show(int scale);
+private:
+    struct Picture {
+        int width {0};
+        int height {0};
+        std::vector<std::uint32_t> pixels;
+    };
+
+    struct Cell {
+        Machine machine;
+        // triple buffer: the worker owns back, composite() owns front and middle changes hands
+        std::array<Picture, 3> pictures {};
+        int back {0};
+        int front {1};
+        std::atomic<int> middle {2}; // and fresh_ once the worker put a picture there
+        std::atomic<std::uint64_t> done {0}; // frames run
+    };
+    static constexpr int fresh_ {4};
+
+    void work_(Cell& cell, std::stop_token stop);
+    void drawCell_(int index, const Picture& picture);
+
+    int columns_;
+    int rows_;
+    int cellWidth_ {128};
+    int cellHeight_ {64};
+    int cyclesPerFrame_ {20};
+    std::vector<std::unique_ptr<Cell>> cells_;
+    std::vector<std::uint32_t> canvas_;
+    std::atomic<std::uint64_t> frame_ {0};
+    std::atomic<std::uint16_t> keys_ {0};
+
+    std::vector<std::jthread> workers_; // last, so they stop before anything they use is destroyed
+};
+
+
+#endif //CHIP_8_GRID_H
@@ -0,0 +1,63 @@
+#include <gtest/gtest.h>
+#include "Grid.h"
+
+class GridTest : public testing::Test {
+protected:
+    GridTest() {
+        for (const std::vector<std::uint8_t>* rom : {&drawing, &idle}) {
+            Machine* machine {grid.add()};
+            machine->interpreter.setLogging(false);
+            machine->memory.load(*rom);
+        }
+    }
+
+    static constexpr std::uint32_t lit {0x9C5ECCFF};
+    static constexpr std::uint32_t unlit {0x18141CFF};
+
+    // 200: v0 := 0, 202: i := hex v0, 204: sprite v0 v0 5, 206: jump 206
+    std::vector<std::uint8_t> drawing {0x60, 0x00, 0xF0, 0x29, 0xD0, 0x05, 0x12, 0x06};
+    // 200: jump 200
+    std::vector<std::uint8_t> idle {0x12, 0x00};
+    Grid grid {2, 1};
+};
+
+TEST_F(GridTest, cellsAreFull)
+{
+    EXPECT_EQ(grid.add(), nullptr);
+    EXPECT_EQ(grid.size(), 2);
+}
+
+TEST_F(GridTest, framesAreScaledIntoTheirCells)
+{
+    grid.start(20);
+    grid.advance(1, 0);
+    grid.sync();
+    ASSERT_TRUE(grid.composite());
+
+    // two 128x64 cells with a gap between them, each 64x32 screen drawn twice as big
+    ASSERT_EQ(grid.width(), 2 * 128 + Grid::gap);
+    ASSERT_EQ(grid.height(), 64);
+    std::span<const std::uint32_t> pixels {grid.pixels()};
+    ASSERT_EQ(pixels.size(), grid.width() * grid.height());
+    // the top row of the 0 glyph is four pixels wide
+    EXPECT_EQ(pixels[0], lit);
+    EXPECT_EQ(pixels[7 + grid.width()], lit);
+    EXPECT_EQ(pixels[8], unlit);
+    EXPECT_EQ(pixels[128], 0x000000FFu);
+    EXPECT_EQ(pixels[128 + Grid::gap], unlit);
+
+    // nothing new until the workers run another frame
+    EXPECT_FALSE(grid.composite());
+    grid.advance(2, 0);
+    grid.sync();
+    EXPECT_TRUE(grid.composite());
+}
+
+TEST_F(GridTest, workersSkipFramesTheyFellBehindOn)
+{
+    grid.start(20);
+    grid.advance(1000, 0);
+    grid.sync();
+    grid.composite();
+    EXPECT_EQ(grid.pixels()[0], lit);
+}
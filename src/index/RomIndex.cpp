@@ -0,0 +1,158 @@
+#include "RomIndex.h"
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <charconv>
+#include <format>
+#include <fstream>
+#include <thread>
+#include "../analysis/Disassembler.h"
+#include "../cache/AnalysisCache.h"
+#include "../io/MappedFile.h"
+#include "../memory/Memory.h"
+
+bool RomIndex::isRom(const std::filesystem::directory_entry& entry)
+{
+    static constexpr std::string_view extensions[] {".ch8", ".c8", ".sc8", ".xo8", ".mc8"};
+    std::string ext {entry.path().extension().string()};
+    std::ranges::transform(ext, ext.begin(), [](unsigned char c) { return std::tolower(c); });
+    return entry.is_regular_file() and std::ranges::find(extensions, ext) != std::end(extensions);
+}
+
+RomIndex RomIndex::build(const std::filesystem::path& dir, unsigned threads)
+{
+    std::vector<std::filesystem::path> paths;
+    std::error_code ec;
+    for (const auto& entry : std::filesystem::recursive_directory_iterator(dir, ec)) {
+        if (isRom(entry))
+            paths.push_back(entry.path());
+    }
+    std::ranges::sort(paths);
+
+    // every worker claims the next unprocessed path and writes only its own slot
+    std::vector<RomEntry> results(paths.size());
+    std::atomic<std::size_t> next {0};
+    auto work {[&] {
+        for (std::size_t i {next++}; i < paths.size(); i = next++) {
+            MappedFile file {paths[i]};
+            std::span<const std::uint8_t> rom {file.bytes()};
+            if (!file.isOpen() or rom.size() > Memory::megaRamSize - Memory::programAddr)
+                continue;
+
+            Disassembler disassembler {rom};
+            results[i] = {Memory::hash(rom), rom.size(), disassembler.platform(), "", paths[i]};
+            results[i].quirks = suggestedQuirks(results[i].platform);
+        }
+    }};
+
+    if (threads == 0)
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    {
+        std::vector<std::jthread> pool;
+        for (unsigned t {1}; t < std::min<std::size_t>(threads, paths.size()); ++t)
+            pool.emplace_back(work);
+        work();
+    }
+
+    RomIndex index;
+    for (RomEntry& entry : results) {
+        if (!entry.path.empty())
+            index.entries_.push_back(std::move(entry));
+    }
+    // duplicates keep the first path in sorted order
+    std::ranges::stable_sort(index.entries_, {}, &RomEntry::hash);
+    auto [first, last] {std::ranges::unique(index.entries_, {}, &RomEntry::hash)};
+    index.entries_.erase(first, last);
+    return index;
+}
+
+std::filesystem::path RomIndex::defaultPath()
+{
+    return AnalysisCache::defaultDirectory() / "index.tsv";
+}
+
+std::string RomIndex::suggestedQuirks(std::string_view platform)
+{
+    if (platform == "superchip" or platform == "megachip")
+        return "vf_reset=false,memory=false,shifting=true,jumping=true,ioverflow=false";
+    if (platform == "xochip")
+        return "vf_reset=false,memory=true,shifting=false,jumping=false,ioverflow=false";
+    return "vf_reset=true,memory=true,shifting=false,jumping=false,ioverflow=false";
+}
+
+bool RomIndex::load(const std::filesystem::path& file)
+{
+    std::ifstream in {file};
+    if (!in.is_open())
+        return false;
+
+    entries_.clear();
+    std::string line;
+    while (std::getline(in, line)) {
+        if (line.empty() or line[0] == '#')
+            continue;
+
+        // hash, size, platform, quirks, path
+        std::vector<std::string_view> fields;
+        std::string_view rest {line};
+        for (int f {0}; f != 4 and rest.find('\t') != std::string_view::npos; ++f) {
+            fields.push_back(rest.substr(0, rest.find('\t')));
+            rest.remove_prefix(rest.find('\t') + 1);
+        }
+        fields.push_back(rest);
+        if (fields.size() != 5)
+            continue;
+
+        RomEntry entry {.platform = std::string(fields[2]), .quirks = std::string(fields[3]), .path = std::string(fields[4])};
+        std::from_chars(fields[0].data(), fields[0].data() + fields[0].size(), entry.hash, 16);
+        std::from_chars(fields[1].data(), fields[1].data() + fields[1].size(), entry.size);
+        entries_.push_back(std::move(entry));
+    }
+    std::ranges::sort(entries_, {}, &RomEntry::hash);
+    return true;
+}
+
+bool RomIndex::save(const std::filesystem::path& file) const
+{
+    std::error_code ec;
+    if (file.has_parent_path())
+        std::filesystem::create_directories(file.parent_path(), ec);
+
+    std::ofstream out {file};
+    out << "# hash\tsize\tplatform\tquirks\tpath\n";
+    for (const RomEntry& entry : entries_)
+        out << std::format("{:0>16x}\t{:d}\t{:s}\t{:s}\t{:s}\n", entry.hash, entry.size, entry.platform, entry.quirks, entry.path.string());
+    return static_cast<bool>(out);
+}
+
+const RomEntry* RomIndex::find(std::uint64_t hash) const
+{
+    auto it {std::ranges::lower_bound(entries_, hash, {}, &RomEntry::hash)};
+    return it != entries_.end() and it->hash == hash ? &*it : nullptr;
+}
+
+const RomEntry* RomIndex::find(std::string_view hash) const
+{
+    if (hash.empty() or hash.size() > 16 or !std::ranges::all_of(hash, [](char c) { return std::isxdigit(static_cast<unsigned char>(c)); }))
+        return nullptr;
+
+    // a prefix selects the range of hashes [prefix000..., prefixfff...]
+    std::uint64_t prefix {0};
+    std::from_chars(hash.data(), hash.data() + hash.size(), prefix, 16);
+    int shift {static_cast<int>(64 - 4 * hash.size())};
+    std::uint64_t low {prefix << shift};
+    std::uint64_t high {low | ((1ull << shift) - 1)};
+
+    auto first {std::ranges::lower_bound(entries_, low, {}, &RomEntry::hash)};
+    auto last {std::ranges::upper_bound(entries_, high, {}, &RomEntry::hash)};
+    return last - first == 1 ? &*first : nullptr;
+}
+
+void RomIndex::update(RomEntry entry)
+{
+    auto it {std::ranges::lower_bound(entries_, entry.hash, {}, &RomEntry::hash)};
+    if (it != entries_.end() and it->hash == entry.hash)
+        *it = std::move(entry);
+    else
+        entries_.insert(it, std::move(entry));
+}
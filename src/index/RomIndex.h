@@ -0,0 +1,45 @@
+#ifndef CHIP_8_ROMINDEX_H
+#define CHIP_8_ROMINDEX_H
+
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <vector>
+
+struct RomEntry {
+    std::uint64_t hash {0};
+    std::size_t size {0};
+    std::string platform; // see Disassembler::platform()
+    std::string quirks; // suggested profile, see Interpreter::setQuirks()
+    std::filesystem::path path;
+};
+
+// Index of a rom corpus by Memory::hash, saved as one tab separated line per rom.
+class RomIndex {
+public:
+    // Hashes and analyses every rom under dir on the given number of threads.
+    static RomIndex build(const std::filesystem::path& dir, unsigned threads = 0);
+    // $XDG_CACHE_HOME/schip8/index.tsv and friends, see AnalysisCache::defaultDirectory()
+    static std::filesystem::path defaultPath();
+    // regular files with one of the rom extensions build() looks for
+    static bool isRom(const std::filesystem::directory_entry& entry);
+    // Quirk profile a rom written for platform most likely expects.
+    static std::string suggestedQuirks(std::string_view platform);
+
+    bool load(const std::filesystem::path& file);
+    bool save(const std::filesystem::path& file) const;
+
+    [[nodiscard]] const RomEntry* find(std::uint64_t hash) const;
+    // Accepts a full hash or a unique prefix of one, as printed by schip8-index.
+    [[nodiscard]] const RomEntry* find(std::string_view hash) const;
+    // Replaces the entry with the same hash or adds it.
+    void update(RomEntry entry);
+
+    [[nodiscard]] const std::vector<RomEntry>& entries() const { return entries_; }
+private:
+    std::vector<RomEntry> entries_; // sorted by hash
+};
+
+
+#endif //CHIP_8_ROMINDEX_H
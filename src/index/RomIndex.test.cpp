@@ -0,0 +1,61 @@
+#include <gtest/gtest.h>
+#include <format>
+#include <fstream>
+#include "RomIndex.h"
+#include "../memory/Memory.h"
+
+class RomIndexTest : public testing::Test {
+protected:
+    RomIndexTest() {
+        std::filesystem::remove_all(dir);
+        std::filesystem::create_directories(dir / "superchip");
+        write(dir / "a.ch8", chip8);
+        write(dir / "superchip" / "b.ch8", superchip);
+        write(dir / "copy.ch8", chip8);
+        write(dir / "notes.txt", chip8);
+    }
+    ~RomIndexTest() override {
+        std::filesystem::remove_all(dir);
+    }
+
+    static void write(const std::filesystem::path& path, const std::vector<std::uint8_t>& rom) {
+        std::ofstream {path, std::ios::binary}.write(reinterpret_cast<const char*>(rom.data()), static_cast<std::streamsize>(rom.size()));
+    }
+
+    std::filesystem::path dir {std::filesystem::temp_directory_path() / "schip8-rom-index-test"};
+    std::vector<std::uint8_t> chip8 {0x60, 0x01, 0x12, 0x02};
+    std::vector<std::uint8_t> superchip {0x00, 0xFF, 0x12, 0x02};
+};
+
+TEST_F(RomIndexTest, buildDetectsPlatformAndDeduplicates)
+{
+    RomIndex index {RomIndex::build(dir, 4)};
+
+    ASSERT_EQ(index.entries().size(), 2);
+    const RomEntry* a {index.find(Memory::hash(chip8))};
+    ASSERT_NE(a, nullptr);
+    EXPECT_EQ(a->platform, "chip8");
+    EXPECT_EQ(a->size, 4);
+    EXPECT_EQ(a->path.filename(), "a.ch8");
+
+    const RomEntry* b {index.find(Memory::hash(superchip))};
+    ASSERT_NE(b, nullptr);
+    EXPECT_EQ(b->platform, "superchip");
+    EXPECT_EQ(b->quirks, RomIndex::suggestedQuirks("superchip"));
+}
+
+TEST_F(RomIndexTest, saveLoadAndPrefixLookup)
+{
+    RomIndex built {RomIndex::build(dir)};
+    ASSERT_TRUE(built.save(dir / "index.tsv"));
+
+    RomIndex index;
+    ASSERT_TRUE(index.load(dir / "index.tsv"));
+    ASSERT_EQ(index.entries().size(), 2);
+
+    std::string hash {std::format("{:0>16x}", Memory::hash(superchip))};
+    EXPECT_EQ(index.find(hash)->path, built.find(Memory::hash(superchip))->path);
+    EXPECT_EQ(index.find(std::string_view(hash).substr(0, 12))->hash, Memory::hash(superchip));
+    EXPECT_EQ(index.find("xyz"), nullptr);
+    EXPECT_EQ(index.find(""), nullptr);
+}
@@ -1,26 +1,52 @@
 #include "Interpreter.h"
-#include <iostream>
+#include "../capture/Capture.h"
+#include "../log/Log.h"
 #include <string>
 #include <format>
+#include <algorithm>
+#include <array>
+#include <cstdlib>
 #include <experimental/random>
 
+Interpreter::Interpreter(const Interpreter& other, Memory& mem, Display& dis, Keyboard& kb)
+    : pc_{other.pc_}, cir_{other.cir_}, i_{other.i_}, v_{other.v_}, dt_{other.dt_}, st_{other.st_}, flag_{other.flag_},
+      pattern_{other.pattern_}, pitch_{other.pitch_}, spriteWidth_{other.spriteWidth_}, spriteHeight_{other.spriteHeight_},
+      collisionIndex_{other.collisionIndex_}, waiting_{other.waiting_}, vblank_{other.vblank_}, draw_{other.draw_},
+      logging_{other.logging_}, checked_{other.checked_}, xochip_{other.xochip_}, megachip_{other.megachip_},
+      mode_{other.mode_}, timing_{other.timing_}, faults_{other.faults_},
+      diagnostics_{other.diagnostics_},
+      vf_{other.vf_}, breakpoints_{other.breakpoints_}, stackHash_{other.stackHash_}, quirk_{other.quirk_}, sp{&mem.stack}, memory{mem}, keyboard{kb}, display{dis}
+{
+}
+
 bool Interpreter::setMode(const std::string& mode) {
     if (mode == "superchip") {
-        quirk_ = {false, false, true, true, quirk_[ioverflow]};;
+        quirk_ = {false, false, true, true, quirk_[ioverflow], false};
     } else if (mode == "xochip") {
-        quirk_ = {false, true, false, false, quirk_[ioverflow]};;
+        quirk_ = {false, true, false, false, quirk_[ioverflow], false};
+        if (memory.size() < Memory::xoRamSize)
+            memory.resize(Memory::xoRamSize);
+    } else if (mode == "megachip") {
+        quirk_ = {false, false, true, true, quirk_[ioverflow], false};
+        if (memory.size() < Memory::megaRamSize)
+            memory.resize(Memory::megaRamSize);
     } else if (mode == "default") {
-        quirk_ = {true, true, false, false, quirk_[ioverflow]};
+        quirk_ = {true, true, false, false, quirk_[ioverflow], true};
     } else {
         return false;
     }
+    mode_ = mode;
+    xochip_ = mode == "xochip";
+    megachip_ = mode == "megachip";
     return true;
 }
 
 bool Interpreter::setQuirk(const std::string& quirk) {
     std::string delimiter = "=";
+    if (quirk.find(delimiter) == std::string::npos)
+        return false;
     std::string name = quirk.substr(0, quirk.find(delimiter));
-    std::string enabled = quirk.substr(quirk.find(delimiter), quirk.size());
+    std::string enabled = quirk.substr(quirk.find(delimiter) + 1, quirk.size());
 
     if (name == "vf_reset")
         quirk_[vfReset] = enabled == "true";
@@ -32,16 +58,232 @@ bool Interpreter::setQuirk(const std::string& quirk) {
         quirk_[jumpx] = enabled == "true";
     else if (name == "ioverflow")
         quirk_[ioverflow] = enabled == "true";
+    else if (name == "display_wait")
+        quirk_[displayWait] = enabled == "true";
     else
         return false;
 
     return true;
 }
 
+bool Interpreter::setQuirks(const std::string& quirks)
+{
+    bool ok {true};
+    for (std::size_t begin {0}; begin < quirks.size();) {
+        std::size_t end {std::min(quirks.find(',', begin), quirks.size())};
+        ok = setQuirk(quirks.substr(begin, end - begin)) and ok;
+        begin = end + 1;
+    }
+    return ok;
+}
+
+std::string Interpreter::quirks() const
+{
+    return std::format("vf_reset={},memory={},shifting={},jumping={},ioverflow={},display_wait={}",
+                       quirk_[vfReset], quirk_[incr], quirk_[inplace], quirk_[jumpx], quirk_[ioverflow], quirk_[displayWait]);
+}
+
+std::uint64_t Interpreter::registerHash_() const
+{
+    std::uint64_t h {0};
+    for (int r {0}; r != 16; ++r)
+        h ^= zobrist::key(zobrist::reg, r, v_[r]);
+    for (int r {0}; r != 16; ++r)
+        h ^= zobrist::key(zobrist::reg, r < 8 ? 16 + r : 32 + r, flag_[r]);
+    for (int b {0}; b != patternSize; ++b)
+        h ^= zobrist::key(zobrist::reg, 48 + b, pattern_[b]);
+    return h ^ zobrist::key(zobrist::reg, 24, i_) ^ zobrist::key(zobrist::reg, 25, pc_)
+             ^ zobrist::key(zobrist::reg, 26, dt_) ^ zobrist::key(zobrist::reg, 27, st_)
+             ^ zobrist::key(zobrist::reg, 28, waiting_) ^ zobrist::key(zobrist::reg, 29, display.width)
+             ^ zobrist::key(zobrist::reg, 30, pitch_) ^ zobrist::key(zobrist::reg, 31, display.planes())
+             ^ zobrist::key(zobrist::reg, 64, spriteWidth_) ^ zobrist::key(zobrist::reg, 65, spriteHeight_)
+             ^ zobrist::key(zobrist::reg, 66, collisionIndex_) ^ zobrist::key(zobrist::reg, 67, display.blend())
+             ^ zobrist::key(zobrist::reg, 68, display.alpha());
+}
+
+std::uint64_t Interpreter::stateHash() const
+{
+    return memory.stateHash() ^ display.stateHash() ^ stackHash_ ^ registerHash_();
+}
+
+std::uint64_t Interpreter::fullStateHash() const
+{
+    std::uint64_t stack {0};
+    for (std::stack<std::uint16_t> copy {*sp}; !copy.empty(); copy.pop())
+        stack ^= zobrist::key(zobrist::stack, copy.size() - 1, copy.top());
+    return memory.fullStateHash() ^ display.fullStateHash() ^ stack ^ registerHash_();
+}
+
 void Interpreter::cycle()
 {
     fetch_();
     execute_();
+    resolveFlag_();
+}
+
+Interpreter::Run Interpreter::run(int budget, bool stopOnDisplay)
+{
+    if (vblank_)
+        return {Stop::vblank, 0, 0};
+    if (timing_ == Timing::vip)
+        return stopOnDisplay ? run_<true, true>(budget) : run_<false, true>(budget);
+    return stopOnDisplay ? run_<true, false>(budget) : run_<false, false>(budget);
+}
+
+template<bool stopOnDisplay, bool timed>
+Interpreter::Run Interpreter::run_(int budget)
+{
+    int n {0};
+    int cost {0};
+    Stop stop {Stop::budget};
+    bool breakpoints {!breakpoints_.empty()};
+    unsigned long long undefined {faults_.undefined};
+    unsigned long long outOfBounds {faults_.outOfBounds};
+    for (; timed ? cost < budget : n < budget; ) {
+        if (breakpoints and breakpoints_[pc_] and n != 0) {
+            stop = Stop::breakpoint;
+            break;
+        }
+
+        [[maybe_unused]] std::uint64_t screen {stopOnDisplay ? display.stateHash() : 0};
+        ++n;
+        fetch_();
+        execute_();
+        if constexpr (timed)
+            cost += vipCost_();
+
+        if (waiting_) [[unlikely]] {
+            stop = Stop::keyWait;
+            break;
+        }
+        if (vblank_) [[unlikely]] {
+            stop = Stop::vblank;
+            break;
+        }
+        if (faults_.undefined != undefined) [[unlikely]] {
+            stop = Stop::undefined;
+            break;
+        }
+        if (faults_.outOfBounds != outOfBounds) [[unlikely]] {
+            stop = Stop::outOfBounds;
+            break;
+        }
+        if constexpr (stopOnDisplay) {
+            if (display.stateHash() != screen) {
+                stop = Stop::display;
+                break;
+            }
+        }
+    }
+    resolveFlag_();
+    return {stop, n, timed ? cost : n};
+}
+
+int Interpreter::vipCost_() const
+{
+    // Rounded machine cycles of the VIP interpreter's routine for each instruction, on top of the fetch and decode
+    // every instruction pays. The display takes the routines that wait on it, 00E0 and Dxyn, longer than any other.
+    constexpr int fetch {40};
+    switch (op_()) {
+        case 0x0: return fetch + (cir_ == 0x00E0 ? 1560 : 10);
+        case 0x1: return fetch + 12;
+        case 0x2: return fetch + 26;
+        case 0x3: case 0x4: return fetch + 10;
+        case 0x5: case 0x9: return fetch + 14;
+        case 0x6: return fetch + 6;
+        case 0x7: return fetch + 10;
+        case 0x8: return fetch + 44;
+        case 0xA: return fetch + 12;
+        case 0xB: return fetch + 22;
+        case 0xC: return fetch + 36;
+        case 0xD: return fetch + 26 + 60 * n_();
+        case 0xE: return fetch + 18;
+        default:
+            switch (nn_()) {
+                case 0x0A: return fetch + 18;
+                case 0x1E: case 0x29: return fetch + 16;
+                case 0x33: {
+                    std::uint8_t byte {v_[x_()]};
+                    return fetch + 84 + 16 * (byte / 100 + byte / 10 % 10 + byte % 10);
+                }
+                case 0x55: case 0x65: return fetch + 14 + 14 * (x_() + 1);
+                default: return fetch + 10;
+            }
+    }
+}
+
+void Interpreter::setBreakpoint(std::uint16_t addr, bool on)
+{
+    if (breakpoints_.empty())
+        breakpoints_.resize(0x10000);
+    breakpoints_[addr] = on;
+}
+
+void Interpreter::execute(std::uint16_t op)
+{
+    cir_ = op;
+    pc_ += 2;
+    execute_();
+    resolveFlag_();
+}
+
+int Interpreter::executeLoadDraw(std::uint16_t annn, std::uint16_t dxyn)
+{
+    cir_ = annn;
+    i_ = nnn_();
+    cir_ = dxyn;
+    pc_ += 4;
+    drw_();
+    return 2;
+}
+
+int Interpreter::executeBcdLoad(std::uint16_t fx33, std::uint16_t fy65)
+{
+    cir_ = fx33;
+    pc_ += 2;
+    bcd_();
+    cir_ = fy65;
+    pc_ += 2;
+    if (x_() > 2 or i_ + 3 > memory.size()) {
+        lv_();
+        return 2;
+    }
+
+    // the digits just written are still in hand
+    std::uint8_t byte {v_[fx33 >> 8 & 0xF]};
+    std::array<std::uint8_t, 3> digits {static_cast<std::uint8_t>(byte / 100), static_cast<std::uint8_t>(byte / 10 % 10),
+                                        static_cast<std::uint8_t>(byte % 10)};
+    int n {x_() + 1};
+    std::copy_n(digits.begin(), n, v_.begin());
+    if (quirk_[incr])
+        i_ += n;
+    return 2;
+}
+
+int Interpreter::executeLoads(std::span<const std::uint16_t> ops)
+{
+    for (std::uint16_t op : ops) {
+        if (op >> 12 == 6)
+            v_[op >> 8 & 0xF] = op & 0xFF;
+        else
+            v_[op >> 8 & 0xF] += op & 0xFF;
+    }
+    cir_ = ops.back();
+    pc_ += 2 * ops.size();
+    return static_cast<int>(ops.size());
+}
+
+int Interpreter::executeSkipJump(std::uint16_t skip, std::uint16_t jump)
+{
+    cir_ = skip;
+    pc_ += 2;
+    if ((v_[x_()] == nn_()) == (op_() == 3)) {
+        pc_ += 2;
+        return 1;
+    }
+    cir_ = jump;
+    pc_ = nnn_();
+    return 2;
 }
 
 void Interpreter::endOfFrame()
@@ -60,23 +302,123 @@ void Interpreter::endOfFrame()
         display.draw();
         draw_ = false;
     }
+    if (capture_)
+        capture_->submit(display);
+    vblank_ = false;
+}
+
+void Interpreter::setChecked(bool on)
+{
+    checked_ = on;
+    memory.trackWrites(on);
 }
 
 void Interpreter::fetch_()
 {
+    if (checked_) [[unlikely]]
+        check_(pc_, pc_, 2, false);
     cir_ = memory.read(pc_++);
     cir_ <<= 8;
     cir_ |= memory.read(pc_++);
 }
 
-void undefined(std::uint8_t cir)
+void Interpreter::undefined_()
+{
+    ++faults_.undefined;
+    if (logging_) {
+        Log::global().write(Log::Level::error, "interpreter", "undefined_opcode", {static_cast<std::uint16_t>(pc_ - 2), cir_},
+                            "undefined opcode {:0>4X}", cir_);
+    }
+}
+
+void Interpreter::check_(std::uint16_t pc, std::uint32_t addr, std::uint32_t n, bool write)
+{
+    if (addr + n > memory.size()) {
+        ++faults_.outOfBounds;
+        report_(Diagnostic::outOfBounds, pc, addr);
+        return;
+    }
+    if (write)
+        return;
+    for (std::uint32_t a {addr}; a != addr + n; ++a) {
+        if (!memory.initialized(a)) {
+            report_(Diagnostic::uninitialized, pc, a);
+            return;
+        }
+    }
+}
+
+void Interpreter::report_(Diagnostic::Kind kind, std::uint16_t pc, std::uint32_t addr)
+{
+    if (diagnostics_.size() == maxDiagnostics)
+        return;
+    diagnostics_.push_back({kind, pc, addr});
+    if (!logging_)
+        return;
+    Log& log {Log::global()};
+    switch (kind) {
+        case Diagnostic::outOfBounds:
+            log.write(Log::Level::error, "interpreter", "out_of_bounds", {pc, cir_, addr},
+                      "memory access past the end of ram at {:0>3X}", addr);
+            break;
+        case Diagnostic::stackOverflow:
+            log.write(Log::Level::error, "interpreter", "stack_overflow", {pc, cir_}, "call with a full stack");
+            break;
+        case Diagnostic::stackUnderflow:
+            log.write(Log::Level::error, "interpreter", "stack_underflow", {pc, cir_}, "return with an empty stack");
+            break;
+        case Diagnostic::uninitialized:
+            log.write(Log::Level::error, "interpreter", "uninitialized_read", {pc, cir_, addr},
+                      "read of uninitialized memory at {:0>3X}", addr);
+            break;
+    }
+}
+
+bool Interpreter::touchesVf_() const
+{
+    switch (op_()) {
+        case 0: case 1: case 2: case 0xA: return false;
+        case 8: return x_() == 0xF or y_() == 0xF or (n_() >= 1 and n_() <= 3 and quirk_[vfReset]);
+        case 5: case 9: case 0xD: return x_() == 0xF or y_() == 0xF;
+        case 0xB: return quirk_[jumpx] and x_() == 0xF;
+        case 0xF: return true;
+        default: return x_() == 0xF;
+    }
+}
+
+void Interpreter::resolveFlag_()
 {
-    std::cerr << std::format("[error] undefined opcode: {:0>4X}\n", cir);
+    switch (vf_.op) {
+        case LazyFlag::none: return;
+        case LazyFlag::carry: v_[0xF] = vf_.a + vf_.b > 0xFF; break;
+        case LazyFlag::greater: v_[0xF] = vf_.a > vf_.b; break;
+        case LazyFlag::low: v_[0xF] = vf_.a & 1; break;
+        case LazyFlag::high: v_[0xF] = vf_.a >> 7; break;
+    }
+    vf_.op = LazyFlag::none;
 }
 
 void Interpreter::execute_() {
+    // a pending flag that the next instruction can't see is either overwritten by it or resolved later
+    if (vf_.op != LazyFlag::none and touchesVf_())
+        resolveFlag_();
+
     switch (op_()) {
         case 0:
+            if (megachip_ and x_() != 0) {
+                switch (x_()) {
+                    case 0x1: return ldhi_();
+                    case 0x2: return ldpal_();
+                    case 0x3: return sprw_();
+                    case 0x4: return sprh_();
+                    case 0x5: return alpha_();
+                    case 0x6: if (y_() == 0) return digisnd_(); else return undefined_();
+                    case 0x7: if (nn_() == 0) return stopsnd_(); else return undefined_();
+                    case 0x8: if (y_() == 0) return bmode_(); else return undefined_();
+                    case 0x9: return ccol_();
+                    default: return undefined_();
+                }
+            }
             switch (nn_()) {
                 case 0xE0: return cls_();
                 case 0xEE: return ret_();
@@ -85,15 +427,22 @@ void Interpreter::execute_() {
                 case 0xFB: return scr_();
                 case 0xFC: return scl_();
                 case 0xFD: return exit_();
+                case 0x10: if (megachip_) return megaOff_(); else return undefined_();
+                case 0x11: if (megachip_) return megaOn_(); else return undefined_();
                 default:
                     if (y_() == 0xC) return scd_();
-                    else return undefined(cir_);
+                    else if (y_() == 0xD and xochip_) return scu_();
+                    else if (y_() == 0xB and megachip_) return scu_();
+                    else return undefined_();
             }
         case 1: return jp_();
         case 2: return call_();
         case 3: return skip_(v_[x_()] == nn_());
         case 4: return skip_(v_[x_()] != nn_());
-        case 5: return skip_(v_[x_()] == v_[y_()]);
+        case 5:
+            if (xochip_ and n_() == 2) return svr_();
+            if (xochip_ and n_() == 3) return lvr_();
+            return skip_(v_[x_()] == v_[y_()]);
         case 6: return ld_(v_[x_()], nn_());
         case 7: return add_();
         case 8:
@@ -107,7 +456,7 @@ void Interpreter::execute_() {
                 case 6: return shr_(x_(), y_());
                 case 7: return subn_(x_(), y_());
                 case 0xE: return shl_(x_(), y_());
-                default: return undefined(cir_);
+                default: return undefined_();
             }
         case 9: return skip_(v_[x_()] != v_[y_()]);
         case 0xA: return ldi_(nnn_());
@@ -116,9 +465,9 @@ void Interpreter::execute_() {
         case 0xD: return drw_();
         case 0xE:
             switch (n_()) {
-                case 0xE: return skip_(Keyboard::isPressed(v_[x_()]));
-                case 0x1: return skip_(!Keyboard::isPressed(v_[x_()]));
-                default: return undefined(cir_);
+                case 0xE: return skip_(keyboard.isPressed(v_[x_()]));
+                case 0x1: return skip_(!keyboard.isPressed(v_[x_()]));
+                default: return undefined_();
             }
         case 0xF:
             switch (nn_()) {
@@ -134,9 +483,13 @@ void Interpreter::execute_() {
                 case 0x30: return ldi_(memory.getBigFont(v_[x_()]));
                 case 0x75: return sf_();
                 case 0x85: return lf_();
-                default: return undefined(cir_);
+                case 0x00: if (xochip_ and x_() == 0) return ldil_(); else return undefined_();
+                case 0x01: if (xochip_) return plane_(); else return undefined_();
+                case 0x02: if (xochip_ and x_() == 0) return audio_(); else return undefined_();
+                case 0x3A: if (xochip_) return setPitch_(); else return undefined_();
+                default: return undefined_();
             }
-        default: return undefined(cir_);
+        default: return undefined_();
     }
 }
 
@@ -151,8 +504,15 @@ inline void Interpreter::cls_()
 // 00EE: Return from a subroutine.
 inline void Interpreter::ret_()
 {
+    if (sp->empty()) {
+        ++faults_.stack;
+        if (checked_)
+            report_(Diagnostic::stackUnderflow, pc_ - 2, 0);
+        return;
+    }
     pc_ = sp->top();
     sp->pop();
+    stackHash_ ^= zobrist::key(zobrist::stack, sp->size(), pc_);
 }
 
 // 1nnn: Jump to location nnn.
@@ -164,6 +524,12 @@ inline void Interpreter::jp_()
 // 2nnn: Call subroutine at nnn
 inline void Interpreter::call_()
 {
+    if (sp->size() == stackDepth) {
+        ++faults_.stack;
+        if (checked_)
+            report_(Diagnostic::stackOverflow, pc_ - 2, 0);
+    }
+    stackHash_ ^= zobrist::key(zobrist::stack, sp->size(), pc_);
     sp->push(pc_);
     pc_ = nnn_();
 }
@@ -176,8 +542,12 @@ inline void Interpreter::call_()
 // ExA1: Skip next instruction if key with the value of Vx is not pressed.
 inline void Interpreter::skip_(bool cond)
 {
-    if (cond)
-        pc_ += 2;
+    if (!cond)
+        return;
+    // xo-chip skips the whole of a 4 byte F000 nnnn, mega-chip the whole of a 01nn nnnn
+    bool long_ {(xochip_ and memory.read(pc_) == 0xF0 and memory.read(pc_ + 1) == 0x00)
+                or (megachip_ and memory.read(pc_) == 0x01)};
+    pc_ += long_ ? 4 : 2;
 }
 
 // 6xnn: Set Vx = nn.
@@ -224,47 +594,42 @@ inline void Interpreter::xor_()
 // 8xy4: Set Vx = Vx + Vy, set VF = carry.
 inline void Interpreter::adc_(std::uint8_t x, std::uint8_t y)
 {
-    int vf {v_[x] + v_[y] > 0xFF ? 1 : 0};
+    vf_ = {LazyFlag::carry, v_[x], v_[y]};
     v_[x] += v_[y];
-    v_[0xF] = vf;
 }
 
 // 8xy5: Set Vx = Vx - Vy, set VF = NOT borrow.
 inline void Interpreter::sub_(std::uint8_t x, std::uint8_t y)
 {
-    int vf {v_[y] < v_[x] ? 1 : 0};
+    vf_ = {LazyFlag::greater, v_[x], v_[y]};
     v_[x] = v_[x] - v_[y];
-    v_[0xF] = vf;
 }
 
 // 8xy6: Set Vx = Vx SHR 1.
 inline void Interpreter::shr_(std::uint8_t x, std::uint8_t y)
 {
-    int vf {(v_[y] & 1) == 1 ? 1 : 0};
+    vf_ = {LazyFlag::low, v_[y]};
     v_[x] = (quirk_[inplace] ? v_[x] : v_[y]) >> 1;
-    v_[0xF] = vf;
 }
 
 // 8xy7: Set Vx = Vy - Vx, set VF = NOT borrow.
 inline void Interpreter::subn_(std::uint8_t x, std::uint8_t y)
 {
-    int vf {v_[x] < v_[y] ? 1 : 0};
+    vf_ = {LazyFlag::greater, v_[y], v_[x]};
     v_[x] = v_[y] - v_[x];
-    v_[0xF] = vf;
 }
 
 // 8xyE: Set Vx = Vx SHL 1.
 inline void Interpreter::shl_(std::uint8_t x, std::uint8_t y)
 {
-    int vf {(v_[y] & 0x80) == 0x80 ? 1 : 0};
+    vf_ = {LazyFlag::high, v_[y]};
     v_[x] = (quirk_[inplace] ? v_[x] : v_[y]) << 1;
-    v_[0xF] = vf;
 }
 
 // Annn: Set I = nnn.
 // Fx29: Set I = location of sprite for digit Vx.
 // Fx30: Set i to a large hexadecimal character based on the value of Vx.
-inline void Interpreter::ldi_(std::uint16_t val)
+inline void Interpreter::ldi_(std::uint32_t val)
 {
     i_ = val;
 }
@@ -285,6 +650,11 @@ inline void Interpreter::rnd_()
 // Dxy0: Draw a 16x16 sprite. If used by CHIP-8 program, will still function like SuperChip.
 inline void Interpreter::drw_()
 {
+    // the VIP waits for the vertical blank to draw, so nothing else runs that frame
+    vblank_ = quirk_[displayWait];
+    if (display.mega())
+        return blit_();
+
     std::uint8_t n {n_()};
     int bitmax {n == 0 ? 16 : 8};
     int scale {n == 0 ? 2 : 1};
@@ -293,21 +663,43 @@ inline void Interpreter::drw_()
     int xcoord {v_[x_()] & (display.width - 1)};
     int ycoord {v_[y_()] & (display.height - 1)};
 
+    // xo-chip draws the first selected plane from the sprite at i and, when both are selected, the second
+    // from the sprite right after it, in the same pass
+    std::uint8_t first {static_cast<std::uint8_t>(display.planes() & -display.planes())};
+    bool both {display.planes() == 3};
+
+    if (checked_) [[unlikely]] {
+        int bytes {std::min<int>(ylim / scale, display.height - ycoord) * (bitmax / 8)};
+        check_(pc_ - 2, i_, both ? ylim + bytes : bytes, false);
+    }
+
+    vf_.op = LazyFlag::none; // overwritten below
     v_[0xF] = 0;
+    bool collision {false};
+    int top {bitmax == 16 ? 0x8000 : 0x80};
     for (int yline {0}; yline != ylim and ycoord + yline/scale != display.height; yline += scale) {
         int byte {bitmax == 16
                   ? memory.read(i_ + yline) << 8 | memory.read(i_ + yline + 1)
                   : memory.read(i_ + yline)};
+        if (!both) {
+            for (int xline {0}; xline != bitmax and xcoord + xline != display.width; ++xline) {
+                if ((byte << xline & top) != 0)
+                    collision |= display.flipPixel(xcoord + xline, ycoord + yline/scale, first);
+            }
+            continue;
+        }
 
-        // loop through the bits
+        int second {bitmax == 16
+                    ? memory.read(i_ + ylim + yline) << 8 | memory.read(i_ + ylim + yline + 1)
+                    : memory.read(i_ + ylim + yline)};
         for (int xline {0}; xline != bitmax and xcoord + xline != display.width; ++xline) {
-            if ((byte << xline & (bitmax == 16 ? 0x8000 : 0x80)) != 0) {
-                bool collision {display.flipPixel(xcoord + xline, ycoord + yline/scale)};
-                if (collision)
-                    v_[0xF] = 1;
-            }
+            std::uint8_t planes {static_cast<std::uint8_t>(((byte << xline & top) != 0 ? 1 : 0)
+                                                           | ((second << xline & top) != 0 ? 2 : 0))};
+            if (planes != 0)
+                collision |= display.flipPixel(xcoord + xline, ycoord + yline/scale, planes);
         }
     }
+    v_[0xF] = collision;
     draw_ = true;
 }
 
@@ -336,6 +728,8 @@ inline void Interpreter::addi_(std::uint8_t x)
 // Fx33: Store BCD representation of Vx in memory locations I, I+1, and I+2.
 inline void Interpreter::bcd_()
 {
+    if (checked_) [[unlikely]]
+        check_(pc_ - 2, i_, 3, true);
     std::uint8_t byte {v_[x_()]};
     memory.write(byte / 100, i_);
     memory.write(byte / 10 % 10, i_ + 1);
@@ -346,24 +740,22 @@ inline void Interpreter::bcd_()
 inline void Interpreter::sv_()
 {
     std::uint8_t n {static_cast<uint8_t>(x_() + 1)};
-    for (int r {0}; r != n; ++r) {
-        if (quirk_[incr])
-            memory.write(v_[r], i_++);
-        else
-            memory.write(v_[r], i_ + r);
-    }
+    if (checked_) [[unlikely]]
+        check_(pc_ - 2, i_, n, true);
+    memory.write({v_.data(), n}, i_);
+    if (quirk_[incr])
+        i_ += n;
 }
 
 // Fx65: Read registers V0 through Vx from memory starting at location I.
 inline void Interpreter::lv_()
 {
     std::uint8_t n {static_cast<uint8_t>(x_() + 1)};
-    for (int r {0}; r != n; ++r) {
-        if (quirk_[incr])
-            v_[r] = memory.read(i_++);
-        else
-            v_[r] = memory.read(i_ + r);
-    }
+    if (checked_) [[unlikely]]
+        check_(pc_ - 2, i_, n, false);
+    memory.read(i_, {v_.data(), n});
+    if (quirk_[incr])
+        i_ += n;
 }
 
 // 00FF: Enable 128x64 high resolution graphics mode.
@@ -409,7 +801,7 @@ inline void Interpreter::exit_()
 inline void Interpreter::sf_()
 {
     std::uint8_t n {static_cast<uint8_t>(v_[x_()] + 1)};
-    for (int r {0}; r != n and r != 8; ++r)
+    for (int r {0}; r != n and r != (xochip_ ? 16 : 8); ++r)
         flag_[r] = v_[r];
 
 }
@@ -418,6 +810,171 @@ inline void Interpreter::sf_()
 inline void Interpreter::lf_()
 {
     std::uint8_t n {static_cast<uint8_t>(v_[x_()] + 1)};
-    for (int r {0}; r != n and r != 8; ++r)
+    for (int r {0}; r != n and r != (xochip_ ? 16 : 8); ++r)
         v_[r] = flag_[r];
-}
\ No newline at end of file
+}
+
+// 00Dn: Scroll the selected planes up by n [0, 15] pixels.
+// 00Bn: Scroll the display up by n [0, 15] pixels. (MEGA-CHIP)
+inline void Interpreter::scu_()
+{
+    display.scrollUp(n_());
+    draw_ = true;
+}
+
+// 5xy2: Store Vx through Vy in memory starting at location I, in reverse order if x > y. I is unchanged.
+inline void Interpreter::svr_()
+{
+    int x {x_()}, y {y_()};
+    int step {x <= y ? 1 : -1};
+    int n {std::abs(y - x) + 1};
+    if (checked_) [[unlikely]]
+        check_(pc_ - 2, i_, n, true);
+    for (int k {0}; k != n; ++k)
+        memory.write(v_[x + k * step], i_ + k);
+}
+
+// 5xy3: Load Vx through Vy from memory starting at location I, in reverse order if x > y. I is unchanged.
+inline void Interpreter::lvr_()
+{
+    int x {x_()}, y {y_()};
+    int step {x <= y ? 1 : -1};
+    int n {std::abs(y - x) + 1};
+    if (checked_) [[unlikely]]
+        check_(pc_ - 2, i_, n, false);
+    for (int k {0}; k != n; ++k)
+        v_[x + k * step] = memory.read(i_ + k);
+}
+
+// F000 nnnn: Set I = nnnn, the only 4 byte instruction.
+inline void Interpreter::ldil_()
+{
+    if (checked_) [[unlikely]]
+        check_(pc_ - 2, pc_, 2, false);
+    i_ = memory.read(pc_) << 8 | memory.read(pc_ + 1);
+    pc_ += 2;
+}
+
+// Fn01: Select the planes n that clear, scroll and draw affect.
+inline void Interpreter::plane_()
+{
+    display.setPlanes(x_());
+}
+
+// F002: Load the 16 byte audio pattern from memory starting at location I.
+inline void Interpreter::audio_()
+{
+    if (checked_) [[unlikely]]
+        check_(pc_ - 2, i_, patternSize, false);
+    memory.read(i_, pattern_);
+}
+
+// Fx3A: Set the audio pitch to Vx.
+inline void Interpreter::setPitch_()
+{
+    pitch_ = v_[x_()];
+}
+// 0011: Enable 256x192 MEGA-CHIP graphics mode.
+inline void Interpreter::megaOn_()
+{
+    display.setMega(true);
+    draw_ = true;
+}
+
+// 0010: Disable MEGA-CHIP graphics mode and return to 64x32.
+inline void Interpreter::megaOff_()
+{
+    display.setMega(false);
+    draw_ = true;
+}
+
+// 01nn nnnn: Set I = nnnnnn, a 24 bit address.
+inline void Interpreter::ldhi_()
+{
+    if (checked_) [[unlikely]]
+        check_(pc_ - 2, pc_, 2, false);
+    i_ = nn_() << 16 | memory.read(pc_) << 8 | memory.read(pc_ + 1);
+    pc_ += 2;
+}
+
+// 02nn: Load nn colors from memory starting at location I into palette entries 1 to nn, 4 bytes each as ARGB.
+inline void Interpreter::ldpal_()
+{
+    if (checked_) [[unlikely]]
+        check_(pc_ - 2, i_, 4 * nn_(), false);
+    for (int c {0}; c != nn_(); ++c) {
+        std::array<std::uint8_t, 4> argb {};
+        memory.read(i_ + 4 * c, argb);
+        display.setColor(c + 1, argb[1] << 24 | argb[2] << 16 | argb[3] << 8 | argb[0]);
+    }
+}
+
+// 03nn: Set the sprite width to nn, 0 is 256.
+inline void Interpreter::sprw_()
+{
+    spriteWidth_ = nn_();
+}
+
+// 04nn: Set the sprite height to nn, 0 is 256.
+inline void Interpreter::sprh_()
+{
+    spriteHeight_ = nn_();
+}
+
+// 05nn: Set the screen alpha to nn.
+inline void Interpreter::alpha_()
+{
+    display.setAlpha(nn_());
+}
+
+// 060n: Play the digitised sound at I, looping unless n is 0. *NOT IMPLEMENTED*
+inline void Interpreter::digisnd_()
+{
+}
+
+// 0700: Stop the digitised sound. *NOT IMPLEMENTED*
+inline void Interpreter::stopsnd_()
+{
+}
+
+// 080n: Set the blend mode to n: normal, 25%, 50%, 75%, additive or multiply.
+inline void Interpreter::bmode_()
+{
+    display.setBlend(n_());
+}
+
+// 09nn: Set the collision color to palette index nn.
+inline void Interpreter::ccol_()
+{
+    collisionIndex_ = nn_();
+}
+
+// Dxyn: In MEGA-CHIP mode, draw a sprite of spriteWidth x spriteHeight palette indices starting at memory location
+// I at (Vx, Vy), clipped at the edges, set VF = whether it covered the collision color. Fonts keep their bits and
+// are drawn as n rows of 8 pixels in the last palette color.
+inline void Interpreter::blit_()
+{
+    bool font {i_ < Memory::programAddr};
+    int width {font ? 8 : spriteWidth_ == 0 ? 256 : spriteWidth_};
+    int height {font ? n_() : spriteHeight_ == 0 ? 256 : spriteHeight_};
+    int xcoord {v_[x_()]};
+    int ycoord {v_[y_()]};
+    if (checked_) [[unlikely]]
+        check_(pc_ - 2, i_, font ? height : width * height, false);
+
+    vf_.op = LazyFlag::none; // overwritten below
+    bool collision {false};
+    std::array<std::uint8_t, Display::megaWidth> row {};
+    for (int yline {0}; yline != height and ycoord + yline < display.height; ++yline) {
+        if (font) {
+            std::uint8_t bits {memory.read(i_ + yline)};
+            for (int xline {0}; xline != 8; ++xline)
+                row[xline] = (bits << xline & 0x80) != 0 ? 0xFF : 0;
+        } else {
+            memory.read(i_ + yline * width, {row.data(), static_cast<std::size_t>(width)});
+        }
+        collision |= display.blitRow(xcoord, ycoord + yline, {row.data(), static_cast<std::size_t>(width)}, collisionIndex_);
+    }
+    v_[0xF] = collision;
+    draw_ = true;
+}
@@ -2,36 +2,152 @@
 #define CHIP_8_CPU_H
 
 #include <cstdint>
+#include <span>
+#include <string>
+#include <vector>
 #include "../memory/Memory.h"
 #include "../display/Display.h"
 #include "../keyboard/Keyboard.h"
 
+class Capture;
+
 class Interpreter {
 public:
-    Interpreter(Memory& mem, Display& dis, Keyboard& kb) : memory{mem}, sp{&mem.stack}, display{dis}, keyboard{kb} {};
+    static constexpr std::size_t stackDepth {16};
+    static constexpr std::size_t patternSize {16}; // bytes of an XO-CHIP audio pattern
+
+    // things a well-behaved rom never does, counted instead of crashing
+    struct Faults {
+        unsigned long long undefined {0}; // opcodes with no implementation
+        unsigned long long stack {0}; // 00EE on an empty stack or 2nnn on a full one
+        unsigned long long outOfBounds {0}; // accesses past the end of ram, only counted in checked mode
+    };
+
+    // one problem found in checked mode
+    struct Diagnostic {
+        enum Kind : std::uint8_t { outOfBounds, stackOverflow, stackUnderflow, uninitialized };
+        Kind kind;
+        std::uint16_t pc; // address of the instruction
+        std::uint32_t addr; // first byte accessed, 0 for the stack
+    };
+    static constexpr std::size_t maxDiagnostics {1000};
+
+    // why run() returned
+    enum class Stop : std::uint8_t {
+        budget, // the whole budget was executed, usually the end of a frame
+        keyWait, // Fx0A is waiting for a key, which can't arrive before run() returns
+        breakpoint, // pc is on a breakpoint, not executed yet
+        display, // the last instruction changed the framebuffer, only with stopOnDisplay
+        undefined, // the last instruction was an undefined opcode
+        outOfBounds, // the last instruction accessed memory past the end of ram, only in checked mode
+        vblank, // a sprite was drawn with the display_wait quirk, nothing more runs until endOfFrame()
+    };
+    struct Run {
+        Stop stop;
+        int cycles; // instructions executed, including the one that stopped the run
+        int cost; // of the budget spent, the same as cycles unless the timing is Timing::vip
+    };
+
+    // what run() budgets are counted in
+    enum class Timing : std::uint8_t {
+        instructions, // every instruction costs 1
+        vip, // roughly the machine cycles the COSMAC VIP's interpreter took for each instruction
+    };
+    // Machine cycles a VIP had for the interpreter each frame: 3668 at 1.76MHz and 60Hz, less the 1024 the display
+    // takes and the interrupt routine.
+    static constexpr int vipFrameCycles {2594};
+
+    Interpreter(Memory& mem, Display& dis, Keyboard& kb) : sp{&mem.stack}, memory{mem}, keyboard{kb}, display{dis} {};
+    // Continues from the state of other on different hardware, used to fork a machine.
+    Interpreter(const Interpreter& other, Memory& mem, Display& dis, Keyboard& kb);
+    Interpreter(const Interpreter&) = delete;
+    Interpreter& operator=(const Interpreter&) = delete;
 
     void cycle();
+    // Executes up to budget instructions in one go. A breakpoint on pc when run() is called doesn't stop it,
+    // so calling run() again continues past the breakpoint.
+    // A budget of 0 or less runs nothing, as does any budget while waiting for vblank.
+    Run run(int budget, bool stopOnDisplay = false);
+    void setBreakpoint(std::uint16_t addr, bool on = true);
+    // Executes op as if it had just been fetched from pc, used by translated code.
+    void execute(std::uint16_t op);
+    // Superinstructions for translated code. Each does the same as calling execute() on its opcodes in turn, quirks
+    // included, without decoding them again, and returns the number of instructions executed.
+    int executeLoadDraw(std::uint16_t annn, std::uint16_t dxyn);
+    int executeBcdLoad(std::uint16_t fx33, std::uint16_t fy65);
+    int executeLoads(std::span<const std::uint16_t> ops); // any mix of 6xnn and 7xnn
+    int executeSkipJump(std::uint16_t skip, std::uint16_t jump); // 3xnn or 4xnn, then 1nnn where it doesn't skip
+    // Draws the frame if it changed, hands it to the capture, if there is one, and ends the wait for vblank.
     void endOfFrame();
+    // Every endOfFrame() submits the screen to capture from now on, nullptr stops. Forks don't inherit it.
+    void setCapture(Capture* capture) { capture_ = capture; }
+    // "default", "superchip", "xochip" or "megachip". xochip enables the XO-CHIP instructions and grows ram to 64KB,
+    // megachip enables the MEGA-CHIP ones with superchip quirks and grows ram to 16MB.
     bool setMode(const std::string&);
+    // the last mode set, "default" until then
+    [[nodiscard]] const std::string& mode() const { return mode_; }
+    // Instructions by default. Forks inherit it.
+    void setTiming(Timing timing) { timing_ = timing; }
+    [[nodiscard]] Timing timing() const { return timing_; }
+    // the run() budget of a frame, cyclesPerFrame counts instructions and is ignored under Timing::vip
+    [[nodiscard]] int frameBudget(int cyclesPerFrame) const { return timing_ == Timing::vip ? vipFrameCycles : cyclesPerFrame; }
     bool setQuirk(const std::string&);
+    // comma separated list of quirk_name=bool, as stored in the rom index
+    bool setQuirks(const std::string&);
+    [[nodiscard]] std::string quirks() const;
+    // Zobrist hash of the whole machine: ram, framebuffer, registers, timers and stack. Constant time,
+    // ram and framebuffer are tracked incrementally and the register file is hashed on the spot.
+    [[nodiscard]] std::uint64_t stateHash() const;
+    // the same hash recomputed from scratch, for verifying stateHash()
+    [[nodiscard]] std::uint64_t fullStateHash() const;
+    // undefined opcodes and diagnostics are reported to Log::global() unless logging is off
+    void setLogging(bool on) { logging_ = on; }
+    // Memory accesses wrap around at the end of ram without any checks. Checked mode also records accesses past
+    // the end, reads of bytes nothing has written yet and stack overflows as diagnostics, at some cost in speed.
+    void setChecked(bool on);
+    // the first maxDiagnostics problems found in checked mode, in order
+    [[nodiscard]] const std::vector<Diagnostic>& diagnostics() const { return diagnostics_; }
 
     // references to internals for debugging
     const std::uint16_t& pc {pc_};
     const std::uint16_t& cir {cir_};
-    const std::uint16_t& i {i_};
+    const std::uint32_t& i {i_}; // only MEGA-CHIP sets it past 16 bits
     const std::array<std::uint8_t, 16>& v {v_};
     const std::uint8_t& dt {dt_};
     const std::uint8_t& st {st_};
     const bool& waiting {waiting_};
+    const bool& vblank {vblank_}; // waiting for the end of the frame after a draw, see the display_wait quirk
+    const Faults& faults {faults_};
+    // XO-CHIP audio, kept as state but not played
+    const std::array<std::uint8_t, patternSize>& pattern {pattern_};
+    const std::uint8_t& pitch {pitch_};
+    // MEGA-CHIP sprite size, 0 stands for 256, and the palette index sprites collide with
+    const std::uint8_t& spriteWidth {spriteWidth_};
+    const std::uint8_t& spriteHeight {spriteHeight_};
+    const std::uint8_t& collisionIndex {collisionIndex_};
 private:
     static constexpr int vfReset {0};
     static constexpr int incr {1};
     static constexpr int inplace {2};
     static constexpr int jumpx {3};
     static constexpr int ioverflow {4};
+    static constexpr int displayWait {5};
 
+    template<bool stopOnDisplay, bool timed>
+    Run run_(int budget);
     void fetch_();
     void execute_();
+    // true unless the decoded instruction certainly neither reads nor writes VF
+    [[nodiscard]] bool touchesVf_() const;
+    // writes a pending flag to VF
+    void resolveFlag_();
+    void undefined_();
+    // what the instruction just executed costs under Timing::vip
+    [[nodiscard]] int vipCost_() const;
+    // in checked mode, reports the n bytes from addr the instruction at pc accesses
+    void check_(std::uint16_t pc, std::uint32_t addr, std::uint32_t n, bool write);
+    void report_(Diagnostic::Kind kind, std::uint16_t pc, std::uint32_t addr);
+    [[nodiscard]] std::uint64_t registerHash_() const;
 
     [[nodiscard]] std::uint8_t op_() const { return cir_ >> 12 & 0xF; }
     [[nodiscard]] std::uint8_t x_() const { return cir_ >> 8 & 0xF; }
@@ -56,7 +172,7 @@ private:
     void shr_(std::uint8_t, std::uint8_t);
     void subn_(std::uint8_t, std::uint8_t);
     void shl_(std::uint8_t, std::uint8_t);
-    void ldi_(std::uint16_t);
+    void ldi_(std::uint32_t);
     void jpo_();
     void rnd_();
     void drw_();
@@ -76,19 +192,69 @@ private:
     void sf_();
     void lf_();
 
+    // xo-chip instructions
+    void scu_();
+    void svr_();
+    void lvr_();
+    void ldil_();
+    void plane_();
+    void audio_();
+    void setPitch_();
+
+    // mega-chip instructions
+    void megaOn_();
+    void megaOff_();
+    void ldhi_();
+    void ldpal_();
+    void sprw_();
+    void sprh_();
+    void alpha_();
+    void digisnd_();
+    void stopsnd_();
+    void bmode_();
+    void ccol_();
+    void blit_();
+
     std::uint16_t pc_ {0x200}; // program counter
     std::uint16_t cir_ {0}; // current instruction register
-    std::uint16_t i_ {0}; // index register
+    std::uint32_t i_ {0}; // index register
     std::array<std::uint8_t, 16> v_ {}; // general purpose registers
     std::uint8_t dt_ {0}; // dt timer register
     std::uint8_t st_ {0}; // st timer register
-    std::array<std::uint8_t, 8> flag_ {}; // superchip flag registers
+    std::array<std::uint8_t, 16> flag_ {}; // superchip flag registers, xo-chip has twice as many
+    std::array<std::uint8_t, patternSize> pattern_ {}; // xo-chip audio pattern buffer
+    std::uint8_t pitch_ {64}; // xo-chip audio pitch register
+    std::uint8_t spriteWidth_ {0}; // mega-chip sprite registers
+    std::uint8_t spriteHeight_ {0};
+    std::uint8_t collisionIndex_ {0};
 
     bool waiting_ {false}; // waiting for key flag
+    bool vblank_ {false}; // waiting for the end of the frame
     bool draw_ {false}; // draw flag
+    bool logging_ {true};
+    bool checked_ {false};
+    bool xochip_ {false};
+    bool megachip_ {false};
+    std::string mode_ {"default"};
+    Timing timing_ {Timing::instructions};
+    Faults faults_ {};
+    std::vector<Diagnostic> diagnostics_ {};
+
+    // VF of the last 8xy4-8xyE, computed only once something can see it. Between instructions of run() the
+    // flag may be pending, after cycle(), execute() and run() return it is always in VF.
+    struct LazyFlag {
+        enum Op : std::uint8_t { none, carry, greater, low, high };
+        Op op {none};
+        std::uint8_t a {0}; // operands before the instruction
+        std::uint8_t b {0};
+    };
+    LazyFlag vf_ {};
+    std::vector<bool> breakpoints_ {}; // by address, empty until the first breakpoint is set
+    std::uint64_t stackHash_ {0};
+    Capture* capture_ {nullptr};
 
     // defaults to chip-8 quirks
-    std::array<bool, 5> quirk_ {true, true, false, false, false};
+    std::array<bool, 6> quirk_ {true, true, false, false, false, true};
 
     // stack pointer
     std::stack<std::uint16_t>* sp;
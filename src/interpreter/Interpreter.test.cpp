@@ -520,4 +520,364 @@ interpreter.cycle();
 EXPECT_EQ(interpreter.v[0], 84);
 EXPECT_EQ(interpreter.v[1], 88);
 EXPECT_EQ(interpreter.cir, 0xF165);
-}
\ No newline at end of file
+}
+TEST_F(InterpreterTest, stateHashTracksChanges)
+{
+std::uint64_t initial {interpreter.stateHash()};
+EXPECT_EQ(initial, interpreter.fullStateHash());
+
+// v0 := 0xFF, i := 0x300, bcd v0, call 0x20A, sprite v0 v0 5, return
+setRegisterInstr(0x60, 0xFF);
+setRegisterInstr(0xA3, 0x00, 2);
+setRegisterInstr(0xF0, 0x33, 4);
+setRegisterInstr(0x22, 0x0A, 6);
+setRegisterInstr(0xD0, 0x05, 10);
+setRegisterInstr(0x00, 0xEE, 12);
+for (int n {0}; n != 5; ++n) {
+interpreter.cycle();
+EXPECT_EQ(interpreter.stateHash(), interpreter.fullStateHash());
+}
+EXPECT_NE(interpreter.stateHash(), initial);
+
+display.scrollRight();
+display.scrollDown(3);
+EXPECT_EQ(interpreter.stateHash(), interpreter.fullStateHash());
+interpreter.cycle();
+EXPECT_EQ(interpreter.stateHash(), interpreter.fullStateHash());
+}
+
+TEST_F(InterpreterTest, stateHashIgnoresOrderOfWrites)
+{
+Memory other {};
+memory.write(1, 0x300);
+memory.write(2, 0x301);
+other.write(2, 0x301);
+other.write(1, 0x300);
+EXPECT_EQ(memory.stateHash(), other.stateHash());
+
+memory.write(0, 0x300);
+EXPECT_NE(memory.stateHash(), other.stateHash());
+other.write(0, 0x300);
+EXPECT_EQ(memory.stateHash(), other.stateHash());
+}
+
+TEST_F(InterpreterTest, runExecutesWholeBudget)
+{
+// 200: v0 += 1, 202: jump 200
+setRegisterInstr(0x70, 0x01);
+setRegisterInstr(0x12, 0x00, 2);
+Interpreter::Run run {interpreter.run(20)};
+EXPECT_EQ(run.stop, Interpreter::Stop::budget);
+EXPECT_EQ(run.cycles, 20);
+EXPECT_EQ(interpreter.v[0], 10);
+}
+
+TEST_F(InterpreterTest, runStopsOnEvents)
+{
+interpreter.setLogging(false);
+interpreter.setQuirk("display_wait=false");
+// 200: i := hex v0, 202: sprite v0 v0 1, 204: 0x8008 (undefined), 206: wait for key v1
+setRegisterInstr(0xF0, 0x29);
+setRegisterInstr(0xD0, 0x01, 2);
+setRegisterInstr(0x80, 0x08, 4);
+setRegisterInstr(0xF1, 0x0A, 6);
+interpreter.setBreakpoint(0x202);
+
+Interpreter::Run run {interpreter.run(20, true)};
+EXPECT_EQ(run.stop, Interpreter::Stop::breakpoint);
+EXPECT_EQ(run.cycles, 1);
+EXPECT_EQ(interpreter.pc, 0x202);
+
+run = interpreter.run(20, true);
+EXPECT_EQ(run.stop, Interpreter::Stop::display);
+EXPECT_EQ(run.cycles, 1);
+
+run = interpreter.run(20, true);
+EXPECT_EQ(run.stop, Interpreter::Stop::undefined);
+EXPECT_EQ(interpreter.faults.undefined, 1);
+
+run = interpreter.run(20, true);
+EXPECT_EQ(run.stop, Interpreter::Stop::keyWait);
+EXPECT_EQ(run.cycles, 1);
+EXPECT_EQ(interpreter.pc, 0x206);
+}
+
+TEST_F(InterpreterTest, runStopsOutOfBounds)
+{
+interpreter.setLogging(false);
+interpreter.setChecked(true);
+// 200: i := 0xFFF, 202: load v1
+setRegisterInstr(0xAF, 0xFF);
+setRegisterInstr(0xF1, 0x65, 2);
+Interpreter::Run run {interpreter.run(20)};
+EXPECT_EQ(run.stop, Interpreter::Stop::outOfBounds);
+EXPECT_EQ(run.cycles, 2);
+EXPECT_EQ(interpreter.faults.outOfBounds, 1);
+ASSERT_EQ(interpreter.diagnostics().size(), 1);
+EXPECT_EQ(interpreter.diagnostics()[0].kind, Interpreter::Diagnostic::outOfBounds);
+EXPECT_EQ(interpreter.diagnostics()[0].pc, 0x202);
+EXPECT_EQ(interpreter.diagnostics()[0].addr, 0xFFF);
+}
+
+TEST_F(InterpreterTest, runWaitsForVblankAfterDrawing)
+{
+// 200: i := hex v0, 202: sprite v0 v0 1, 204: jump 200
+setRegisterInstr(0xF0, 0x29);
+setRegisterInstr(0xD0, 0x01, 2);
+setRegisterInstr(0x12, 0x00, 4);
+Interpreter::Run run {interpreter.run(20)};
+EXPECT_EQ(run.stop, Interpreter::Stop::vblank);
+EXPECT_EQ(run.cycles, 2);
+EXPECT_TRUE(interpreter.vblank);
+
+run = interpreter.run(20);
+EXPECT_EQ(run.stop, Interpreter::Stop::vblank);
+EXPECT_EQ(run.cycles, 0);
+EXPECT_EQ(interpreter.pc, 0x204);
+
+interpreter.endOfFrame();
+EXPECT_FALSE(interpreter.vblank);
+EXPECT_EQ(interpreter.run(20).cycles, 3);
+
+interpreter.endOfFrame();
+interpreter.setMode("superchip");
+EXPECT_EQ(interpreter.run(20).stop, Interpreter::Stop::budget);
+}
+
+TEST_F(InterpreterTest, vipTimingSpendsCyclesPerInstruction)
+{
+// 200: v0 += 1, 202: jump 200, 50 and 52 cycles
+setRegisterInstr(0x70, 0x01);
+setRegisterInstr(0x12, 0x00, 2);
+interpreter.setTiming(Interpreter::Timing::vip);
+ASSERT_EQ(interpreter.frameBudget(20), Interpreter::vipFrameCycles);
+Interpreter::Run run {interpreter.run(Interpreter::vipFrameCycles)};
+EXPECT_EQ(run.stop, Interpreter::Stop::budget);
+EXPECT_EQ(run.cycles, 51);
+EXPECT_EQ(run.cost, 51 / 2 * 102 + 50);
+EXPECT_EQ(interpreter.v[0], 26);
+
+interpreter.setTiming(Interpreter::Timing::instructions);
+EXPECT_EQ(interpreter.frameBudget(20), 20);
+run = interpreter.run(20);
+EXPECT_EQ(run.cost, 20);
+}
+
+TEST_F(InterpreterTest, displayWaitFollowsTheMode)
+{
+EXPECT_EQ(interpreter.quirks(), "vf_reset=true,memory=true,shifting=false,jumping=false,ioverflow=false,display_wait=true");
+interpreter.setMode("xochip");
+EXPECT_EQ(interpreter.mode(), "xochip");
+EXPECT_NE(interpreter.quirks().find("display_wait=false"), std::string::npos);
+EXPECT_TRUE(interpreter.setQuirk("display_wait=true"));
+EXPECT_NE(interpreter.quirks().find("display_wait=true"), std::string::npos);
+}
+
+TEST_F(InterpreterTest, checkedModeReportsStackAndUninitializedReads)
+{
+interpreter.setLogging(false);
+interpreter.setChecked(true);
+// 200: return, 202: i := 0x300, 204: load v0
+setRegisterInstr(0x00, 0xEE);
+setRegisterInstr(0xA3, 0x00, 2);
+setRegisterInstr(0xF0, 0x65, 4);
+interpreter.run(3);
+
+ASSERT_EQ(interpreter.diagnostics().size(), 2);
+EXPECT_EQ(interpreter.diagnostics()[0].kind, Interpreter::Diagnostic::stackUnderflow);
+EXPECT_EQ(interpreter.diagnostics()[0].pc, 0x200);
+EXPECT_EQ(interpreter.diagnostics()[1].kind, Interpreter::Diagnostic::uninitialized);
+EXPECT_EQ(interpreter.diagnostics()[1].pc, 0x204);
+EXPECT_EQ(interpreter.diagnostics()[1].addr, 0x300);
+}
+
+TEST_F(InterpreterTest, runResolvesPendingFlags)
+{
+// 200: v0 := 0xFF, 202: v1 := 1, 204: v0 += v1 (carry), 206: v2 := vf, 208: v0 -= v1 (borrow), 20A: v3 <<= v0
+setRegisterInstr(0x60, 0xFF);
+setRegisterInstr(0x61, 0x01, 2);
+setRegisterInstr(0x80, 0x14, 4);
+setRegisterInstr(0x82, 0xF0, 6);
+setRegisterInstr(0x80, 0x15, 8);
+setRegisterInstr(0x83, 0x0E, 10);
+interpreter.run(5);
+EXPECT_EQ(interpreter.v[2], 1);
+EXPECT_EQ(interpreter.v[0], 0xFF);
+EXPECT_EQ(interpreter.v[0xF], 0);
+
+interpreter.run(1);
+EXPECT_EQ(interpreter.v[0xF], 1);
+EXPECT_EQ(interpreter.stateHash(), interpreter.fullStateHash());
+}
+
+TEST_F(InterpreterTest, xoChipInstructionsNeedXoChipMode)
+{
+interpreter.setLogging(false);
+interpreter.execute(0xF000);
+EXPECT_EQ(interpreter.faults.undefined, 1);
+EXPECT_EQ(memory.size(), Memory::ramSize);
+
+EXPECT_TRUE(interpreter.setMode("xochip"));
+EXPECT_EQ(memory.size(), Memory::xoRamSize);
+interpreter.execute(0xF000);
+EXPECT_EQ(interpreter.faults.undefined, 1);
+}
+
+TEST_F(InterpreterTest, xoChipLongLoadIsSkippedWhole)
+{
+interpreter.setMode("xochip");
+// 200: i := long 0x1234, 204: if v0 != 0 then, 206: i := long 0x5678, 20A
+setRegisterInstr(0xF0, 0x00);
+setRegisterInstr(0x12, 0x34, 2);
+setRegisterInstr(0x30, 0x00, 4);
+setRegisterInstr(0xF0, 0x00, 6);
+setRegisterInstr(0x56, 0x78, 8);
+interpreter.cycle();
+EXPECT_EQ(interpreter.i, 0x1234);
+EXPECT_EQ(interpreter.pc, 0x204);
+interpreter.cycle();
+EXPECT_EQ(interpreter.pc, 0x20A);
+EXPECT_EQ(interpreter.i, 0x1234);
+}
+
+TEST_F(InterpreterTest, xoChipRegisterRanges)
+{
+interpreter.setMode("xochip");
+interpreter.execute(0x6101);
+interpreter.execute(0x6202);
+interpreter.execute(0x6303);
+interpreter.execute(0xA300);
+interpreter.execute(0x5132); // save v1 - v3
+EXPECT_EQ(memory.read(0x300), 1);
+EXPECT_EQ(memory.read(0x302), 3);
+EXPECT_EQ(interpreter.i, 0x300);
+
+interpreter.execute(0x5312); // save v3 - v1
+EXPECT_EQ(memory.read(0x300), 3);
+EXPECT_EQ(memory.read(0x302), 1);
+interpreter.execute(0x5453); // load v4 - v5
+EXPECT_EQ(interpreter.v[4], 3);
+EXPECT_EQ(interpreter.v[5], 2);
+}
+
+TEST_F(InterpreterTest, xoChipDrawsBothPlanes)
+{
+interpreter.setMode("xochip");
+memory.write(static_cast<std::uint8_t>(0x80), static_cast<std::uint16_t>(0x300)); // first plane
+memory.write(static_cast<std::uint8_t>(0xC0), static_cast<std::uint16_t>(0x301)); // second plane
+interpreter.execute(0xF301); // plane 3
+interpreter.execute(0xA300);
+interpreter.execute(0xD001);
+EXPECT_EQ(display.row(0)[0], 3);
+EXPECT_EQ(display.row(0)[1], 2);
+EXPECT_EQ(interpreter.v[0xF], 0);
+EXPECT_EQ(display.stateHash(), display.fullStateHash());
+
+interpreter.execute(0xF201); // plane 2
+interpreter.execute(0x00D1); // scroll up 1
+EXPECT_EQ(display.row(0)[0], 1);
+EXPECT_EQ(display.row(31)[0], 0);
+interpreter.execute(0x00E0);
+interpreter.execute(0xF101); // plane 1
+interpreter.execute(0xD001);
+EXPECT_EQ(interpreter.v[0xF], 1);
+EXPECT_EQ(display.row(0)[0], 0);
+EXPECT_EQ(display.stateHash(), display.fullStateHash());
+EXPECT_EQ(interpreter.stateHash(), interpreter.fullStateHash());
+}
+
+TEST_F(InterpreterTest, xoChipAudioState)
+{
+interpreter.setMode("xochip");
+memory.write(static_cast<std::uint8_t>(0xF0), static_cast<std::uint16_t>(0x30F));
+interpreter.execute(0xA300);
+interpreter.execute(0xF002);
+EXPECT_EQ(interpreter.pattern[15], 0xF0);
+interpreter.execute(0x6170);
+interpreter.execute(0xF13A);
+EXPECT_EQ(interpreter.pitch, 0x70);
+}
+
+TEST_F(InterpreterTest, megaChipInstructionsNeedMegaChipMode)
+{
+interpreter.setLogging(false);
+interpreter.execute(0x0011);
+EXPECT_EQ(interpreter.faults.undefined, 1);
+EXPECT_EQ(display.width, 64);
+
+EXPECT_TRUE(interpreter.setMode("megachip"));
+EXPECT_EQ(memory.size(), Memory::megaRamSize);
+interpreter.execute(0x0011);
+EXPECT_EQ(interpreter.faults.undefined, 1);
+EXPECT_TRUE(display.mega());
+EXPECT_EQ(display.width, Display::megaWidth);
+EXPECT_EQ(display.height, Display::megaHeight);
+interpreter.execute(0x0010);
+EXPECT_FALSE(display.mega());
+EXPECT_EQ(display.width, 64);
+}
+
+TEST_F(InterpreterTest, megaChipLongLoadIsSkippedWhole)
+{
+interpreter.setMode("megachip");
+// 200: ldhi 0x123456, 204: if v0 != 0 then, 206: ldhi 0x000300, 20A
+setRegisterInstr(0x01, 0x12);
+setRegisterInstr(0x34, 0x56, 2);
+setRegisterInstr(0x30, 0x00, 4);
+setRegisterInstr(0x01, 0x00, 6);
+setRegisterInstr(0x03, 0x00, 8);
+interpreter.cycle();
+EXPECT_EQ(interpreter.i, 0x123456);
+EXPECT_EQ(interpreter.pc, 0x204);
+interpreter.cycle();
+EXPECT_EQ(interpreter.pc, 0x20A);
+
+memory.write(static_cast<std::uint8_t>(0xAB), 0x123456);
+interpreter.execute(0x6000);
+interpreter.execute(0xF065);
+EXPECT_EQ(interpreter.v[0], 0xAB);
+}
+
+TEST_F(InterpreterTest, megaChipBlitsPaletteSprites)
+{
+interpreter.setMode("megachip");
+interpreter.execute(0x0011);
+// two colors, ARGB
+std::vector<std::uint8_t> colors {0xFF, 0x10, 0x20, 0x30, 0xFF, 0x80, 0x80, 0x80};
+memory.write(colors, 0x300);
+interpreter.execute(0xA300);
+interpreter.execute(0x0202);
+// a 3x2 sprite with a transparent pixel
+std::vector<std::uint8_t> sprite {1, 0, 2, 2, 2, 1};
+memory.write(sprite, 0x310);
+interpreter.execute(0x0303);
+interpreter.execute(0x0402);
+interpreter.execute(0x0902); // collide with color 2
+interpreter.execute(0xA310);
+interpreter.execute(0x60FE); // x, clipped after 2 pixels
+interpreter.execute(0x6110);
+interpreter.execute(0xD011);
+EXPECT_EQ(display.row(0x10)[0xFE], 1);
+EXPECT_EQ(display.row(0x10)[0xFF], 0);
+EXPECT_EQ(display.row(0x11)[0xFF], 2);
+EXPECT_EQ(display.color(0xFE, 0x10), 0x102030FFu);
+EXPECT_EQ(interpreter.v[0xF], 0);
+EXPECT_EQ(interpreter.stateHash(), interpreter.fullStateHash());
+
+// 50% blend of color 1 over color 2 where they overlap
+interpreter.execute(0x0802);
+interpreter.execute(0x60FD);
+interpreter.execute(0xD011);
+EXPECT_EQ(interpreter.v[0xF], 1);
+EXPECT_EQ(display.row(0x11)[0xFF], 1);
+EXPECT_EQ(display.color(0xFF, 0x11), 0x485058FFu);
+EXPECT_EQ(interpreter.stateHash(), interpreter.fullStateHash());
+
+interpreter.execute(0x00B1); // scroll up 1
+EXPECT_EQ(display.row(0x10)[0xFF], 1);
+EXPECT_EQ(display.color(0xFF, 0x10), 0x485058FFu);
+EXPECT_EQ(interpreter.stateHash(), interpreter.fullStateHash());
+interpreter.execute(0x00E0);
+EXPECT_EQ(display.row(0x10)[0xFF], 0);
+EXPECT_NE(display.stateHash(), 0); // the palette is still changed
+}
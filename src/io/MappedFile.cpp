@@ -0,0 +1,75 @@
+#include "MappedFile.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+
+MappedFile::MappedFile(const std::filesystem::path& path)
+{
+    file_ = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file_ == INVALID_HANDLE_VALUE) {
+        file_ = nullptr;
+        return;
+    }
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file_, &size))
+        return;
+    size_ = static_cast<std::size_t>(size.QuadPart);
+    opened_ = true;
+    if (size_ == 0)
+        return; // empty files can't be mapped
+
+    mapping_ = CreateFileMappingW(file_, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (mapping_)
+        data_ = static_cast<const std::uint8_t*>(MapViewOfFile(mapping_, FILE_MAP_READ, 0, 0, 0));
+    if (!data_) {
+        size_ = 0;
+        opened_ = false;
+    }
+}
+
+MappedFile::~MappedFile()
+{
+    if (data_)
+        UnmapViewOfFile(data_);
+    if (mapping_)
+        CloseHandle(mapping_);
+    if (file_)
+        CloseHandle(file_);
+}
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+MappedFile::MappedFile(const std::filesystem::path& path)
+{
+    int fd {open(path.c_str(), O_RDONLY)};
+    if (fd < 0)
+        return;
+
+    struct stat info {};
+    if (fstat(fd, &info) == 0 and S_ISREG(info.st_mode)) {
+        size_ = static_cast<std::size_t>(info.st_size);
+        opened_ = true;
+        if (size_ != 0) {
+            void* addr {mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0)};
+            if (addr == MAP_FAILED) {
+                size_ = 0;
+                opened_ = false;
+            } else {
+                data_ = static_cast<const std::uint8_t*>(addr);
+            }
+        }
+    }
+    close(fd); // the mapping keeps the file alive
+}
+
+MappedFile::~MappedFile()
+{
+    if (data_)
+        munmap(const_cast<std::uint8_t*>(data_), size_);
+}
+#endif
@@ -0,0 +1,29 @@
+#ifndef CHIP_8_MAPPEDFILE_H
+#define CHIP_8_MAPPEDFILE_H
+
+#include <cstdint>
+#include <filesystem>
+#include <span>
+
+// Read-only memory mapping of a whole file. Empty if the file could not be opened.
+class MappedFile {
+public:
+    explicit MappedFile(const std::filesystem::path& path);
+    ~MappedFile();
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    [[nodiscard]] bool isOpen() const { return opened_; }
+    [[nodiscard]] std::span<const std::uint8_t> bytes() const { return {data_, size_}; }
+private:
+    const std::uint8_t* data_ {nullptr};
+    std::size_t size_ {0};
+    bool opened_ {false};
+#ifdef _WIN32
+    void* file_ {nullptr};
+    void* mapping_ {nullptr};
+#endif
+};
+
+
+#endif //CHIP_8_MAPPEDFILE_H
@@ -1,7 +1,26 @@
 #include "Keyboard.h"
+#include <bit>
 
-bool Keyboard::isPressed(std::uint8_t key) {
-    return SDL_GetKeyboardState(nullptr)[keyMap[key]];
+bool Keyboard::isPressed(std::uint8_t key) const {
+    key &= 0xF;
+    return (mask_ >> key & 1) != 0 or (hostKeys_ and SDL_GetKeyboardState(nullptr)[keyMap[key]]);
+}
+
+void Keyboard::setMask(std::uint16_t mask)
+{
+    std::uint16_t up {static_cast<std::uint16_t>(mask_ & ~mask)};
+    if (up != 0 and released == nullKey)
+        released = std::countr_zero(up);
+    mask_ = mask;
+}
+
+std::uint16_t Keyboard::hostMask()
+{
+    const Uint8* state {SDL_GetKeyboardState(nullptr)};
+    std::uint16_t mask {0};
+    for (std::size_t key {0}; key != keyMap.size(); ++key)
+        mask |= state[keyMap[key]] << key;
+    return mask;
 }
 
 void Keyboard::reset()
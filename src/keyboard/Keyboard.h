@@ -10,8 +10,16 @@ class Keyboard {
 public:
     static constexpr int nullKey {255};
 
-    static bool isPressed(std::uint8_t) ;
+    bool isPressed(std::uint8_t) const;
     std::uint8_t wasPressed();
+    // Keys held by a program instead of a player, bit n is key n. Releasing a key counts for Fx0A like a key up event.
+    void setMask(std::uint16_t);
+    [[nodiscard]] std::uint16_t mask() const { return mask_; }
+    // Whether isPressed() also sees keys held on the host keyboard. Turn it off when setMask() supplies every key,
+    // as it must for machines run on other threads or run again later.
+    void setHostKeys(bool on) { hostKeys_ = on; }
+    // keys held on the host keyboard as a mask like setMask() takes, only call it from the thread polling SDL events
+    [[nodiscard]] static std::uint16_t hostMask();
     void onKeyDown(SDL_Scancode&);
     void onKeyUp(SDL_Scancode&);
     void reset();
@@ -36,6 +44,8 @@ private:
     };
     std::unordered_map<SDL_Scancode, std::uint8_t> keysDown;
     std::uint8_t released {nullKey};
+    std::uint16_t mask_ {0};
+    bool hostKeys_ {true};
 };
 
 
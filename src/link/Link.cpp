@@ -0,0 +1,146 @@
+#include "Link.h"
+
+#ifdef _WIN32
+
+Link::Link(const std::filesystem::path&)
+{
+}
+
+Link::Link(int, int)
+{
+}
+
+Link::~Link() = default;
+
+bool Link::send(Message)
+{
+    return false;
+}
+
+std::optional<Link::Message> Link::receive()
+{
+    return std::nullopt;
+}
+
+#else
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <thread>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0 // macOS, where a closed link raises SIGPIPE
+#endif
+
+Link::Link(const std::filesystem::path& path)
+{
+    sockaddr_un address {};
+    address.sun_family = AF_UNIX;
+    std::string name {path.string()};
+    if (name.size() >= sizeof address.sun_path)
+        return;
+    std::memcpy(address.sun_path, name.c_str(), name.size() + 1);
+    auto* generic {reinterpret_cast<sockaddr*>(&address)};
+
+    // whoever binds the path first listens, the other finds it taken and connects
+    for (int attempt {0}; attempt != 2; ++attempt) {
+        int listener {::socket(AF_UNIX, SOCK_STREAM, 0)};
+        if (listener == -1)
+            return;
+        if (::bind(listener, generic, sizeof address) == 0) {
+            if (::listen(listener, 1) == 0)
+                socket_ = ::accept(listener, nullptr, nullptr);
+            std::error_code ec;
+            std::filesystem::remove(path, ec);
+            ::close(listener);
+            player_ = 0;
+            return;
+        }
+        int error {errno};
+        ::close(listener);
+        if (error != EADDRINUSE)
+            return;
+
+        // the other player may have bound the path but not be listening yet
+        for (int tries {0}; tries != 20; ++tries) {
+            int fd {::socket(AF_UNIX, SOCK_STREAM, 0)};
+            if (fd == -1)
+                return;
+            if (::connect(fd, generic, sizeof address) == 0) {
+                socket_ = fd;
+                player_ = 1;
+                return;
+            }
+            ::close(fd);
+            std::this_thread::sleep_for(std::chrono::milliseconds {10});
+        }
+
+        // nobody is there, but a socket file left behind by a session that ended badly may be. Anything else
+        // at the path is not ours to delete.
+        std::error_code ec;
+        if (attempt != 0 or !std::filesystem::is_socket(path, ec))
+            return;
+        std::filesystem::remove(path, ec);
+    }
+}
+
+Link::Link(int socket, int player)
+    : socket_{socket}, player_{player}
+{
+}
+
+Link::~Link()
+{
+    if (socket_ != -1)
+        ::close(socket_);
+}
+
+bool Link::send(Message message)
+{
+    std::array<std::uint8_t, messageSize_> bytes {};
+    for (int b {0}; b != 8; ++b)
+        bytes[b] = static_cast<std::uint8_t>(message.frame >> 8 * b);
+    bytes[8] = static_cast<std::uint8_t>(message.keys);
+    bytes[9] = static_cast<std::uint8_t>(message.keys >> 8);
+
+    for (std::size_t sent {0}; isOpen() and sent != bytes.size();) {
+        auto n {::send(socket_, bytes.data() + sent, bytes.size() - sent, MSG_NOSIGNAL)};
+        if (n > 0) {
+            sent += n;
+        } else if (errno != EINTR) {
+            ::close(socket_);
+            socket_ = -1;
+        }
+    }
+    return isOpen();
+}
+
+std::optional<Link::Message> Link::receive()
+{
+    // never waits, a message only partly there stays in received_ until the rest arrives
+    while (isOpen() and receivedBytes_ != messageSize_) {
+        auto n {::recv(socket_, received_.data() + receivedBytes_, messageSize_ - receivedBytes_, MSG_DONTWAIT)};
+        if (n > 0) {
+            receivedBytes_ += n;
+        } else if (n == 0 or (errno != EAGAIN and errno != EWOULDBLOCK and errno != EINTR)) {
+            ::close(socket_);
+            socket_ = -1;
+        } else if (errno != EINTR) {
+            return std::nullopt;
+        }
+    }
+    if (receivedBytes_ != messageSize_)
+        return std::nullopt;
+
+    receivedBytes_ = 0;
+    Message message {};
+    for (int b {0}; b != 8; ++b)
+        message.frame |= static_cast<std::uint64_t>(received_[b]) << 8 * b;
+    message.keys = static_cast<std::uint16_t>(received_[8] | received_[9] << 8);
+    return message;
+}
+
+#endif
@@ -0,0 +1,42 @@
+#ifndef CHIP_8_LINK_H
+#define CHIP_8_LINK_H
+
+#include <array>
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+
+// The connection between the two players of a link session, a stream socket carrying the keys each of them held
+// per frame, 10 bytes a frame. Only available where there are Unix domain sockets.
+class Link {
+public:
+    struct Message {
+        std::uint64_t frame {0};
+        std::uint16_t keys {0};
+    };
+
+    // Connects to the player listening at path, or when nobody listens there listens itself and waits for the other player.
+    explicit Link(const std::filesystem::path& path);
+    // Takes over a connected socket, one end of a socketpair() for instance. The first player is the one that listened.
+    Link(int socket, int player);
+    ~Link();
+    Link(const Link&) = delete;
+    Link& operator=(const Link&) = delete;
+
+    [[nodiscard]] bool isOpen() const { return socket_ != -1; }
+    // 0 for the player that listened, 1 for the one that connected
+    [[nodiscard]] int player() const { return player_; }
+    bool send(Message message);
+    // The next message that arrived, nullopt when there is none yet. Closes the link once the other side is gone.
+    std::optional<Message> receive();
+private:
+    static constexpr std::size_t messageSize_ {10};
+
+    int socket_ {-1};
+    int player_ {0};
+    std::array<std::uint8_t, messageSize_> received_ {}; // of a message not complete yet
+    std::size_t receivedBytes_ {0};
+};
+
+
+#endif //CHIP_8_LINK_H
@@ -0,0 +1,72 @@
+#include <gtest/gtest.h>
+#include <format>
+#include <fstream>
+#include <future>
+#include "Link.h"
+
+#ifndef _WIN32
+#include <sys/socket.h>
+#include <unistd.h>
+
+TEST(LinkTest, messagesArriveInOrder)
+{
+    int sockets[2];
+    ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, sockets), 0);
+    Link first {sockets[0], 0};
+    Link second {sockets[1], 1};
+
+    EXPECT_FALSE(second.receive());
+    EXPECT_TRUE(first.send({.frame = 0x0123456789, .keys = 0x8001}));
+    EXPECT_TRUE(first.send({.frame = 0x012345678A, .keys = 0}));
+
+    std::optional<Link::Message> message {second.receive()};
+    ASSERT_TRUE(message);
+    EXPECT_EQ(message->frame, 0x0123456789);
+    EXPECT_EQ(message->keys, 0x8001);
+    message = second.receive();
+    ASSERT_TRUE(message);
+    EXPECT_EQ(message->frame, 0x012345678A);
+    EXPECT_FALSE(second.receive());
+    EXPECT_TRUE(second.isOpen());
+}
+
+TEST(LinkTest, closesWhenTheOtherSideIsGone)
+{
+    int sockets[2];
+    ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, sockets), 0);
+    Link second {sockets[1], 1};
+    {
+        Link first {sockets[0], 0};
+    }
+
+    EXPECT_FALSE(second.receive());
+    EXPECT_FALSE(second.isOpen());
+    EXPECT_FALSE(second.send({}));
+}
+
+TEST(LinkTest, playersStartedTogetherFindEachOther)
+{
+    std::filesystem::path path {std::filesystem::temp_directory_path() / std::format("schip8-link-{:d}", ::getpid())};
+    for (int n {0}; n != 20; ++n) {
+        auto other {std::async(std::launch::async, [&] { return std::make_unique<Link>(path); })};
+        Link link {path};
+        std::unique_ptr<Link> second {other.get()};
+
+        ASSERT_TRUE(link.isOpen());
+        ASSERT_TRUE(second->isOpen());
+        EXPECT_EQ(link.player() + second->player(), 1);
+        EXPECT_FALSE(std::filesystem::exists(path));
+    }
+}
+
+TEST(LinkTest, leavesFilesThatArentSocketsAlone)
+{
+    std::filesystem::path path {std::filesystem::temp_directory_path() / std::format("schip8-save-{:d}", ::getpid())};
+    std::ofstream {path} << "save";
+    Link link {path};
+
+    EXPECT_FALSE(link.isOpen());
+    EXPECT_TRUE(std::filesystem::is_regular_file(path));
+    std::filesystem::remove(path);
+}
+#endif
@@ -0,0 +1,63 @@
+#include "Rollback.h"
+#include <algorithm>
+#include <experimental/random>
+#include <utility>
+
+Rollback::Rollback(const Machine& start, int cyclesPerFrame)
+    : machine_{start.fork()}, cyclesPerFrame_{cyclesPerFrame}
+{
+    // a frame run again has to see the keys it saw the first time
+    machine_->keyboard.setHostKeys(false);
+}
+
+std::uint16_t Rollback::remoteKeys_(std::uint64_t frame) const
+{
+    if (frame < remote_.size())
+        return remote_[frame];
+    return remote_.empty() ? 0 : remote_.back();
+}
+
+void Rollback::run_(std::uint64_t frame)
+{
+    states_[frame % slots_] = machine_->fork();
+    guessed_[frame % slots_] = remoteKeys_(frame);
+    machine_->keyboard.setMask(local_[frame] | guessed_[frame % slots_]);
+    std::experimental::reseed(machine_->interpreter.stateHash() ^ frame);
+    machine_->frame(cyclesPerFrame_);
+}
+
+void Rollback::rollback_()
+{
+    std::uint64_t from {std::exchange(wrongFrom_, ~0ull)};
+    if (from >= frame())
+        return;
+
+    auto start {std::chrono::steady_clock::now()};
+    machine_ = std::move(states_[from % slots_]);
+    for (std::uint64_t f {from}; f != frame(); ++f)
+        run_(f);
+    auto cost {std::chrono::steady_clock::now() - start};
+
+    ++stats_.rollbacks;
+    stats_.resimulated += frame() - from;
+    stats_.cost += cost;
+    stats_.worst = std::max<std::chrono::nanoseconds>(stats_.worst, cost);
+}
+
+void Rollback::advance(std::uint16_t local)
+{
+    rollback_();
+    local_.push_back(local);
+    run_(frame() - 1);
+    ++stats_.frames;
+}
+
+bool Rollback::confirm(std::uint64_t frame, std::uint16_t remote)
+{
+    if (frame != confirmed())
+        return false;
+    remote_.push_back(remote);
+    if (frame < this->frame() and guessed_[frame % slots_] != remote)
+        wrongFrom_ = std::min(wrongFrom_, frame);
+    return true;
+}
@@ -0,0 +1,64 @@
+#ifndef CHIP_8_ROLLBACK_H
+#define CHIP_8_ROLLBACK_H
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include "../machine/Machine.h"
+
+// Runs a machine shared by a local and a remote player who only exchange the keys they hold each frame. The
+// local side doesn't wait for remote keys: it predicts the remote player still holds what they held last, and once
+// the real keys for a frame arrive and differ from the guess, it goes back to the state before that frame and runs
+// every frame since again. States are forks of the machine, see Machine::fork(), so saving one every frame is cheap.
+// Both sides see the same machine as long as they start from the same one, Cxnn is reseeded from the state every frame.
+class Rollback {
+public:
+    // frames the local side may run ahead of the last remote keys it has, and so the most a rollback goes back
+    static constexpr int maxFrames {8};
+
+    struct Stats {
+        unsigned long long frames {0}; // run for the first time
+        unsigned long long rollbacks {0};
+        unsigned long long resimulated {0}; // frames run again
+        std::chrono::nanoseconds cost {0}; // spent running frames again
+        std::chrono::nanoseconds worst {0}; // the most any rollback took
+    };
+
+    Rollback(const Machine& start, int cyclesPerFrame);
+
+    [[nodiscard]] const Machine& machine() const { return *machine_; }
+    // frames run so far, the next frame advance() runs
+    [[nodiscard]] std::uint64_t frame() const { return local_.size(); }
+    // frames the remote keys are known for
+    [[nodiscard]] std::uint64_t confirmed() const { return remote_.size(); }
+    [[nodiscard]] bool canAdvance() const { return frame() < confirmed() + maxFrames; }
+    [[nodiscard]] const Stats& stats() const { return stats_; }
+
+    // Runs the next frame with the local keys and a guess at the remote ones, after any rollback confirm() asked for.
+    void advance(std::uint16_t local);
+    // The remote keys for frame, which must be confirmed() as the remote sends them in order. Frames ahead of the
+    // local side wait to be run.
+    bool confirm(std::uint64_t frame, std::uint16_t remote);
+private:
+    static constexpr std::size_t slots_ {maxFrames + 1};
+
+    // the confirmed remote keys for frame, or the last ones confirmed
+    [[nodiscard]] std::uint16_t remoteKeys_(std::uint64_t frame) const;
+    void run_(std::uint64_t frame);
+    void rollback_();
+
+    std::unique_ptr<Machine> machine_;
+    int cyclesPerFrame_;
+    std::vector<std::uint16_t> local_; // by frame
+    std::vector<std::uint16_t> remote_; // by frame, as confirmed
+    // by frame modulo slots_: the state before the frame and the remote keys it was run with
+    std::array<std::unique_ptr<Machine>, slots_> states_ {};
+    std::array<std::uint16_t, slots_> guessed_ {};
+    std::uint64_t wrongFrom_ {~0ull}; // first frame run with a wrong guess
+    Stats stats_ {};
+};
+
+
+#endif //CHIP_8_ROLLBACK_H
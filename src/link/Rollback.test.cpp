@@ -0,0 +1,59 @@
+#include <gtest/gtest.h>
+#include "Rollback.h"
+
+class RollbackTest : public testing::Test {
+protected:
+    RollbackTest() {
+        start.interpreter.setLogging(false);
+        start.memory.load(rom);
+    }
+
+    // keys the remote player holds in frame f, key 5 for a while
+    static std::uint16_t remote(std::uint64_t f) { return f >= 5 and f < 11 ? 1 << 5 : 0; }
+
+    // 200: v1 := 5, 202: if v1 key then v0 += 1 (skipped while key 5 isn't held), 206: jump 202
+    std::vector<std::uint8_t> rom {0x61, 0x05, 0xE1, 0xA1, 0x70, 0x01, 0x12, 0x02};
+    Machine start;
+};
+
+TEST_F(RollbackTest, lateKeysEndWhereKnownKeysDo)
+{
+    static constexpr std::uint64_t frames {30};
+    static constexpr std::uint64_t lag {3};
+    Rollback known {start, 20};
+    Rollback late {start, 20};
+    for (std::uint64_t f {0}; f != frames; ++f) {
+        known.confirm(f, remote(f));
+        known.advance(0);
+        if (f >= lag)
+            late.confirm(f - lag, remote(f - lag));
+        late.advance(0);
+    }
+    for (std::uint64_t f {frames - lag}; f != frames; ++f)
+        late.confirm(f, remote(f));
+    known.confirm(frames, 0);
+    late.confirm(frames, 0);
+    known.advance(0);
+    late.advance(0);
+
+    EXPECT_NE(known.machine().interpreter.v[0], 0);
+    EXPECT_EQ(late.machine().interpreter.v, known.machine().interpreter.v);
+    EXPECT_EQ(late.machine().interpreter.stateHash(), known.machine().interpreter.stateHash());
+    EXPECT_EQ(known.stats().rollbacks, 0);
+    // one guess is wrong when the key goes down and one when it comes up
+    EXPECT_EQ(late.stats().rollbacks, 2);
+    EXPECT_EQ(late.stats().resimulated, 2 * lag);
+}
+
+TEST_F(RollbackTest, waitsForTheRemoteToCatchUp)
+{
+    Rollback rollback {start, 20};
+    for (int f {0}; f != Rollback::maxFrames; ++f) {
+        ASSERT_TRUE(rollback.canAdvance());
+        rollback.advance(0);
+    }
+    EXPECT_FALSE(rollback.canAdvance());
+    EXPECT_FALSE(rollback.confirm(1, 0));
+    EXPECT_TRUE(rollback.confirm(0, 0));
+    EXPECT_TRUE(rollback.canAdvance());
+}
@@ -0,0 +1,252 @@
+#include "Log.h"
+#include <algorithm>
+#include <iostream>
+
+namespace {
+    std::atomic<std::uint64_t> nextId {1};
+
+    // a thread's queue of one log, given up when the thread exits or writes to another log
+    struct Handle {
+        std::uint64_t log {0};
+        std::shared_ptr<void> queue;
+        std::atomic<bool>* released {nullptr};
+
+        ~Handle()
+        {
+            if (released)
+                released->store(true, std::memory_order_release);
+        }
+    };
+    thread_local Handle handle;
+
+    void appendString(std::string& out, std::string_view s)
+    {
+        out += '"';
+        for (char c : s) {
+            switch (c) {
+                case '"': out += "\\\""; break;
+                case '\\': out += "\\\\"; break;
+                case '\n': out += "\\n"; break;
+                case '\t': out += "\\t"; break;
+                default:
+                    if (static_cast<unsigned char>(c) < 0x20)
+                        out += std::format("\\u{:0>4x}", static_cast<int>(c));
+                    else
+                        out += c;
+            }
+        }
+        out += '"';
+    }
+}
+
+Log::Log(std::ostream& out, int perSecond, std::chrono::milliseconds interval)
+    : out_{&out}, perSecond_{std::max(perSecond, 1)}, interval_{interval}, id_{nextId++}
+{
+    if (interval_.count() > 0)
+        flusher_ = std::jthread {[this](std::stop_token stop) { run_(stop); }};
+}
+
+Log::~Log()
+{
+    if (flusher_.joinable()) {
+        flusher_.request_stop();
+        flusher_.join();
+    }
+    flush();
+}
+
+Log& Log::global()
+{
+    static Log log {std::cerr};
+    return log;
+}
+
+bool Log::open(const std::filesystem::path& file)
+{
+    std::scoped_lock lock {flushMutex_};
+    file_.open(file);
+    if (!file_.is_open())
+        return false;
+    out_ = &file_;
+    return true;
+}
+
+Log::Queue& Log::queue_()
+{
+    if (handle.log == id_) [[likely]]
+        return *static_cast<Queue*>(handle.queue.get());
+
+    if (handle.released)
+        handle.released->store(true, std::memory_order_release);
+    auto queue {std::make_shared<Queue>()};
+    {
+        std::scoped_lock lock {queuesMutex_};
+        queues_.push_back(queue);
+    }
+    handle.log = id_;
+    handle.released = &queue->released;
+    handle.queue = std::move(queue);
+    return *static_cast<Queue*>(handle.queue.get());
+}
+
+Log::Record* Log::claim_(Level level, const char* source, const char* event, const Site* site)
+{
+    Queue& queue {queue_()};
+    Seen* fresh {nullptr}; // the free slot for a site seen for the first time, marked once its record is admitted
+    if (site) {
+        // the high bits of a multiplicative hash
+        std::uint64_t key {((reinterpret_cast<std::uintptr_t>(event) << 32 | site->pc << 16 | site->opcode) * 0x9E3779B97F4A7C15ull) >> 32};
+        for (std::size_t probe {0}; probe != 8; ++probe) {
+            Seen& seen {queue.seen[(key + probe) % sitesSize]};
+            std::uint32_t count {seen.count.load(std::memory_order_relaxed)};
+            if (count == 0) {
+                fresh = &seen;
+                break;
+            }
+            if (seen.event == event and seen.site.pc == site->pc and seen.site.opcode == site->opcode) {
+                seen.count.store(count + 1, std::memory_order_relaxed);
+                queue.repeated.fetch_add(1, std::memory_order_relaxed);
+                return nullptr;
+            }
+        } // sites the table has no room for are written every time, up to the limit
+    }
+
+    clock::time_point now {clock::now()};
+    if (now - queue.second >= std::chrono::seconds {1}) {
+        queue.second = now;
+        queue.inSecond = 0;
+    }
+    if (queue.inSecond == perSecond_) {
+        queue.limited.fetch_add(1, std::memory_order_relaxed);
+        return nullptr;
+    }
+    std::uint64_t head {queue.head.load(std::memory_order_relaxed)};
+    if (head - queue.tail.load(std::memory_order_acquire) == queueSize) {
+        queue.dropped.fetch_add(1, std::memory_order_relaxed);
+        return nullptr;
+    }
+    ++queue.inSecond;
+    if (fresh) {
+        fresh->level = level;
+        fresh->source = source;
+        fresh->event = event;
+        fresh->site = *site;
+        fresh->count.store(1, std::memory_order_release);
+    }
+
+    Record& record {queue.records[head % queueSize]};
+    record.time = std::chrono::duration<double>(now - start_).count();
+    record.level = level;
+    record.source = source;
+    record.event = event;
+    record.hasSite = site != nullptr;
+    if (site)
+        record.site = *site;
+    return &record;
+}
+
+void Log::publish_(char* end)
+{
+    *end = '\0';
+    Queue& queue {queue_()};
+    queue.head.store(queue.head.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    if (queue.head.load(std::memory_order_relaxed) - queue.tail.load(std::memory_order_relaxed) == queueSize / 2) {
+        // before the queue fills up
+        hurry_.store(true, std::memory_order_relaxed);
+        wake_.notify_one();
+    }
+}
+
+void Log::flush()
+{
+    std::scoped_lock lock {flushMutex_};
+    flush_();
+}
+
+void Log::flush_()
+{
+    std::vector<std::shared_ptr<Queue>> queues;
+    {
+        std::scoped_lock lock {queuesMutex_};
+        queues = queues_;
+    }
+
+    line_.clear();
+    for (const std::shared_ptr<Queue>& queue : queues) {
+        // whether the thread let go has to be read before the last records, or they could be missed
+        bool released {queue->released.load(std::memory_order_acquire)};
+        std::uint64_t head {queue->head.load(std::memory_order_acquire)};
+        for (std::uint64_t tail {queue->tail.load(std::memory_order_relaxed)}; tail != head; ++tail) {
+            const Record& r {queue->records[tail % queueSize]};
+            writeLine_(r.time, r.level, r.source, r.event, r.hasSite ? &r.site : nullptr, r.message.data(), 0);
+        }
+        queue->tail.store(head, std::memory_order_release);
+
+        double now {std::chrono::duration<double>(clock::now() - start_).count()};
+        for (Seen& seen : queue->seen) {
+            std::uint32_t count {seen.count.load(std::memory_order_acquire)};
+            if (count > seen.flushed) {
+                writeLine_(now, seen.level, seen.source, seen.event, &seen.site, nullptr, count - seen.flushed);
+                seen.flushed = count;
+            }
+        }
+
+        if (released) {
+            std::scoped_lock lock {queuesMutex_};
+            retired_.repeated += queue->repeated;
+            retired_.limited += queue->limited;
+            retired_.dropped += queue->dropped;
+            std::erase(queues_, queue);
+        }
+    }
+    if (!line_.empty()) {
+        *out_ << line_;
+        out_->flush();
+    }
+}
+
+void Log::writeLine_(double time, Level level, const char* source, const char* event, const Site* site,
+                     const char* message, std::uint32_t repeats)
+{
+    line_ += std::format(R"({{"time":{:.6f},"level":"{:s}","source":)", time, levelNames[static_cast<int>(level)]);
+    appendString(line_, source);
+    line_ += ",\"event\":";
+    appendString(line_, event);
+    if (site) {
+        line_ += std::format(R"(,"pc":{:d},"opcode":{:d})", site->pc, site->opcode);
+        if (site->addr >= 0)
+            line_ += std::format(R"(,"addr":{:d})", site->addr);
+    }
+    if (message) {
+        line_ += ",\"message\":";
+        appendString(line_, message);
+    }
+    if (repeats != 0)
+        line_ += std::format(R"(,"repeats":{:d})", repeats);
+    line_ += "}\n";
+    written_.fetch_add(1, std::memory_order_relaxed);
+}
+
+void Log::run_(std::stop_token stop)
+{
+    while (!stop.stop_requested()) {
+        {
+            std::unique_lock lock {wakeMutex_};
+            wake_.wait_for(lock, stop, interval_, [this] { return hurry_.exchange(false, std::memory_order_relaxed); });
+        }
+        flush();
+    }
+}
+
+Log::Stats Log::stats() const
+{
+    std::scoped_lock lock {queuesMutex_};
+    Stats stats {retired_};
+    stats.written = written_.load(std::memory_order_relaxed);
+    for (const std::shared_ptr<Queue>& queue : queues_) {
+        stats.repeated += queue->repeated;
+        stats.limited += queue->limited;
+        stats.dropped += queue->dropped;
+    }
+    return stats;
+}
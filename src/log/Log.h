@@ -0,0 +1,150 @@
+#ifndef CHIP_8_LOG_H
+#define CHIP_8_LOG_H
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Diagnostics as JSON lines, one object per record, written on a background thread so that reporting a problem
+// from the interpreter's hot path costs a few stores. Every thread that writes gets a bounded single producer,
+// single consumer queue of its own, a full queue drops the record. Each thread also gets at most perSecond
+// records a second. Records about an instruction are deduplicated: only the first of each event at the same pc
+// and opcode is written, later ones are counted and written as a "repeats" record on the next flush.
+//
+//   {"time":0.016712,"level":"error","source":"interpreter","event":"undefined_opcode","pc":516,"opcode":32776,
+//    "message":"undefined opcode 8008"}
+class Log {
+public:
+    using clock = std::chrono::steady_clock;
+
+    enum class Level : std::uint8_t { info, warning, error };
+    static constexpr const char* levelNames[] {"info", "warning", "error"};
+
+    static constexpr std::size_t queueSize {256}; // records a thread can have waiting to be written
+    static constexpr std::size_t messageSize {128}; // bytes, longer messages are cut
+    static constexpr std::size_t sitesSize {1024}; // distinct instructions a thread remembers for deduplication
+
+    // the instruction a record is about
+    struct Site {
+        std::uint16_t pc;
+        std::uint16_t opcode;
+        std::int64_t addr {-1}; // memory it accessed, -1 for none
+    };
+
+    struct Stats {
+        unsigned long long written {0}; // lines, repeats included
+        unsigned long long repeated {0}; // left out as repeats of a site already written
+        unsigned long long limited {0}; // over perSecond
+        unsigned long long dropped {0}; // the queue was full
+    };
+
+    // Writes to out, which must outlive the log, every interval. An interval of 0 leaves it to flush().
+    explicit Log(std::ostream& out, int perSecond = 100, std::chrono::milliseconds interval = std::chrono::milliseconds {100});
+    // Writes whatever is still queued.
+    ~Log();
+    Log(const Log&) = delete;
+    Log& operator=(const Log&) = delete;
+
+    // The log the emulator's parts report to, on stderr until open() is called.
+    static Log& global();
+    // Writes to file from now on instead.
+    bool open(const std::filesystem::path& file);
+
+    // source and event must be string literals, only their addresses are queued
+    template<typename... Args>
+    void write(Level level, const char* source, const char* event, std::format_string<Args...> format, Args&&... args)
+    {
+        if (Record* record {claim_(level, source, event, nullptr)})
+            publish_(std::format_to_n(record->message.data(), messageSize - 1, format, std::forward<Args>(args)...).out);
+    }
+    // Only the first admitted record of a site is formatted, on the calling thread; later ones are counted as repeats.
+    template<typename... Args>
+    void write(Level level, const char* source, const char* event, Site site, std::format_string<Args...> format, Args&&... args)
+    {
+        if (Record* record {claim_(level, source, event, &site)})
+            publish_(std::format_to_n(record->message.data(), messageSize - 1, format, std::forward<Args>(args)...).out);
+    }
+    // Writes everything queued so far, along with the repeats counted since the last flush.
+    void flush();
+
+    [[nodiscard]] Stats stats() const;
+private:
+    struct Record {
+        double time; // seconds since the log was made
+        Level level;
+        const char* source;
+        const char* event;
+        bool hasSite;
+        Site site;
+        std::array<char, messageSize> message;
+    };
+
+    // a site seen by one thread, written once and then only counted
+    struct Seen {
+        Level level;
+        const char* source;
+        const char* event;
+        Site site;
+        std::atomic<std::uint32_t> count {0}; // set last, the rest is valid once it isn't 0
+        std::uint32_t flushed {1}; // flushing thread only
+    };
+
+    struct Queue {
+        std::array<Record, queueSize> records {};
+        std::atomic<std::uint64_t> head {0}; // records queued, by the writing thread
+        std::atomic<std::uint64_t> tail {0}; // records written, by the flushing thread
+        std::atomic<bool> released {false}; // the thread is done with it
+        std::array<Seen, sitesSize> seen {};
+
+        // writing thread only
+        clock::time_point second {}; // start of the current second of rate limiting
+        int inSecond {0};
+
+        std::atomic<unsigned long long> repeated {0};
+        std::atomic<unsigned long long> limited {0};
+        std::atomic<unsigned long long> dropped {0};
+    };
+
+    // the calling thread's queue, made on its first record
+    Queue& queue_();
+    // a free slot in the calling thread's queue, or nullptr if the record is a repeat, over the limit or dropped
+    Record* claim_(Level level, const char* source, const char* event, const Site* site);
+    void publish_(char* end); // end of the message
+    void flush_(); // holds flushMutex_
+    void writeLine_(double time, Level level, const char* source, const char* event, const Site* site,
+                    const char* message, std::uint32_t repeats);
+    void run_(std::stop_token stop);
+
+    std::ostream* out_;
+    std::ofstream file_;
+    int perSecond_;
+    std::chrono::milliseconds interval_;
+    clock::time_point start_ {clock::now()};
+    std::uint64_t id_; // tells logs apart in the threads' queue handles
+    std::string line_; // flushing thread only
+
+    mutable std::mutex queuesMutex_;
+    std::vector<std::shared_ptr<Queue>> queues_;
+    Stats retired_ {}; // of queues no longer in queues_, under queuesMutex_
+    std::atomic<unsigned long long> written_ {0};
+    std::mutex flushMutex_;
+    std::mutex wakeMutex_;
+    std::condition_variable_any wake_;
+    std::atomic<bool> hurry_ {false}; // a queue is half full
+
+    std::jthread flusher_; // last, so it stops before anything it uses is destroyed
+};
+
+
+#endif //CHIP_8_LOG_H
@@ -0,0 +1,99 @@
+#include <gtest/gtest.h>
+#include <sstream>
+#include <thread>
+#include "Log.h"
+
+using namespace std::chrono_literals;
+
+class LogTest : public testing::Test {
+protected:
+    // lines written so far
+    std::vector<std::string> lines() {
+        log.flush();
+        std::vector<std::string> out;
+        std::istringstream in {text.str()};
+        for (std::string line; std::getline(in, line);)
+            out.push_back(line);
+        return out;
+    }
+
+    std::ostringstream text;
+    Log log {text, 1000, 0ms}; // only flushed by the tests
+};
+
+TEST_F(LogTest, writesJsonLines)
+{
+    log.write(Log::Level::warning, "loader", "load_failed", "failed to load \"{:s}\"", "a\\b.ch8");
+    log.write(Log::Level::error, "interpreter", "out_of_bounds", {0x204, 0xF165, 0x1000}, "access at {:0>3X}", 0x1000);
+
+    std::vector<std::string> written {lines()};
+    ASSERT_EQ(written.size(), 2);
+    EXPECT_NE(written[0].find(R"("level":"warning","source":"loader","event":"load_failed","message":"failed to load \"a\\b.ch8\""})"),
+              std::string::npos);
+    EXPECT_NE(written[1].find(R"("pc":516,"opcode":61797,"addr":4096,"message":"access at 1000"})"), std::string::npos);
+    EXPECT_EQ(written[1].find(R"({"time":)"), 0);
+}
+
+TEST_F(LogTest, repeatsOfASiteAreCounted)
+{
+    for (int n {0}; n != 1000; ++n)
+        log.write(Log::Level::error, "interpreter", "undefined_opcode", {0x204, 0x8008}, "undefined opcode {:0>4X}", 0x8008);
+    log.write(Log::Level::error, "interpreter", "undefined_opcode", {0x206, 0x8008}, "undefined opcode {:0>4X}", 0x8008);
+
+    std::vector<std::string> written {lines()};
+    ASSERT_EQ(written.size(), 3);
+    EXPECT_NE(written[0].find(R"("pc":516)"), std::string::npos);
+    EXPECT_NE(written[1].find(R"("pc":518)"), std::string::npos);
+    EXPECT_NE(written[2].find(R"("pc":516,"opcode":32776,"repeats":999})"), std::string::npos);
+    EXPECT_EQ(log.stats().repeated, 999);
+
+    // only repeats since the last flush
+    log.write(Log::Level::error, "interpreter", "undefined_opcode", {0x204, 0x8008}, "undefined opcode {:0>4X}", 0x8008);
+    written = lines();
+    ASSERT_EQ(written.size(), 4);
+    EXPECT_NE(written[3].find(R"("repeats":1})"), std::string::npos);
+}
+
+TEST_F(LogTest, sitesOverTheLimitAreNotRepeats)
+{
+    Log limited {text, 1, 0ms};
+    limited.write(Log::Level::info, "test", "count", "first");
+    for (int n {0}; n != 2; ++n)
+        limited.write(Log::Level::error, "interpreter", "undefined_opcode", {0x204, 0x8008}, "undefined opcode {:0>4X}", 0x8008);
+    limited.flush();
+    EXPECT_EQ(limited.stats().written, 1);
+    EXPECT_EQ(limited.stats().limited, 2);
+    EXPECT_EQ(limited.stats().repeated, 0);
+}
+
+TEST_F(LogTest, threadsAreLimitedAndBounded)
+{
+    Log limited {text, 10, 0ms};
+    for (int n {0}; n != 100; ++n)
+        limited.write(Log::Level::info, "test", "count", "{:d}", n);
+    limited.flush();
+    EXPECT_EQ(limited.stats().written, 10);
+    EXPECT_EQ(limited.stats().limited, 90);
+
+    for (std::size_t n {0}; n != Log::queueSize + 44; ++n)
+        log.write(Log::Level::info, "test", "count", "{:d}", n);
+    EXPECT_EQ(log.stats().dropped, 44);
+}
+
+TEST_F(LogTest, everyThreadGetsAQueue)
+{
+    {
+        std::vector<std::jthread> threads;
+        for (int t {0}; t != 4; ++t) {
+            threads.emplace_back([this, t] {
+                for (int n {0}; n != 50; ++n)
+                    log.write(Log::Level::info, "test", "count", "{:d} {:d}", t, n);
+            });
+        }
+    }
+    log.write(Log::Level::info, "test", "count", "done");
+
+    std::vector<std::string> written {lines()};
+    EXPECT_EQ(written.size(), 201);
+    EXPECT_EQ(log.stats().dropped, 0);
+}
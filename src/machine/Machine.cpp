@@ -0,0 +1,23 @@
+#include "Machine.h"
+
+Machine::Machine(const Machine& other)
+    : memory{other.memory}, display{other.display}, keyboard{other.keyboard},
+      interpreter{other.interpreter, memory, display, keyboard}
+{
+}
+
+void Machine::step()
+{
+    interpreter.cycle();
+}
+
+void Machine::frame(int cycles)
+{
+    for (int left {interpreter.frameBudget(cycles)}; left > 0;) {
+        Interpreter::Run run {interpreter.run(left)};
+        left -= run.cost;
+        if (run.stop == Interpreter::Stop::keyWait or run.stop == Interpreter::Stop::vblank)
+            break; // the rest of the frame would only poll the keyboard again, or waits for the display
+    }
+    interpreter.endOfFrame();
+}
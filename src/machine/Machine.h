@@ -0,0 +1,34 @@
+#ifndef CHIP_8_MACHINE_H
+#define CHIP_8_MACHINE_H
+
+#include <memory>
+#include <span>
+#include "../interpreter/Interpreter.h"
+#include "../memory/Memory.h"
+#include "../display/Display.h"
+#include "../keyboard/Keyboard.h"
+
+// All the hardware of one emulated machine. Headless unless display.on() is called.
+class Machine {
+public:
+    Machine() = default;
+    // A headless copy of other. Ram pages and framebuffer blocks are shared until either machine writes to them,
+    // so forking costs a few hundred bytes however much state there is.
+    Machine(const Machine& other);
+    Machine& operator=(const Machine&) = delete;
+
+    [[nodiscard]] std::unique_ptr<Machine> fork() const { return std::make_unique<Machine>(*this); }
+
+    // Runs one instruction.
+    void step();
+    // Runs cycles instructions, or a frame of VIP cycles under Interpreter::Timing::vip, and the end of frame work.
+    void frame(int cycles);
+
+    Memory memory {};
+    Display display {};
+    Keyboard keyboard {};
+    Interpreter interpreter {memory, display, keyboard};
+};
+
+
+#endif //CHIP_8_MACHINE_H
@@ -0,0 +1,69 @@
+#include <gtest/gtest.h>
+#include <experimental/random>
+#include "Machine.h"
+
+class MachineTest : public testing::Test {
+protected:
+    MachineTest() {
+        machine.interpreter.setLogging(false);
+        machine.memory.load(rom);
+        machine.frame(20);
+    }
+
+    // 200: v0 := random 0xFF, 202: i := 0x300, 204: bcd v0, 206: sprite v0 v1 5, 208: v1 += 1, 20A: jump 200
+    std::vector<std::uint8_t> rom {0xC0, 0xFF, 0xA3, 0x00, 0xF0, 0x33, 0xD0, 0x15, 0x71, 0x01, 0x12, 0x00};
+    Machine machine;
+};
+
+TEST_F(MachineTest, forkSharesEverything)
+{
+    std::unique_ptr<Machine> child {machine.fork()};
+
+    EXPECT_EQ(child->memory.privatePages(), 0);
+    EXPECT_EQ(child->display.privateBlocks(), 0);
+    EXPECT_EQ(child->interpreter.pc, machine.interpreter.pc);
+    EXPECT_EQ(child->interpreter.stateHash(), machine.interpreter.stateHash());
+}
+
+TEST_F(MachineTest, writesAreCopiedOnWrite)
+{
+    std::unique_ptr<Machine> child {machine.fork()};
+    std::uint8_t before {machine.memory.read(0x300)};
+
+    child->memory.write(before + 1, 0x300);
+    child->display.flipPixel(0, 0);
+
+    EXPECT_EQ(child->memory.privatePages(), 1);
+    EXPECT_EQ(child->display.privateBlocks(), 1);
+    EXPECT_EQ(machine.memory.read(0x300), before);
+    EXPECT_NE(child->display.pixel(0, 0), machine.display.pixel(0, 0));
+    EXPECT_EQ(machine.interpreter.stateHash(), machine.interpreter.fullStateHash());
+    EXPECT_EQ(child->interpreter.stateHash(), child->interpreter.fullStateHash());
+}
+
+TEST_F(MachineTest, forkRunsLikeItsParent)
+{
+    std::unique_ptr<Machine> child {machine.fork()};
+
+    std::experimental::reseed(1);
+    for (int f {0}; f != 10; ++f)
+        machine.frame(20);
+    std::experimental::reseed(1);
+    for (int f {0}; f != 10; ++f)
+        child->frame(20);
+
+    EXPECT_EQ(child->interpreter.stateHash(), machine.interpreter.stateHash());
+    EXPECT_EQ(child->interpreter.v, machine.interpreter.v);
+}
+
+TEST_F(MachineTest, identicalRomsSharePages)
+{
+    Machine other;
+    other.memory.load(rom);
+    Machine fresh;
+    fresh.memory.load(rom);
+
+    // the rom and font pages are shared with each other and with the machine in the fixture
+    EXPECT_EQ(other.memory.privatePages(), 0);
+    EXPECT_EQ(fresh.memory.privatePages(), 0);
+}
@@ -0,0 +1,82 @@
+#include "QuirkDetector.h"
+#include <algorithm>
+#include <atomic>
+#include <experimental/random>
+#include <format>
+#include <thread>
+#include "Machine.h"
+
+QuirkDetector::Candidate QuirkDetector::run_(std::span<const std::uint8_t> rom, std::string quirks) const
+{
+    Candidate candidate {.quirks = std::move(quirks)};
+    // every candidate sees the same random numbers so that quirks that don't matter tie
+    std::experimental::reseed(0x5C8);
+    Machine machine;
+    machine.interpreter.setLogging(false);
+    machine.interpreter.setChecked(true);
+    machine.keyboard.setHostKeys(false); // candidates run in parallel with no keys pressed
+    if (!mode.empty())
+        machine.interpreter.setMode(mode);
+    machine.interpreter.setQuirks(candidate.quirks);
+    if (!machine.memory.load(rom)) {
+        candidate.score = -1'000'000'000;
+        return candidate;
+    }
+
+    std::uint64_t previous {machine.display.stateHash()};
+    for (int f {0}; f != frames; ++f) {
+        machine.frame(cyclesPerFrame);
+        std::uint64_t current {machine.display.stateHash()};
+        if (current != previous)
+            ++candidate.activeFrames;
+        previous = current;
+    }
+
+    candidate.undefined = machine.interpreter.faults.undefined;
+    candidate.stack = machine.interpreter.faults.stack;
+    candidate.outOfBounds = machine.interpreter.faults.outOfBounds;
+    candidate.blank = machine.display.stateHash() == 0; // only an empty framebuffer hashes to 0
+
+    // any fault outweighs everything the screen can show, more faults rank lower still
+    auto penalty {[](unsigned long long n) { return n == 0 ? 0 : 100'000 + static_cast<long long>(std::min(n, 100'000ull)); }};
+    candidate.score = candidate.activeFrames + (candidate.blank ? 0 : frames)
+            - penalty(candidate.undefined) - penalty(candidate.stack) - penalty(candidate.outOfBounds);
+    return candidate;
+}
+
+std::vector<QuirkDetector::Candidate> QuirkDetector::rank(std::span<const std::uint8_t> rom, const std::string& preferred) const
+{
+    std::vector<std::string> profiles;
+    for (int mask {0}; mask != 1 << quirkCount; ++mask) {
+        std::string quirks;
+        for (int q {0}; q != quirkCount; ++q)
+            quirks += std::format("{:s}{:s}={}", q == 0 ? "" : ",", names[q], (mask >> q & 1) == 1);
+        profiles.push_back(std::move(quirks));
+    }
+    // the stable sort below keeps whatever comes first on ties
+    auto it {std::ranges::find(profiles, preferred)};
+    if (it != profiles.end())
+        std::rotate(profiles.begin(), it, it + 1);
+
+    std::vector<Candidate> candidates(profiles.size());
+    std::atomic<std::size_t> next {0};
+    auto work {[&] {
+        for (std::size_t i {next++}; i < profiles.size(); i = next++)
+            candidates[i] = run_(rom, profiles[i]);
+    }};
+    {
+        unsigned n {threads == 0 ? std::max(1u, std::thread::hardware_concurrency()) : threads};
+        std::vector<std::jthread> pool;
+        for (unsigned t {1}; t < std::min<std::size_t>(n, profiles.size()); ++t)
+            pool.emplace_back(work);
+        work();
+    }
+
+    std::ranges::stable_sort(candidates, std::ranges::greater {}, &Candidate::score);
+    return candidates;
+}
+
+std::string QuirkDetector::detect(std::span<const std::uint8_t> rom, const std::string& preferred) const
+{
+    return rank(rom, preferred).front().quirks;
+}
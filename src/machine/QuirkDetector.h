@@ -0,0 +1,39 @@
+#ifndef CHIP_8_QUIRKDETECTOR_H
+#define CHIP_8_QUIRKDETECTOR_H
+
+#include <cstdint>
+#include <span>
+#include <string>
+#include <vector>
+
+// Guesses the quirk profile a rom was written for by running it headless under every combination of the
+// interpreter's quirks with no keys pressed, and scoring how well behaved each run was.
+class QuirkDetector {
+public:
+    struct Candidate {
+        std::string quirks; // see Interpreter::setQuirks()
+        unsigned long long undefined {0};
+        unsigned long long stack {0};
+        unsigned long long outOfBounds {0};
+        int activeFrames {0}; // frames in which the framebuffer changed
+        bool blank {true}; // nothing on screen at the end
+        long long score {0};
+    };
+
+    int frames {300};
+    int cyclesPerFrame {20};
+    unsigned threads {0}; // 0 uses every core
+    std::string mode; // runs every candidate in this mode unless empty, see Interpreter::setMode()
+
+    // Returns every candidate, best first. preferred wins ties, pass the suggested profile for the rom's platform.
+    [[nodiscard]] std::vector<Candidate> rank(std::span<const std::uint8_t> rom, const std::string& preferred) const;
+    [[nodiscard]] std::string detect(std::span<const std::uint8_t> rom, const std::string& preferred) const;
+private:
+    static constexpr int quirkCount {5};
+    static constexpr const char* names[quirkCount] {"vf_reset", "memory", "shifting", "jumping", "ioverflow"};
+
+    Candidate run_(std::span<const std::uint8_t> rom, std::string quirks) const;
+};
+
+
+#endif //CHIP_8_QUIRKDETECTOR_H
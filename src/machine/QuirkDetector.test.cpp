@@ -0,0 +1,39 @@
+#include <gtest/gtest.h>
+#include "QuirkDetector.h"
+#include "../index/RomIndex.h"
+
+TEST(QuirkDetectorTest, shiftingQuirkIsDetected)
+{
+    // 200: v1 := 0x80, 202: v0 := 2, 204: v0 <<= v1, 206: if v0 != 4 then, 208: 0x8008 (undefined), 20A: clear, 20C: jump 20C
+    // without the shifting quirk v0 = v1 << 1 = 0 and the undefined opcode runs
+    std::vector<std::uint8_t> rom {0x61, 0x80, 0x60, 0x02, 0x80, 0x1E, 0x30, 0x04, 0x80, 0x08, 0x00, 0xE0, 0x12, 0x0C};
+    QuirkDetector detector;
+    detector.frames = 10;
+
+    std::vector<QuirkDetector::Candidate> ranked {detector.rank(rom, RomIndex::suggestedQuirks("chip8"))};
+    ASSERT_EQ(ranked.size(), 32);
+    EXPECT_NE(ranked.front().quirks.find("shifting=true"), std::string::npos);
+    EXPECT_EQ(ranked.front().undefined, 0);
+    EXPECT_GT(ranked.back().undefined, 0);
+}
+
+TEST(QuirkDetectorTest, preferredProfileWinsTies)
+{
+    // 200: jump 200
+    std::vector<std::uint8_t> rom {0x12, 0x00};
+    QuirkDetector detector;
+    detector.frames = 5;
+
+    EXPECT_EQ(detector.detect(rom, RomIndex::suggestedQuirks("superchip")), RomIndex::suggestedQuirks("superchip"));
+    EXPECT_EQ(detector.detect(rom, RomIndex::suggestedQuirks("chip8")), RomIndex::suggestedQuirks("chip8"));
+}
+
+TEST(QuirkDetectorTest, stackFaultsAreCounted)
+{
+    // 200: return on an empty stack, 202: jump 202
+    std::vector<std::uint8_t> rom {0x00, 0xEE, 0x12, 0x02};
+    QuirkDetector detector;
+    detector.frames = 1;
+
+    EXPECT_EQ(detector.rank(rom, "").front().stack, 1);
+}
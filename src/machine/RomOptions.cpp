@@ -0,0 +1,31 @@
+#include "RomOptions.h"
+#include <format>
+#include <iostream>
+
+void configure(Interpreter& interpreter, const RomOptions& shared, const RomOptions& options, bool fixedCycles)
+{
+    // the mode resets the quirks, so it goes first
+    const std::string& mode {options.mode.empty() ? shared.mode : options.mode};
+    if (!mode.empty()) {
+        if (interpreter.setMode(mode))
+            std::cout << std::format("Running emulator in '{:s}' mode!\n", mode);
+        else
+            std::cerr << "error: failed to read interpreter '-mode' option, using default=chip8.\n";
+    }
+
+    for (const auto* quirks : {&shared.quirks, &options.quirks}) {
+        for (const std::string& quirk : *quirks) {
+            if (!interpreter.setQuirk(quirk))
+                std::cerr << std::format("error: failed to read interpreter '-quirk {:s}' option.\n", quirk);
+        }
+    }
+
+    const std::string& timing {options.timing.empty() ? shared.timing : options.timing};
+    if (timing == "vip" or (timing.empty() and !fixedCycles and interpreter.mode() == "default")) {
+        interpreter.setTiming(Interpreter::Timing::vip);
+    } else {
+        interpreter.setTiming(Interpreter::Timing::instructions);
+        if (!timing.empty() and timing != "instructions")
+            std::cerr << std::format("error: failed to read '-timing {:s}' option, counting instructions.\n", timing);
+    }
+}
@@ -0,0 +1,22 @@
+#ifndef CHIP_8_ROMOPTIONS_H
+#define CHIP_8_ROMOPTIONS_H
+
+#include <string>
+#include <vector>
+#include "../interpreter/Interpreter.h"
+
+// A rom, either a path or the hash of a rom in the index, and the -quirk, --mode and -timing options given after it.
+struct RomOptions {
+    std::string rom;
+    std::string mode;
+    std::string timing;
+    std::vector<std::string> quirks;
+};
+
+// Applies --mode, then -quirk and -timing, over whatever the rom was loaded with. The options given for a rom
+// override those for every rom. CHIP-8 roms run with VIP timing unless -timing or fixedCycles say otherwise,
+// later platforms count instructions.
+void configure(Interpreter& interpreter, const RomOptions& shared, const RomOptions& options, bool fixedCycles);
+
+
+#endif //CHIP_8_ROMOPTIONS_H
@@ -0,0 +1,23 @@
+#include <gtest/gtest.h>
+#include "RomOptions.h"
+#include "Machine.h"
+
+TEST(RomOptionsTest, quirksApplyOverTheMode)
+{
+    Machine machine;
+    configure(machine.interpreter, {.quirks = {"memory=true"}}, {.mode = "superchip", .quirks = {"shifting=false"}}, false);
+
+    EXPECT_EQ(machine.interpreter.mode(), "superchip");
+    EXPECT_NE(machine.interpreter.quirks().find("memory=true,shifting=false,jumping=true"), std::string::npos);
+    EXPECT_EQ(machine.interpreter.timing(), Interpreter::Timing::instructions);
+}
+
+TEST(RomOptionsTest, chip8RunsWithVipTimingUnlessCyclesAreFixed)
+{
+    Machine machine;
+    configure(machine.interpreter, {}, {}, false);
+    EXPECT_EQ(machine.interpreter.timing(), Interpreter::Timing::vip);
+
+    configure(machine.interpreter, {}, {}, true);
+    EXPECT_EQ(machine.interpreter.timing(), Interpreter::Timing::instructions);
+}
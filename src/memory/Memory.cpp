@@ -1,20 +1,172 @@
 #include "Memory.h"
-#include <fstream>
+#include <algorithm>
+#include <mutex>
+#include <unordered_map>
+#include "../io/MappedFile.h"
 
-bool Memory::load(std::string path) {
-    // writing the font into memory
-    std::uint8_t addr {fontAddr};
-    for (std::uint8_t byte : font)
-        ram[addr++] = byte;
+Memory::Memory() {
+    // the fonts never change, so their pages are built once and shared by every instance
+    static const std::array<std::shared_ptr<Page>, 2> fontPages {[] {
+        std::array<std::uint8_t, 2 * pageSize> bytes {};
+        std::copy(std::begin(font), std::end(font), &bytes[fontAddr]);
+        std::copy(std::begin(schipfont), std::end(schipfont), &bytes[bigFontAddr]);
+
+        Page low {}, high {};
+        std::copy_n(bytes.begin(), pageSize, low.begin());
+        std::copy_n(bytes.begin() + pageSize, pageSize, high.begin());
+        return std::array {intern_(low), intern_(high)};
+    }()};
+    std::ranges::fill(pages_, zeros_());
+    std::ranges::copy(fontPages, pages_.begin());
+    stateHash_ = fullStateHash();
+}
+
+const std::shared_ptr<Memory::Page>& Memory::zeros_() {
+    static const std::shared_ptr<Page> zeros {intern_(Page {})};
+    return zeros;
+}
+
+std::shared_ptr<Memory::Page> Memory::intern_(const Page& page) {
+    // the table keeps its own reference, so an interned page is always shared and never written in place
+    static std::mutex mutex;
+    static std::unordered_map<std::uint64_t, std::shared_ptr<Page>> pages;
+    static std::size_t prune {64};
 
-    // writing the superchip font into memory
-    addr = bigFontAddr;
-    for (std::uint8_t byte : schipfont)
-        ram[addr++] = byte;
+    std::uint64_t h {hash(page)};
+    std::scoped_lock lock {mutex};
+    if (auto it {pages.find(h)}; it != pages.end() and *it->second == page)
+        return it->second;
 
-    std::ifstream file {path, std::ios::binary};
-    if (file.fail() or !file.is_open()) return false;
+    auto shared {std::make_shared<Page>(page)};
+    pages[h] = shared;
+    if (pages.size() >= prune) {
+        std::erase_if(pages, [](const auto& entry) { return entry.second.use_count() == 1; });
+        prune = std::max<std::size_t>(64, pages.size() * 2);
+    }
+    return shared;
+}
 
-    file.read(reinterpret_cast<char*>(&ram[0x200]), ram.size());
+bool Memory::load(std::string path) {
+    MappedFile file {path};
+    if (!file.isOpen()) return false;
+    return load(file.bytes());
+}
+
+bool Memory::load(std::span<const std::uint8_t> rom) {
+    if (rom.size() > megaRamSize - programAddr) return false;
+    if (rom.size() > size() - programAddr)
+        resize(rom.size() > xoRamSize - programAddr ? megaRamSize : xoRamSize);
+
+    // identical roms loaded by different instances end up sharing their pages
+    for (std::size_t p {programAddr / pageSize}; p != pages_.size(); ++p) {
+        std::size_t offset {p * pageSize - programAddr};
+        if (offset >= rom.size()) {
+            pages_[p] = zeros_();
+            continue;
+        }
+        Page page {};
+        std::copy_n(rom.begin() + offset, std::min(pageSize, rom.size() - offset), page.begin());
+        pages_[p] = intern_(page);
+    }
+    changed_.assign(pages_.size(), ++generation_);
+    romHash_ = hash(rom);
+    romSize_ = rom.size();
+    if (!written_.empty())
+        written_.assign(size(), false);
+    stateHash_ = fullStateHash();
     return true;
 }
+
+void Memory::resize(std::size_t size)
+{
+    pages_.resize(size / pageSize, zeros_());
+    mask_ = static_cast<std::uint32_t>(size - 1);
+    if (!written_.empty())
+        written_.resize(size);
+    changed_.assign(pages_.size(), ++generation_);
+    stateHash_ = fullStateHash();
+}
+
+std::uint64_t Memory::fullStateHash() const {
+    std::uint64_t h {0};
+    for (std::size_t p {0}; p != pages_.size(); ++p) {
+        if (pages_[p] == zeros_())
+            continue; // hashes to 0
+        for (std::size_t k {0}; k != pageSize; ++k)
+            h ^= zobrist::key(zobrist::ram, p * pageSize + k, (*pages_[p])[k]);
+    }
+    return h;
+}
+
+std::size_t Memory::privatePages() const {
+    return std::ranges::count_if(pages_, [](const auto& page) { return page.use_count() == 1; });
+}
+
+std::uint64_t Memory::hash(std::span<const std::uint8_t> bytes) {
+    // 64-bit FNV-1a
+    std::uint64_t h {0xCBF29CE484222325};
+    for (std::uint8_t byte : bytes) {
+        h ^= byte;
+        h *= 0x100000001B3;
+    }
+    return h;
+}
+
+void Memory::write(std::span<const std::uint8_t> bytes, std::uint32_t addr)
+{
+    addr &= mask_;
+    if (addr + bytes.size() > size() or !written_.empty()) {
+        for (std::size_t k {0}; k != bytes.size(); ++k)
+            write(bytes[k], static_cast<std::uint32_t>(addr + k));
+        return;
+    }
+
+    while (!bytes.empty()) {
+        std::shared_ptr<Page>& page {pages_[addr / pageSize]};
+        if (page.use_count() != 1)
+            page = std::make_shared<Page>(*page); // copy on write
+        std::size_t n {std::min(bytes.size(), pageSize - addr % pageSize)};
+        std::uint8_t* cell {page->data() + addr % pageSize};
+        changed_[addr / pageSize] = generation_ + 1;
+        for (std::size_t k {0}; k != n; ++k) {
+            stateHash_ ^= zobrist::key(zobrist::ram, addr + k, cell[k]) ^ zobrist::key(zobrist::ram, addr + k, bytes[k]);
+            cell[k] = bytes[k];
+        }
+        bytes = bytes.subspan(n);
+        addr += n;
+    }
+    ++generation_;
+}
+
+void Memory::read(std::uint32_t addr, std::span<std::uint8_t> bytes) const
+{
+    addr &= mask_;
+    if (addr + bytes.size() > size()) {
+        for (std::size_t k {0}; k != bytes.size(); ++k)
+            bytes[k] = read(static_cast<std::uint32_t>(addr + k));
+        return;
+    }
+
+    while (!bytes.empty()) {
+        std::size_t n {std::min(bytes.size(), pageSize - addr % pageSize)};
+        std::copy_n(pages_[addr / pageSize]->data() + addr % pageSize, n, bytes.data());
+        bytes = bytes.subspan(n);
+        addr += n;
+    }
+}
+
+void Memory::trackWrites(bool on)
+{
+    if (!on)
+        written_.clear();
+    else if (written_.empty())
+        written_.resize(size());
+}
+
+bool Memory::initialized(std::uint32_t addr) const
+{
+    addr &= mask_;
+    bool font {addr >= fontAddr and addr < bigFontAddr + sizeof(schipfont)};
+    bool rom {addr >= programAddr and addr < programAddr + romSize_};
+    return written_.empty() or font or rom or written_[addr];
+}
@@ -3,19 +3,78 @@
 
 #include <cstdint>
 #include <array>
+#include <memory>
+#include <span>
 #include <stack>
 #include <string>
+#include <vector>
+#include "../state/Zobrist.h"
 
+// Ram is split into reference-counted pages that copies of a Memory share until one of them writes
+// to a page. Pages with the same contents (the fonts, an untouched rom, zeros) are shared by every instance.
 class Memory {
 public:
+    static constexpr std::uint16_t programAddr {0x200};
+    static constexpr std::size_t ramSize {4096}; // CHIP-8 and SUPER-CHIP, the size until resize()
+    static constexpr std::size_t xoRamSize {0x10000}; // XO-CHIP
+    static constexpr std::size_t megaRamSize {0x1000000}; // MEGA-CHIP
+    static constexpr std::size_t pageSize {256};
+
+    Memory();
+    // Copies the rom to 0x200, fails if it can't be opened or doesn't fit in MEGA-CHIP's ram. Ram grows to
+    // xoRamSize or megaRamSize for a rom too large for the current size, since only those roms can be.
     bool load(std::string path);
-    void write(std::uint8_t byte, std::uint16_t addr) { ram.at(addr) = byte; };
-    [[nodiscard]] std::uint8_t read(std::uint16_t addr) const { return ram.at(addr); };
+    bool load(std::span<const std::uint8_t> rom);
+    // Grows or shrinks ram to a power of two of at least a page, keeping the contents that still fit.
+    void resize(std::size_t size);
+    [[nodiscard]] std::size_t size() const { return pages_.size() * pageSize; }
+    // Addresses wrap around at the end of ram, see Interpreter::setChecked() for reporting accesses past it.
+    void write(std::uint8_t byte, std::uint32_t addr) {
+        addr &= mask_;
+        std::shared_ptr<Page>& page {pages_[addr / pageSize]};
+        if (page.use_count() != 1)
+            page = std::make_shared<Page>(*page); // copy on write
+        std::uint8_t& cell {(*page)[addr % pageSize]};
+        stateHash_ ^= zobrist::key(zobrist::ram, addr, cell) ^ zobrist::key(zobrist::ram, addr, byte);
+        cell = byte;
+        changed_[addr / pageSize] = ++generation_;
+        if (!written_.empty()) [[unlikely]]
+            written_[addr] = true;
+    };
+    [[nodiscard]] std::uint8_t read(std::uint32_t addr) const {
+        addr &= mask_;
+        return (*pages_[addr / pageSize])[addr % pageSize];
+    };
+    // Block transfers, the same as writing or reading the bytes one at a time but with one copy on write per page.
+    void write(std::span<const std::uint8_t> bytes, std::uint32_t addr);
+    void read(std::uint32_t addr, std::span<std::uint8_t> bytes) const;
+    // Remembers which bytes have been written since the rom was loaded, for initialized(). Off by default.
+    void trackWrites(bool on);
+    // True for the fonts, the rom and bytes written since it was loaded. Always true unless writes are tracked.
+    [[nodiscard]] bool initialized(std::uint32_t addr) const;
     std::uint8_t getFont(std::uint8_t offset) { return fontAddr + (offset * bytesPerDigit); }
     std::uint8_t getBigFont(std::uint8_t offset) { return bigFontAddr + (offset * bytesPerBigDigit); }
+    // bumped on every write, lets translated code notice that it may have been modified
+    [[nodiscard]] std::uint64_t generation() const { return generation_; }
+    // the generation of the last write to the page holding addr
+    [[nodiscard]] std::uint64_t generation(std::uint32_t addr) const { return changed_[(addr & mask_) / pageSize]; }
+    // hash of the last rom image loaded, identifies it in caches and indexes
+    [[nodiscard]] std::uint64_t romHash() const { return romHash_; }
+    static std::uint64_t hash(std::span<const std::uint8_t> bytes);
+    // Zobrist hash of ram, kept up to date by every write
+    [[nodiscard]] std::uint64_t stateHash() const { return stateHash_; }
+    // the same hash recomputed from scratch, for verifying stateHash()
+    [[nodiscard]] std::uint64_t fullStateHash() const;
+    // number of pages this instance doesn't share with any other
+    [[nodiscard]] std::size_t privatePages() const;
 
     std::stack<std::uint16_t> stack;
 private:
+    using Page = std::array<std::uint8_t, pageSize>;
+    // returns the shared page with these contents, creating it if there is none
+    static std::shared_ptr<Page> intern_(const Page& page);
+    static const std::shared_ptr<Page>& zeros_();
+
     static constexpr std::uint16_t fontAddr {0x50};
     static constexpr std::uint8_t bytesPerDigit {5};
     static constexpr std::uint16_t bigFontAddr {fontAddr + 80};
@@ -57,7 +116,14 @@ private:
             0xFF, 0xFF, 0xC0, 0xC0, 0xFF, 0xFF, 0xC0, 0xC0, 0xC0, 0xC0  // F
     };
 
-    std::array<std::uint8_t, 4096> ram {};
+    std::vector<std::shared_ptr<Page>> pages_ {ramSize / pageSize};
+    std::uint32_t mask_ {ramSize - 1};
+    std::uint64_t generation_ {0};
+    std::vector<std::uint64_t> changed_ = std::vector<std::uint64_t>(ramSize / pageSize); // by page
+    std::uint64_t romHash_ {0};
+    std::uint64_t stateHash_ {0};
+    std::size_t romSize_ {0};
+    std::vector<bool> written_; // by address, empty unless writes are tracked
 };
 
 #endif //CHIP_8_MEMORY_H
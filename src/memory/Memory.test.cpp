@@ -25,8 +25,113 @@ TEST_F(MemoryTest, writeWorks)
     EXPECT_EQ(memory.read(0x203), 0xAA);
 }
 
-TEST_F(MemoryTest, outOfBoundsTesting)
+TEST_F(MemoryTest, addressesWrapAtEndOfRam)
 {
-    EXPECT_THROW(memory.read(-1), std::out_of_range);
-    EXPECT_THROW(memory.read(4096), std::out_of_range);
-}
\ No newline at end of file
+    memory.write(static_cast<std::uint8_t>(0xAA), static_cast<std::uint16_t>(0x1203));
+    EXPECT_EQ(memory.read(0x203), 0xAA);
+    EXPECT_EQ(memory.read(-1), memory.read(0xFFF));
+    EXPECT_EQ(memory.read(4096), memory.read(0));
+    EXPECT_EQ(memory.stateHash(), memory.fullStateHash());
+}
+
+TEST_F(MemoryTest, loadHashesRom)
+{
+    std::vector<std::uint8_t> rom {0x12, 0x00};
+    memory.load(rom);
+    EXPECT_EQ(memory.romHash(), Memory::hash(rom));
+    EXPECT_EQ(memory.read(0x200), 0x12);
+    EXPECT_EQ(memory.read(0x202), 0); // leftovers of the previous rom are cleared
+}
+
+TEST_F(MemoryTest, loadRejectsOversizedRom)
+{
+    std::vector<std::uint8_t> rom(Memory::megaRamSize - 0x200 + 1);
+    EXPECT_FALSE(memory.load(rom));
+    EXPECT_EQ(memory.read(0x200), 0xF);
+    EXPECT_EQ(memory.size(), Memory::ramSize);
+}
+
+TEST_F(MemoryTest, largeRomGrowsRam)
+{
+    std::vector<std::uint8_t> rom(4096 - 0x200 + 1, 0x12);
+    EXPECT_TRUE(memory.load(rom));
+    EXPECT_EQ(memory.size(), Memory::xoRamSize);
+    EXPECT_EQ(memory.read(0x1000), 0x12);
+    EXPECT_EQ(memory.read(0x1001), 0);
+}
+
+TEST_F(MemoryTest, megaChipRomGrowsRamFurther)
+{
+    std::vector<std::uint8_t> rom(Memory::xoRamSize - 0x200 + 1, 0x34);
+    EXPECT_TRUE(memory.load(rom));
+    EXPECT_EQ(memory.size(), Memory::megaRamSize);
+    EXPECT_EQ(memory.read(0x10000), 0x34);
+    EXPECT_EQ(memory.read(0x10001), 0);
+    EXPECT_EQ(memory.stateHash(), memory.fullStateHash());
+}
+
+TEST_F(MemoryTest, resizeKeepsContents)
+{
+    memory.write(static_cast<std::uint8_t>(0xAA), static_cast<std::uint16_t>(0x203));
+    memory.resize(Memory::xoRamSize);
+    EXPECT_EQ(memory.read(0x203), 0xAA);
+    memory.write(static_cast<std::uint8_t>(0xBB), static_cast<std::uint16_t>(0x1203));
+    EXPECT_EQ(memory.read(0x203), 0xAA); // no longer wraps at 4KB
+    EXPECT_EQ(memory.read(0x1203), 0xBB);
+    EXPECT_EQ(memory.stateHash(), memory.fullStateHash());
+
+    memory.resize(Memory::ramSize);
+    EXPECT_EQ(memory.read(0x1203), 0xAA);
+    EXPECT_EQ(memory.stateHash(), memory.fullStateHash());
+}
+
+TEST_F(MemoryTest, fontIsWrittenOnConstruction)
+{
+    EXPECT_EQ(memory.read(memory.getFont(0)), 0xF0);
+    EXPECT_EQ(memory.read(memory.getBigFont(1)), 0x18);
+}
+
+TEST_F(MemoryTest, blockTransfersCrossPages)
+{
+    std::vector<std::uint8_t> bytes {1, 2, 3, 4, 5, 6};
+    std::uint64_t before {memory.generation()};
+    memory.write(bytes, 0x2FD);
+    EXPECT_EQ(memory.read(0x2FF), 3);
+    EXPECT_EQ(memory.read(0x300), 4);
+    EXPECT_EQ(memory.stateHash(), memory.fullStateHash());
+    EXPECT_NE(memory.generation(), before);
+    EXPECT_EQ(memory.generation(0x2FD), memory.generation());
+    EXPECT_EQ(memory.generation(0x300), memory.generation());
+    EXPECT_LE(memory.generation(0x400), before);
+
+    std::vector<std::uint8_t> back(6);
+    memory.read(0x2FD, back);
+    EXPECT_EQ(back, bytes);
+}
+
+TEST_F(MemoryTest, blockTransfersWrapAtEndOfRam)
+{
+    std::vector<std::uint8_t> bytes {1, 2, 3};
+    memory.write(bytes, 0xFFE);
+    EXPECT_EQ(memory.read(0xFFF), 2);
+    EXPECT_EQ(memory.read(0), 3);
+    EXPECT_EQ(memory.stateHash(), memory.fullStateHash());
+    std::vector<std::uint8_t> back(3);
+    memory.read(0xFFE, back);
+    EXPECT_EQ(back, bytes);
+}
+
+TEST_F(MemoryTest, trackedWritesInitializeMemory)
+{
+    EXPECT_TRUE(memory.initialized(0x300)); // everything counts as initialized unless writes are tracked
+    memory.trackWrites(true);
+    std::vector<std::uint8_t> rom {0x12, 0x00};
+    memory.load(rom);
+    EXPECT_TRUE(memory.initialized(memory.getFont(0)));
+    EXPECT_TRUE(memory.initialized(0x201));
+    EXPECT_FALSE(memory.initialized(0x202));
+    memory.write(static_cast<std::uint8_t>(0), static_cast<std::uint16_t>(0x202));
+    EXPECT_TRUE(memory.initialized(0x202));
+    memory.load(rom);
+    EXPECT_FALSE(memory.initialized(0x202));
+}
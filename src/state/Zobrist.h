@@ -0,0 +1,27 @@
+#ifndef CHIP_8_ZOBRIST_H
+#define CHIP_8_ZOBRIST_H
+
+#include <cstdint>
+
+// Zobrist-style keys for the incremental state hash. Instead of a table of random numbers per
+// (location, value) the key is computed by mixing them, which keeps the tables out of the cache.
+namespace zobrist {
+    enum Domain : std::uint64_t { ram = 1, pixel, reg, stack, keys };
+
+    // splitmix64 finalizer
+    constexpr std::uint64_t mix(std::uint64_t z)
+    {
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EB;
+        return z ^ (z >> 31);
+    }
+
+    // zero values contribute nothing, so all-zero state hashes to 0
+    constexpr std::uint64_t key(Domain domain, std::uint32_t location, std::uint32_t value)
+    {
+        return value == 0 ? 0 : mix(domain << 56 | static_cast<std::uint64_t>(location) << 24 | value);
+    }
+}
+
+
+#endif //CHIP_8_ZOBRIST_H
@@ -0,0 +1,124 @@
+#include "Telemetry.h"
+#include <algorithm>
+#include <cmath>
+#include <format>
+#include <fstream>
+
+namespace {
+    std::uint32_t micros(Telemetry::clock::duration d)
+    {
+        auto us {std::chrono::duration_cast<std::chrono::microseconds>(d).count()};
+        return static_cast<std::uint32_t>(std::clamp<long long>(us, 0, 0xFFFFFFFF));
+    }
+
+    // nearest rank
+    std::uint32_t percentileOf(std::vector<std::uint32_t> values, double p)
+    {
+        if (values.empty())
+            return 0;
+        auto rank {static_cast<std::size_t>(std::ceil(p * static_cast<double>(values.size())))};
+        auto nth {values.begin() + static_cast<std::ptrdiff_t>(std::clamp<std::size_t>(rank, 1, values.size()) - 1)};
+        std::ranges::nth_element(values, nth);
+        return *nth;
+    }
+}
+
+void Telemetry::beginFrame(clock::time_point now)
+{
+    if (!enabled)
+        return;
+    current_ = {};
+    start_ = now;
+    last_ = now;
+    presented_ = false;
+}
+
+void Telemetry::mark(Phase phase, clock::time_point now)
+{
+    if (!enabled)
+        return;
+    current_.phases[phase] += micros(now - last_);
+    last_ = now;
+}
+
+void Telemetry::input(clock::time_point when)
+{
+    if (enabled and !pendingInput_)
+        pendingInput_ = when;
+}
+
+void Telemetry::presented(clock::time_point now)
+{
+    if (!enabled)
+        return;
+    presented_ = true;
+    if (pendingInput_) {
+        current_.latency = static_cast<std::int32_t>(std::min<std::uint32_t>(micros(now - *pendingInput_), 0x7FFFFFFF));
+        pendingInput_.reset();
+    }
+}
+
+void Telemetry::endFrame(clock::time_point now)
+{
+    if (!enabled)
+        return;
+    current_.total = micros(now - start_);
+    if (late_(current_))
+        ++missed_;
+    frames_.push_back(current_);
+}
+
+std::chrono::microseconds Telemetry::percentile(int phase, double p) const
+{
+    std::vector<std::uint32_t> values(frames_.size());
+    std::ranges::transform(frames_, values.begin(), [phase](const Frame& frame) {
+        return phase == phaseCount ? frame.total : frame.phases[phase];
+    });
+    return std::chrono::microseconds {percentileOf(std::move(values), p)};
+}
+
+std::optional<std::chrono::microseconds> Telemetry::latencyPercentile(double p) const
+{
+    std::vector<std::uint32_t> values;
+    for (const Frame& frame : frames_) {
+        if (frame.latency >= 0)
+            values.push_back(static_cast<std::uint32_t>(frame.latency));
+    }
+    if (values.empty())
+        return std::nullopt;
+    return std::chrono::microseconds {percentileOf(std::move(values), p)};
+}
+
+std::string Telemetry::summary() const
+{
+    std::string out {std::format("{:d} frames, {:d} missed the deadline\n", frames_.size(), missed_)};
+    auto line {[&out](std::string_view name, std::chrono::microseconds p50, std::chrono::microseconds p95, std::chrono::microseconds p99) {
+        out += std::format("{:>10s}  p50 {:>7d}us  p95 {:>7d}us  p99 {:>7d}us\n", name, p50.count(), p95.count(), p99.count());
+    }};
+    for (int phase {0}; phase != phaseCount; ++phase)
+        line(phaseNames[phase], percentile(phase, 0.5), percentile(phase, 0.95), percentile(phase, 0.99));
+    line("frame", percentile(phaseCount, 0.5), percentile(phaseCount, 0.95), percentile(phaseCount, 0.99));
+    if (latencyPercentile(0.5))
+        line("latency", *latencyPercentile(0.5), *latencyPercentile(0.95), *latencyPercentile(0.99));
+    return out;
+}
+
+bool Telemetry::writeCsv(const std::filesystem::path& file) const
+{
+    std::ofstream out {file};
+    out << "frame";
+    for (const char* name : phaseNames)
+        out << ',' << name << "_us";
+    out << ",total_us,missed,latency_us\n";
+    for (std::size_t f {0}; f != frames_.size(); ++f) {
+        const Frame& frame {frames_[f]};
+        out << f;
+        for (std::uint32_t us : frame.phases)
+            out << ',' << us;
+        out << ',' << frame.total << ',' << late_(frame) << ',';
+        if (frame.latency >= 0)
+            out << frame.latency;
+        out << '\n';
+    }
+    return static_cast<bool>(out);
+}
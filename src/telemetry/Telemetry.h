@@ -0,0 +1,71 @@
+#ifndef CHIP_8_TELEMETRY_H
+#define CHIP_8_TELEMETRY_H
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <vector>
+
+// Times every frame of the main loop on the host, split into the phases below, and the latency from a key
+// going down to the first frame presented after it. Each call takes the time it happens at so that tests can
+// supply their own. Does nothing until enabled.
+class Telemetry {
+public:
+    using clock = std::chrono::steady_clock;
+
+    enum Phase : std::uint8_t {
+        events, // polling SDL events
+        emulation, // running the interpreter
+        upload, // locking the texture, converting the framebuffer and unlocking it again
+        present,
+        sleep,
+        phaseCount,
+    };
+    static constexpr const char* phaseNames[phaseCount] {"events", "emulation", "upload", "present", "sleep"};
+
+    // in microseconds
+    struct Frame {
+        std::array<std::uint32_t, phaseCount> phases {};
+        std::uint32_t total {0}; // from the start of the frame to the start of the next
+        std::int32_t latency {-1}; // of a key that went down before the frame presented, if any did
+    };
+
+    bool enabled {false};
+    std::chrono::microseconds budget {16'667}; // a frame that takes more than a quarter longer missed its deadline
+
+    void beginFrame(clock::time_point now = clock::now());
+    // the time since the last call to any of these goes to phase
+    void mark(Phase phase, clock::time_point now = clock::now());
+    // A key went down at when. Only the first key before a present is timed.
+    void input(clock::time_point when);
+    // the frame is on screen
+    void presented(clock::time_point now = clock::now());
+    void endFrame(clock::time_point now = clock::now());
+
+    [[nodiscard]] const std::vector<Frame>& frames() const { return frames_; }
+    [[nodiscard]] bool presentedThisFrame() const { return presented_; }
+    [[nodiscard]] unsigned long long missed() const { return missed_; }
+    // The time a fraction p of all frames took at most in phase, or as a whole for phaseCount.
+    [[nodiscard]] std::chrono::microseconds percentile(int phase, double p) const;
+    // the same for input latency, nullopt before any key was timed
+    [[nodiscard]] std::optional<std::chrono::microseconds> latencyPercentile(double p) const;
+    // p50, p95 and p99 of everything, one line each
+    [[nodiscard]] std::string summary() const;
+    bool writeCsv(const std::filesystem::path& file) const;
+private:
+    [[nodiscard]] bool late_(const Frame& frame) const { return frame.total > budget.count() + budget.count() / 4; }
+
+    std::vector<Frame> frames_;
+    Frame current_ {};
+    clock::time_point start_ {};
+    clock::time_point last_ {};
+    std::optional<clock::time_point> pendingInput_;
+    bool presented_ {false};
+    unsigned long long missed_ {0};
+};
+
+
+#endif //CHIP_8_TELEMETRY_H
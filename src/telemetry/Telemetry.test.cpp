@@ -0,0 +1,90 @@
+#include <gtest/gtest.h>
+#include <filesystem>
+#include <fstream>
+#include "Telemetry.h"
+
+using namespace std::chrono_literals;
+
+class TelemetryTest : public testing::Test {
+protected:
+    TelemetryTest() {
+        telemetry.enabled = true;
+    }
+
+    // a frame of the given phase lengths, starting where the last one ended
+    void frame(std::chrono::microseconds events, std::chrono::microseconds emulation, std::chrono::microseconds sleep) {
+        telemetry.beginFrame(now);
+        telemetry.mark(Telemetry::events, now += events);
+        telemetry.mark(Telemetry::emulation, now += emulation);
+        telemetry.mark(Telemetry::sleep, now += sleep);
+        telemetry.mark(Telemetry::upload, now += 100us);
+        telemetry.mark(Telemetry::present, now += 200us);
+        telemetry.presented(now);
+        telemetry.endFrame(now);
+    }
+
+    Telemetry telemetry;
+    Telemetry::clock::time_point now {};
+};
+
+TEST_F(TelemetryTest, percentilesAreNearestRank)
+{
+    for (int f {1}; f <= 100; ++f)
+        frame(10us, std::chrono::microseconds {f}, 16'000us);
+
+    ASSERT_EQ(telemetry.frames().size(), 100);
+    EXPECT_EQ(telemetry.percentile(Telemetry::emulation, 0.5), 50us);
+    EXPECT_EQ(telemetry.percentile(Telemetry::emulation, 0.95), 95us);
+    EXPECT_EQ(telemetry.percentile(Telemetry::emulation, 0.99), 99us);
+    EXPECT_EQ(telemetry.percentile(Telemetry::events, 0.99), 10us);
+    EXPECT_EQ(telemetry.percentile(Telemetry::phaseCount, 0.5), 16'360us);
+    EXPECT_EQ(telemetry.missed(), 0);
+    EXPECT_FALSE(telemetry.latencyPercentile(0.5));
+}
+
+TEST_F(TelemetryTest, slowFramesMissTheDeadline)
+{
+    frame(10us, 100us, 16'000us);
+    frame(10us, 8'000us, 16'000us);
+
+    EXPECT_EQ(telemetry.missed(), 1);
+}
+
+TEST_F(TelemetryTest, latencyRunsToTheNextPresent)
+{
+    frame(10us, 100us, 16'000us);
+    telemetry.input(now - 3ms);
+    frame(10us, 100us, 16'000us);
+    frame(10us, 100us, 16'000us);
+
+    // 3ms before the frame started, and the frame presented 16.41ms into it
+    EXPECT_EQ(telemetry.frames()[1].latency, 3'000 + 16'410);
+    EXPECT_EQ(telemetry.frames()[2].latency, -1);
+    EXPECT_EQ(telemetry.latencyPercentile(0.99), 19'410us);
+}
+
+TEST_F(TelemetryTest, csvHasARowPerFrame)
+{
+    frame(10us, 100us, 16'000us);
+    frame(10us, 8'000us, 16'000us);
+    std::filesystem::path file {std::filesystem::temp_directory_path() / "schip8-telemetry-test.csv"};
+    ASSERT_TRUE(telemetry.writeCsv(file));
+
+    std::ifstream in {file};
+    std::string header, first, second;
+    std::getline(in, header);
+    std::getline(in, first);
+    std::getline(in, second);
+    std::filesystem::remove(file);
+    EXPECT_EQ(header, "frame,events_us,emulation_us,upload_us,present_us,sleep_us,total_us,missed,latency_us");
+    EXPECT_EQ(first, "0,10,100,100,200,16000,16410,0,");
+    EXPECT_EQ(second, "1,10,8000,100,200,16000,24310,1,");
+}
+
+TEST_F(TelemetryTest, disabledRecordsNothing)
+{
+    telemetry.enabled = false;
+    frame(10us, 100us, 16'000us);
+
+    EXPECT_TRUE(telemetry.frames().empty());
+}
@@ -0,0 +1,123 @@
+#include "Terminal.h"
+#include <format>
+#include <iterator>
+#include "../display/Display.h"
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace {
+    // by Terminal::Cell::quadrants
+    constexpr const char* glyphs[16] {
+        " ", "▘", "▝", "▀", "▖", "▌", "▞", "▛",
+        "▗", "▚", "▐", "▜", "▄", "▙", "▟", "█",
+    };
+    constexpr std::uint32_t unknown {0xFFFFFFFF}; // no 24 bit color, so the next one is always sent
+}
+
+Terminal::Terminal(std::FILE* out)
+    : out_{out}
+{
+}
+
+Terminal::~Terminal()
+{
+    buffer_.clear();
+    std::format_to(std::back_inserter(buffer_), "\x1b[0m\x1b[{:d};1H\x1b[?25h", rows_ + 1);
+    write_();
+}
+
+std::size_t Terminal::draw(const Display& display)
+{
+    int columns {(display.width + 1) / 2};
+    int rows {(display.height + 1) / 2};
+    bool resized {columns != columns_ or rows != rows_};
+    if (!resized and display.stateHash() == hash_)
+        return 0;
+    hash_ = display.stateHash();
+
+    buffer_.clear();
+    if (resized) {
+        // hides the cursor and starts over on a blank screen
+        columns_ = columns;
+        rows_ = rows;
+        cells_.assign(columns_ * rows_, {unknown, unknown, 0});
+        fg_ = unknown;
+        bg_ = unknown;
+        buffer_ += "\x1b[0m\x1b[2J\x1b[?25l";
+    }
+
+    auto out {std::back_inserter(buffer_)};
+    std::uint32_t background {display.colorOf(0) >> 8};
+    int cursorX {-1};
+    int cursorY {-1};
+    for (int row {0}; row != rows_; ++row) {
+        for (int column {0}; column != columns_; ++column) {
+            // the colors of the pixels without alpha, a screen of odd size is padded with its background
+            std::uint32_t pixels[4];
+            for (int q {0}; q != 4; ++q) {
+                int x {2 * column + (q & 1)};
+                int y {2 * row + (q >> 1)};
+                pixels[q] = x < display.width and y < display.height ? display.color(x, y) >> 8 : background;
+            }
+
+            Cell cell {.fg = pixels[0], .bg = pixels[0]};
+            for (std::uint32_t pixel : pixels) {
+                if (pixel == background)
+                    cell.bg = background;
+            }
+            for (int q {0}; q != 4; ++q) {
+                if (pixels[q] != cell.bg) {
+                    cell.fg = cell.quadrants == 0 ? pixels[q] : cell.fg;
+                    cell.quadrants |= 1 << q;
+                }
+            }
+            if (cell.quadrants == 0)
+                cell.fg = cell.bg; // only the background shows
+
+            Cell& shown {cells_[column + row * columns_]};
+            if (cell == shown)
+                continue;
+            shown = cell;
+
+            if (row != cursorY)
+                std::format_to(out, "\x1b[{:d};{:d}H", row + 1, column + 1);
+            else if (column != cursorX)
+                std::format_to(out, "\x1b[{:d}C", column - cursorX);
+            if (cell.bg != bg_) {
+                bg_ = cell.bg;
+                std::format_to(out, "\x1b[48;2;{:d};{:d};{:d}m", bg_ >> 16, bg_ >> 8 & 0xFF, bg_ & 0xFF);
+            }
+            if (cell.quadrants != 0 and cell.fg != fg_) {
+                fg_ = cell.fg;
+                std::format_to(out, "\x1b[38;2;{:d};{:d};{:d}m", fg_ >> 16, fg_ >> 8 & 0xFF, fg_ & 0xFF);
+            }
+            buffer_ += glyphs[cell.quadrants];
+            cursorX = column + 1;
+            cursorY = row;
+        }
+    }
+
+    write_();
+    return buffer_.size();
+}
+
+void Terminal::write_()
+{
+    // whatever stdio still buffers goes first, then the frame in one system call unless the terminal takes less
+    std::fflush(out_);
+    std::size_t written {0};
+    while (written != buffer_.size()) {
+#ifdef _WIN32
+        int n {_write(_fileno(out_), buffer_.data() + written, static_cast<unsigned>(buffer_.size() - written))};
+#else
+        auto n {::write(fileno(out_), buffer_.data() + written, buffer_.size() - written)};
+#endif
+        if (n <= 0)
+            return;
+        written += n;
+    }
+}
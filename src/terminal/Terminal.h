@@ -0,0 +1,50 @@
+#ifndef CHIP_8_TERMINAL_H
+#define CHIP_8_TERMINAL_H
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+class Display;
+
+// Draws a Display on an ANSI terminal in 24 bit color, without SDL. Every character cell shows 2x2 pixels as one of
+// the Unicode quadrant blocks, so a 128x64 screen takes 64x32 cells. After the first frame only the cells that
+// changed are sent, each behind a cursor movement when it doesn't follow the one before, and the whole frame goes
+// out in a single write.
+class Terminal {
+public:
+    explicit Terminal(std::FILE* out);
+    // moves the cursor below the picture and restores it and the colors
+    ~Terminal();
+    Terminal(const Terminal&) = delete;
+    Terminal& operator=(const Terminal&) = delete;
+
+    // Sends the changes since the last call and returns how many bytes that took, 0 when nothing changed.
+    std::size_t draw(const Display& display);
+private:
+    // A cell holds at most two colors. Pixels of the screen's background color are drawn in bg and all others
+    // in fg, so the few cells of an XO-CHIP or MEGA-CHIP screen with more colors show only one of them.
+    struct Cell {
+        std::uint32_t fg {0};
+        std::uint32_t bg {0};
+        std::uint8_t quadrants {0}; // fg pixels, bit 0 top left, 1 top right, 2 bottom left, 3 bottom right
+
+        bool operator==(const Cell&) const = default;
+    };
+
+    void write_();
+
+    std::FILE* out_;
+    int columns_ {0};
+    int rows_ {0};
+    std::vector<Cell> cells_; // as the terminal shows them
+    std::uint64_t hash_ {0}; // of the screen last drawn
+    // colors the terminal is set to, only valid once the first frame set them
+    std::uint32_t fg_ {0};
+    std::uint32_t bg_ {0};
+    std::string buffer_;
+};
+
+
+#endif //CHIP_8_TERMINAL_H
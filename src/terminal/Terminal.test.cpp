@@ -0,0 +1,74 @@
+#include <gtest/gtest.h>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include "Terminal.h"
+#include "../display/Display.h"
+
+class TerminalTest : public testing::Test {
+protected:
+    ~TerminalTest() override {
+        std::fclose(file);
+        std::filesystem::remove(path);
+    }
+
+    // everything written since the last call
+    std::string written() {
+        std::ifstream in {path, std::ios::binary};
+        std::string all {std::istreambuf_iterator<char> {in}, std::istreambuf_iterator<char> {}};
+        std::string since {all.substr(read)};
+        read = all.size();
+        return since;
+    }
+
+    std::filesystem::path path {std::filesystem::temp_directory_path() / "schip8-terminal-test"};
+    std::FILE* file {std::fopen(path.string().c_str(), "wb")};
+    std::size_t read {0};
+    Display display {};
+};
+
+TEST_F(TerminalTest, firstFrameDrawsEveryCell)
+{
+    Terminal terminal {file};
+    display.flipPixel(0, 0);
+    display.flipPixel(1, 1);
+
+    std::size_t bytes {terminal.draw(display)};
+    std::string frame {written()};
+    EXPECT_EQ(frame.size(), bytes);
+    // 32x16 cells, the first one lit on its diagonal
+    EXPECT_TRUE(frame.starts_with("\x1b[0m\x1b[2J"));
+    EXPECT_NE(frame.find("\x1b[1;1H"), std::string::npos);
+    EXPECT_NE(frame.find("\x1b[38;2;156;94;204m▚"), std::string::npos);
+    EXPECT_NE(frame.find("\x1b[16;1H"), std::string::npos);
+}
+
+TEST_F(TerminalTest, laterFramesOnlySendChanges)
+{
+    Terminal terminal {file};
+    terminal.draw(display);
+    written();
+
+    EXPECT_EQ(terminal.draw(display), 0);
+    display.flipPixel(11, 4);
+    terminal.draw(display);
+    // only cell (5, 2) changes, to its top right quadrant
+    EXPECT_EQ(written(), "\x1b[3;6H\x1b[38;2;156;94;204m▝");
+
+    display.flipPixel(11, 4);
+    terminal.draw(display);
+    EXPECT_EQ(written(), "\x1b[3;6H ");
+}
+
+TEST_F(TerminalTest, hiresSwitchRedraws)
+{
+    Terminal terminal {file};
+    terminal.draw(display);
+    display.setResolution(2);
+    terminal.draw(display);
+
+    std::string frame {written()};
+    EXPECT_NE(frame.find("\x1b[2J"), std::string::npos);
+    EXPECT_NE(frame.find("\x1b[32;1H"), std::string::npos);
+    EXPECT_EQ(frame.find("\x1b[33;1H"), std::string::npos);
+}
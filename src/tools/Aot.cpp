@@ -0,0 +1,159 @@
+#include <algorithm>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string_view>
+#include <vector>
+#include "../analysis/Disassembler.h"
+#include "../aot/Fusion.h"
+
+namespace {
+    // Fx33, Fx55 and 5xy2 store to memory and could rewrite the instructions after them
+    bool writesMemory(std::uint16_t op)
+    {
+        return (op & 0xF0FF) == 0xF033 or (op & 0xF0FF) == 0xF055 or (op & 0xF00F) == 0x5002;
+    }
+}
+
+std::string translate(const std::vector<std::uint8_t>& rom, const Disassembler& disassembler, const std::string& title,
+                      const std::string& mode)
+{
+    std::vector<std::vector<FusedOp>> fused;
+    for (const auto& [start, block] : disassembler.blocks())
+        fused.push_back(fuse(disassembler, block));
+
+    std::string out {std::format("// Generated by schip8-aot from '{:s}', do not edit.\n", title)};
+    out += "#include \"aot/AotRuntime.h\"\n\nnamespace {\nconstexpr std::uint8_t rom[] {";
+    for (std::size_t i {0}; i != rom.size(); ++i)
+        out += std::format("{:s}0x{:0>2X},", i % 16 == 0 ? "\n        " : " ", rom[i]);
+    out += "\n};\n\nconstexpr AotBlock blocks[] {\n";
+    std::size_t index {0};
+    for (const auto& [start, block] : disassembler.blocks()) {
+        // a fused jump after the block has to be checked along with it
+        bool jump {!fused[index].empty() and fused[index].back().kind == FusedOp::skipJump};
+        out += std::format("        {{0x{:0>3X}, {{rom + 0x{:0>3X}, {:d}}}}},\n",
+                           start, start - Disassembler::origin, block.end - block.start + (jump ? 2 : 0));
+        ++index;
+    }
+    out += "};\n\nint dispatch(AotRuntime& runtime, Interpreter& interpreter)\n{\n    switch (interpreter.pc) {\n";
+
+    index = 0;
+    for (const auto& [start, block] : disassembler.blocks()) {
+        out += std::format("        case 0x{:0>3X}:\n            if (!runtime.unmodified({:d})) return 0;\n", start, index);
+        int count {0};
+        for (const FusedOp& f : fused[index]) {
+            auto hex {[&] {
+                std::string ops;
+                for (std::uint16_t op : f.ops)
+                    ops += std::format("{:s}0x{:0>4X}", ops.empty() ? "" : ", ", op);
+                return ops;
+            }};
+            auto comment {[&] {
+                std::string mnemonics;
+                for (std::uint16_t op : f.ops)
+                    mnemonics += std::format("{:s}{:s}", mnemonics.empty() ? "" : "; ", Disassembler::mnemonic(op));
+                return mnemonics;
+            }};
+
+            switch (f.kind) {
+                case FusedOp::single:
+                    out += std::format("            interpreter.execute({:s}); // {:s}\n", hex(), comment());
+                    break;
+                case FusedOp::loadDraw:
+                    out += std::format("            interpreter.executeLoadDraw({:s}); // {:s}\n", hex(), comment());
+                    break;
+                case FusedOp::bcdLoad:
+                    out += std::format("            interpreter.executeBcdLoad({:s}); // {:s}\n", hex(), comment());
+                    break;
+                case FusedOp::loads:
+                    out += std::format("            {{ static constexpr std::uint16_t ops[] {{{:s}}}; interpreter.executeLoads(ops); }} // {:s}\n",
+                                       hex(), comment());
+                    break;
+                case FusedOp::skipJump:
+                    // the jump only counts when the skip isn't taken
+                    out += std::format("            return {:d} + interpreter.executeSkipJump({:s}); // {:s}\n", count, hex(), comment());
+                    break;
+            }
+            if (f.kind == FusedOp::skipJump)
+                break;
+            count += static_cast<int>(f.ops.size());
+
+            // Fx0A rewinds pc until a key is released, so the rest of the block must not run yet
+            std::uint16_t last {static_cast<std::uint16_t>(f.addr + 2 * f.ops.size())};
+            if ((f.ops.back() & 0xF0FF) == 0xF00A and last != block.end)
+                out += std::format("            if (interpreter.waiting) return {:d};\n", count);
+            // and with the display_wait quirk nothing runs after a sprite until the end of the frame
+            if ((f.ops.back() & 0xF000) == 0xD000 and last != block.end)
+                out += std::format("            if (interpreter.vblank) return {:d};\n", count);
+            // the rest of a block that was just written to runs in the interpreter
+            if (std::ranges::any_of(f.ops, writesMemory) and last != block.end)
+                out += std::format("            if (!runtime.unmodified({:d})) return {:d};\n", index, count);
+        }
+        if (fused[index].empty() or fused[index].back().kind != FusedOp::skipJump)
+            out += std::format("            return {:d};\n", count);
+        ++index;
+    }
+    out += "        default: return 0;\n    }\n}\n}\n\n";
+    out += std::format("const AotProgram aotProgram {{\"{:s}\", \"{:s}\", rom, blocks, dispatch}};\n", title, mode);
+    return out;
+}
+
+// schip8-aot <path/to/rom> [-o <file.cpp>] [-title <name>] [-platform <chip8|superchip|xochip|megachip>]
+int main(int argc, char** argv)
+{
+    std::string romPath, outPath, title, platform;
+
+    using namespace std::string_view_literals;
+    for (int i {1}; i < argc; ++i) {
+        bool hasNext {i + 1 != argc};
+        if (argv[i] == "-o"sv and hasNext) {
+            outPath = argv[++i];
+        } else if (argv[i] == "-title"sv and hasNext) {
+            title = argv[++i];
+        } else if (argv[i] == "-platform"sv and hasNext) {
+            platform = argv[++i];
+        } else if (romPath.empty() and argv[i][0] != '-') {
+            romPath = argv[i];
+        } else {
+            std::cerr << std::format("error: unrecognized command line argument '{:s}'.\n", argv[i]);
+        }
+    }
+
+    if (romPath.empty()) {
+        std::cerr << "usage: schip8-aot <path/to/rom> [-o <file.cpp>] [-title <name>] [-platform <chip8|superchip|xochip|megachip>]\n";
+        return 1;
+    }
+
+    std::ifstream file {romPath, std::ios::binary};
+    if (!file.is_open()) {
+        std::cerr << std::format("error: failed to open rom '{:s}'.\n", romPath);
+        return 1;
+    }
+    std::vector<std::uint8_t> rom {std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>()};
+    if (title.empty())
+        title = std::filesystem::path(romPath).stem().string();
+    std::erase_if(title, [](char c) { return c == '"' or c == '\\'; });
+
+    // block boundaries depend on the platform, so the translation only holds in the interpreter mode it is made for
+    if (platform.empty())
+        platform = Disassembler {rom}.platform();
+    if (platform != "chip8" and platform != "superchip" and platform != "xochip" and platform != "megachip") {
+        std::cerr << std::format("error: unknown platform '{:s}'.\n", platform);
+        return 1;
+    }
+    std::string mode {platform == "chip8" ? "default" : platform};
+    Disassembler disassembler {rom, platform};
+    if (outPath.empty()) {
+        std::cout << translate(rom, disassembler, title, mode);
+    } else {
+        std::ofstream out {outPath};
+        out << translate(rom, disassembler, title, mode);
+        if (!out) {
+            std::cerr << std::format("error: failed to write '{:s}'.\n", outPath);
+            return 1;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,91 @@
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <format>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "../machine/Machine.h"
+
+namespace {
+    constexpr std::string_view usage {"usage: schip8-bench <path/to/rom or dir>... [-frames <n>] [-cycles_per_frame <n>] [-quirk <quirk=value>]...\n"};
+}
+
+// Runs roms headless with no keys pressed and reports how many instructions per second the interpreter executes.
+int main(int argc, char** argv)
+{
+    std::vector<std::filesystem::path> roms;
+    std::vector<std::string> quirks;
+    int frames {20'000};
+    int cyclesPerFrame {20};
+
+    using namespace std::string_view_literals;
+    for (int i {1}; i < argc; ++i) {
+        bool hasNext {i + 1 != argc};
+        if ((argv[i] == "-frames"sv or argv[i] == "-cycles_per_frame"sv) and hasNext) {
+            int& n {argv[i] == "-frames"sv ? frames : cyclesPerFrame};
+            try {
+                n = std::stoi(argv[i + 1]);
+            } catch (std::exception& e) {
+                std::cerr << std::format("error: failed to read integer for '{:s}' option, using default={:d}.\n", argv[i], n);
+            }
+            ++i;
+        } else if (argv[i] == "-quirk"sv and hasNext) {
+            quirks.emplace_back(argv[++i]);
+        } else if (argv[i][0] != '-' and std::filesystem::is_directory(argv[i])) {
+            for (const auto& entry : std::filesystem::recursive_directory_iterator(argv[i])) {
+                if (entry.is_regular_file())
+                    roms.push_back(entry.path());
+            }
+        } else if (argv[i][0] != '-') {
+            roms.emplace_back(argv[i]);
+        } else {
+            std::cerr << std::format("error: unrecognized command line argument '{:s}'.\n", argv[i]);
+        }
+    }
+
+    if (roms.empty()) {
+        std::cerr << usage;
+        return 1;
+    }
+    std::ranges::sort(roms);
+
+    double total {0};
+    unsigned long long instructions {0};
+    for (const std::filesystem::path& path : roms) {
+        Machine machine;
+        machine.interpreter.setLogging(false);
+        // waiting for the display would end most frames a few instructions in, which leaves little to measure
+        machine.interpreter.setQuirk("display_wait=false");
+        for (const std::string& quirk : quirks)
+            machine.interpreter.setQuirk(quirk);
+        if (!machine.memory.load(path.string())) {
+            std::cerr << std::format("error: failed to load rom '{:s}', it may be missing or too large.\n", path.string());
+            continue;
+        }
+
+        // a rom waiting for a key ends its frames early, so count what actually ran
+        unsigned long long executed {0};
+        auto start {std::chrono::steady_clock::now()};
+        for (int f {0}; f != frames; ++f) {
+            for (int left {cyclesPerFrame}; left > 0;) {
+                Interpreter::Run run {machine.interpreter.run(left)};
+                left -= run.cost;
+                executed += run.cycles;
+                if (run.stop == Interpreter::Stop::keyWait or run.stop == Interpreter::Stop::vblank)
+                    break;
+            }
+            machine.interpreter.endOfFrame();
+        }
+        double seconds {std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count()};
+
+        total += seconds;
+        instructions += executed;
+        std::cout << std::format("{:8.1f} MIPS {:10d} instructions  {:s}\n", executed / seconds / 1e6, executed,
+                                 path.filename().string());
+    }
+    if (roms.size() > 1)
+        std::cout << std::format("{:8.1f} MIPS {:10d} instructions  total\n", instructions / total / 1e6, instructions);
+    return 0;
+}
@@ -0,0 +1,114 @@
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <format>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "../conformance/Conformance.h"
+#include "../index/RomIndex.h"
+
+namespace {
+    constexpr std::string_view usage {"usage: schip8-conform <path/to/rom or dir>... -golden <golden.tsv> [-movies <dir>] [-update] "
+                                      "[-frames <n>] [-every <n>] [-cycles_per_frame <n>] [-threads <n>] [-shadow <n>]\n"};
+}
+
+// Runs every rom in every mode and compares the screen hashes at each checkpoint with the golden file, or with
+// -update rewrites the golden file. -shadow also checks the interpreter against its reference, see Shadow. Exits with
+// 1 when anything differs.
+int main(int argc, char** argv)
+{
+    Conformance conformance;
+    std::vector<std::filesystem::path> roms;
+    std::filesystem::path golden;
+    std::filesystem::path movies;
+    bool update {false};
+
+    using namespace std::string_view_literals;
+    for (int i {1}; i < argc; ++i) {
+        bool hasNext {i + 1 != argc};
+        if ((argv[i] == "-frames"sv or argv[i] == "-every"sv or argv[i] == "-cycles_per_frame"sv) and hasNext) {
+            int& n {argv[i] == "-frames"sv ? conformance.frames : argv[i] == "-every"sv ? conformance.every : conformance.cyclesPerFrame};
+            try {
+                n = std::max(std::stoi(argv[i + 1]), 1);
+            } catch (std::exception& e) {
+                std::cerr << std::format("error: failed to read integer for '{:s}' option, using default={:d}.\n", argv[i], n);
+            }
+            ++i;
+        } else if (argv[i] == "-shadow"sv and hasNext) {
+            try {
+                conformance.shadow = std::max(std::stoi(argv[++i]), 0);
+            } catch (std::exception& e) {
+                std::cerr << "error: failed to read integer for '-shadow' option, not shadowing.\n";
+            }
+        } else if (argv[i] == "-threads"sv and hasNext) {
+            try {
+                conformance.threads = std::stoul(argv[++i]);
+            } catch (std::exception& e) {
+                std::cerr << "error: failed to read integer for '-threads' option, using all cores.\n";
+            }
+        } else if (argv[i] == "-golden"sv and hasNext) {
+            golden = argv[++i];
+        } else if (argv[i] == "-movies"sv and hasNext) {
+            movies = argv[++i];
+        } else if (argv[i] == "-update"sv) {
+            update = true;
+        } else if (argv[i][0] != '-' and std::filesystem::is_directory(argv[i])) {
+            for (const auto& entry : std::filesystem::recursive_directory_iterator(argv[i])) {
+                if (RomIndex::isRom(entry))
+                    roms.push_back(entry.path());
+            }
+        } else if (argv[i][0] != '-') {
+            roms.emplace_back(argv[i]);
+        } else {
+            std::cerr << std::format("error: unrecognized command line argument '{:s}'.\n", argv[i]);
+        }
+    }
+
+    if (roms.empty() or golden.empty()) {
+        std::cerr << usage;
+        return 1;
+    }
+    if (movies.empty())
+        movies = golden.parent_path() / "movies";
+    std::ranges::sort(roms);
+
+    auto start {std::chrono::steady_clock::now()};
+    std::vector<std::string> divergences;
+    std::vector<Conformance::Checkpoint> actual {conformance.runAll(roms, movies, &divergences)};
+    auto elapsed {std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start)};
+    std::size_t cases {roms.size() * std::size(Conformance::modes)};
+
+    for (const std::string& divergence : divergences)
+        std::cout << divergence;
+
+    if (update) {
+        if (!divergences.empty()) {
+            std::cerr << std::format("error: {:d} cases diverged from the reference interpreter, not recording them.\n", divergences.size());
+            return 1;
+        }
+        if (!Conformance::save(golden, actual)) {
+            std::cerr << std::format("error: failed to write '{:s}'.\n", golden.string());
+            return 1;
+        }
+        std::cout << std::format("recorded {:d} checkpoints of {:d} cases in {:d}ms to '{:s}'\n", actual.size(), cases,
+                                 elapsed.count(), golden.string());
+        return 0;
+    }
+
+    std::vector<Conformance::Checkpoint> expected {Conformance::load(golden)};
+    if (expected.empty()) {
+        std::cerr << std::format("error: no golden hashes in '{:s}', record them with -update.\n", golden.string());
+        return 1;
+    }
+    std::vector<std::string> failures {Conformance::compare(expected, actual)};
+    for (const std::string& failure : failures)
+        std::cout << failure << '\n';
+    std::cout << std::format("{:d} cases, {:d} checkpoints in {:d}ms, {:d} failed", cases, actual.size(), elapsed.count(),
+                             failures.size());
+    if (conformance.shadow != 0)
+        std::cout << std::format(", {:d} diverged", divergences.size());
+    std::cout << '\n';
+    return failures.empty() and divergences.empty() ? 0 : 1;
+}
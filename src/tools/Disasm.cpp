@@ -0,0 +1,77 @@
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string_view>
+#include <vector>
+#include "../analysis/Disassembler.h"
+#include "../cache/AnalysisCache.h"
+#include "../memory/Memory.h"
+
+// schip8-disasm <path/to/rom> [-o <file.8o>] [-dot <file.dot>] [-platform <name>] [-cache [dir]] [-stats]
+int main(int argc, char** argv)
+{
+    std::string romPath, octoPath, dotPath, platform;
+    std::filesystem::path cacheDir;
+    bool stats {false};
+
+    using namespace std::string_view_literals;
+    for (int i {1}; i < argc; ++i) {
+        bool hasNext {i + 1 != argc};
+        if (argv[i] == "-o"sv and hasNext) {
+            octoPath = argv[++i];
+        } else if (argv[i] == "-dot"sv and hasNext) {
+            dotPath = argv[++i];
+        } else if (argv[i] == "-platform"sv and hasNext) {
+            platform = argv[++i];
+        } else if (argv[i] == "-cache"sv) {
+            cacheDir = hasNext and argv[i + 1][0] != '-' ? argv[++i] : AnalysisCache::defaultDirectory();
+        } else if (argv[i] == "-stats"sv) {
+            stats = true;
+        } else if (romPath.empty() and argv[i][0] != '-') {
+            romPath = argv[i];
+        } else {
+            std::cerr << std::format("error: unrecognized command line argument '{:s}'.\n", argv[i]);
+        }
+    }
+
+    if (romPath.empty()) {
+        std::cerr << "usage: schip8-disasm <path/to/rom> [-o <file.8o>] [-dot <file.dot>] [-platform <name>] [-cache [dir]] [-stats]\n";
+        return 1;
+    }
+
+    std::ifstream file {romPath, std::ios::binary};
+    if (!file.is_open()) {
+        std::cerr << std::format("error: failed to open rom '{:s}'.\n", romPath);
+        return 1;
+    }
+    std::vector<std::uint8_t> rom {std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>()};
+
+    auto start {std::chrono::steady_clock::now()};
+    AnalysisCache cache {cacheDir};
+    // the cache only holds analyses of the detected platform
+    Disassembler disassembler {cacheDir.empty() or !platform.empty() ? Disassembler {rom, platform} : cache.analyse(rom, Memory::hash(rom))};
+    auto elapsed {std::chrono::steady_clock::now() - start};
+
+    if (octoPath.empty()) {
+        std::cout << disassembler.octo();
+    } else {
+        std::ofstream {octoPath} << disassembler.octo();
+    }
+    if (!dotPath.empty())
+        std::ofstream {dotPath} << disassembler.dot();
+
+    if (stats) {
+        std::size_t code {0};
+        for (std::uint16_t addr {Disassembler::origin}; addr != Disassembler::origin + disassembler.size(); ++addr)
+            code += disassembler.isCode(addr) ? 2 : 0;
+        std::cerr << std::format("{:d} bytes, {:d} code, {:d} blocks, analysed in {:d}us{:s}\n",
+                                 disassembler.size(), std::min(code, disassembler.size()), disassembler.blocks().size(),
+                                 std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count(),
+                                 cache.hits != 0 ? " (cached)" : "");
+    }
+    return 0;
+}
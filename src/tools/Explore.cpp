@@ -0,0 +1,143 @@
+#include <cctype>
+#include <chrono>
+#include <format>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "../explore/Explorer.h"
+#include "../machine/Machine.h"
+
+namespace {
+    constexpr std::string_view usage {
+            "usage: schip8-explore <path/to/rom> [--mode <mode>] [-quirk <quirk=value>]... [-cycles_per_frame <n>]\n"
+            "                      [-frames <n>] [-warmup <n>] [-depth <n>] [-states <n>] [-threads <n>] [-best] [-keys <0-f...>]\n"
+            "                      [-until_pc <addr>] [-until_ram <addr=value>] [-until_pattern <file>] [-until_fault] [-o <file>]\n"};
+}
+
+// Searches for key presses that take a rom to a goal and prints them, one "<frames> <key mask>" line per step.
+int main(int argc, char** argv)
+{
+    std::string romPath, mode, outPath;
+    std::vector<std::string> quirks;
+    int warmup {0};
+    Explorer explorer;
+    Explorer::Goal goal;
+
+    // accepts decimal, 0x hex and 0 octal like the C library
+    auto number {[](const char* option, const std::string& text, unsigned long fallback) {
+        try {
+            return std::stoul(text, nullptr, 0);
+        } catch (std::exception& e) {
+            std::cerr << std::format("error: failed to read integer for '{:s}' option, using default={:d}.\n", option, fallback);
+            return fallback;
+        }
+    }};
+
+    using namespace std::string_view_literals;
+    for (int i {1}; i < argc; ++i) {
+        bool hasNext {i + 1 != argc};
+        if (argv[i] == "--mode"sv and hasNext) {
+            mode = argv[++i];
+        } else if (argv[i] == "-quirk"sv and hasNext) {
+            quirks.emplace_back(argv[++i]);
+        } else if (argv[i] == "-cycles_per_frame"sv and hasNext) {
+            explorer.cyclesPerFrame = static_cast<int>(number(argv[i], argv[i + 1], explorer.cyclesPerFrame));
+            ++i;
+        } else if (argv[i] == "-frames"sv and hasNext) {
+            explorer.framesPerStep = static_cast<int>(number(argv[i], argv[i + 1], explorer.framesPerStep));
+            ++i;
+        } else if (argv[i] == "-warmup"sv and hasNext) {
+            warmup = static_cast<int>(number(argv[i], argv[i + 1], warmup));
+            ++i;
+        } else if (argv[i] == "-depth"sv and hasNext) {
+            explorer.maxDepth = static_cast<int>(number(argv[i], argv[i + 1], explorer.maxDepth));
+            ++i;
+        } else if (argv[i] == "-states"sv and hasNext) {
+            explorer.maxStates = number(argv[i], argv[i + 1], explorer.maxStates);
+            ++i;
+        } else if (argv[i] == "-threads"sv and hasNext) {
+            explorer.threads = number(argv[i], argv[i + 1], explorer.threads);
+            ++i;
+        } else if (argv[i] == "-best"sv) {
+            explorer.strategy = Explorer::Strategy::bestFirst;
+        } else if (argv[i] == "-keys"sv and hasNext) {
+            // no keys plus each listed key on its own
+            explorer.inputs = {0};
+            for (char c : std::string_view {argv[++i]}) {
+                int key {std::isxdigit(static_cast<unsigned char>(c)) ? std::stoi(std::string {c}, nullptr, 16) : -1};
+                if (key < 0)
+                    std::cerr << std::format("error: '{:c}' is not a key, use 0-9 and a-f.\n", c);
+                else
+                    explorer.inputs.push_back(1 << key);
+            }
+        } else if (argv[i] == "-until_pc"sv and hasNext) {
+            goal.pc = static_cast<std::uint16_t>(number(argv[i], argv[i + 1], 0));
+            ++i;
+        } else if (argv[i] == "-until_ram"sv and hasNext) {
+            std::string condition {argv[++i]};
+            std::size_t eq {condition.find('=')};
+            unsigned long addr {number("-until_ram", condition.substr(0, eq), Memory::xoRamSize)};
+            if (eq == std::string::npos or addr >= Memory::xoRamSize)
+                std::cerr << std::format("error: '-until_ram {:s}' needs an address in ram and a value, like 0x3f0=7.\n", condition);
+            else
+                goal.ram = {{static_cast<std::uint16_t>(addr), static_cast<std::uint8_t>(number("-until_ram", condition.substr(eq + 1), 0))}};
+        } else if (argv[i] == "-until_pattern"sv and hasNext) {
+            std::ifstream file {argv[++i]};
+            if (!file.is_open())
+                std::cerr << std::format("error: failed to open pattern '{:s}'.\n", argv[i]);
+            for (std::string row; std::getline(file, row);) {
+                if (!row.empty())
+                    goal.pattern.push_back(row);
+            }
+        } else if (argv[i] == "-until_fault"sv) {
+            goal.fault = true;
+        } else if (argv[i] == "-o"sv and hasNext) {
+            outPath = argv[++i];
+        } else if (romPath.empty() and argv[i][0] != '-') {
+            romPath = argv[i];
+        } else {
+            std::cerr << std::format("error: unrecognized command line argument '{:s}'.\n", argv[i]);
+        }
+    }
+
+    if (romPath.empty()) {
+        std::cerr << usage;
+        return 1;
+    }
+
+    Machine machine;
+    machine.interpreter.setLogging(false);
+    if (!machine.memory.load(romPath)) {
+        std::cerr << std::format("error: failed to load rom '{:s}', it may be missing or too large.\n", romPath);
+        return 1;
+    }
+    for (const std::string& quirk : quirks) {
+        if (!machine.interpreter.setQuirk(quirk))
+            std::cerr << std::format("error: failed to read interpreter '-quirk {:s}' option.\n", quirk);
+    }
+    if (!mode.empty() and !machine.interpreter.setMode(mode))
+        std::cerr << "error: failed to read interpreter '-mode' option, using default=chip8.\n";
+    for (int f {0}; f != warmup; ++f)
+        machine.frame(explorer.cyclesPerFrame);
+
+    auto start {std::chrono::steady_clock::now()};
+    Explorer::Result result {explorer.explore(machine, goal)};
+    auto elapsed {std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start)};
+
+    std::cerr << std::format("{:s} after {:d} states, depth {:d}, {:d} addresses executed, {:d}ms\n",
+                             result.found ? result.reason : "no goal reached", result.states, result.depth,
+                             result.coverage, elapsed.count());
+    if (!result.found)
+        return 2;
+
+    std::string inputs;
+    for (std::uint16_t keys : result.inputs)
+        inputs += std::format("{:d} {:04x}\n", explorer.framesPerStep, keys);
+    if (outPath.empty())
+        std::cout << inputs;
+    else
+        std::ofstream {outPath} << inputs;
+    return 0;
+}
@@ -0,0 +1,84 @@
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "../gen/RomGenerator.h"
+
+namespace {
+    constexpr std::string_view usage {"usage: schip8-gen [-workload <alu|branch|draw|scroll|memory|selfmod|mixed>] [-mix <kind=weight,...>] "
+                                      "[-seed <n>] [-instructions <n>] [-sprite <rows>] [-o <file>]\n"};
+}
+
+// Writes a rom with a chosen mix of instructions for schip8-bench and the batch tools, see RomGenerator.
+int main(int argc, char** argv)
+{
+    RomGenerator generator;
+    std::string workload {"mixed"};
+    std::filesystem::path out;
+
+    using namespace std::string_view_literals;
+    for (int i {1}; i < argc; ++i) {
+        bool hasNext {i + 1 != argc};
+        if (argv[i] == "-workload"sv and hasNext) {
+            workload = argv[++i];
+            std::optional<RomGenerator::Mix> mix {RomGenerator::workload(workload)};
+            if (!mix) {
+                std::cerr << std::format("error: unknown workload '{:s}'.\n{:s}", workload, usage);
+                return 1;
+            }
+            generator.mix = *mix;
+        } else if (argv[i] == "-mix"sv and hasNext) {
+            std::optional<RomGenerator::Mix> mix {RomGenerator::parseMix(argv[++i])};
+            if (!mix) {
+                std::cerr << std::format("error: failed to read '-mix {:s}', expected kind=weight pairs like alu=3,draw=1.\n", argv[i]);
+                return 1;
+            }
+            generator.mix = *mix;
+            workload = "custom";
+        } else if (argv[i] == "-seed"sv and hasNext) {
+            try {
+                generator.seed = std::stoull(argv[++i]);
+            } catch (std::exception& e) {
+                std::cerr << std::format("error: failed to read integer for '-seed' option, using default={:d}.\n", generator.seed);
+            }
+        } else if ((argv[i] == "-instructions"sv or argv[i] == "-sprite"sv) and hasNext) {
+            int& n {argv[i] == "-instructions"sv ? generator.instructions : generator.spriteHeight};
+            try {
+                n = std::stoi(argv[i + 1]);
+            } catch (std::exception& e) {
+                std::cerr << std::format("error: failed to read integer for '{:s}' option, using default={:d}.\n", argv[i], n);
+            }
+            ++i;
+        } else if (argv[i] == "-o"sv and hasNext) {
+            out = argv[++i];
+        } else {
+            std::cerr << std::format("error: unrecognized command line argument '{:s}'.\n{:s}", argv[i], usage);
+            return 1;
+        }
+    }
+
+    if (generator.instructions < 1 or generator.instructions > RomGenerator::maxInstructions) {
+        std::cerr << std::format("error: '-instructions' must be between 1 and {:d}.\n", RomGenerator::maxInstructions);
+        return 1;
+    }
+    if (generator.spriteHeight < 0 or generator.spriteHeight > 15) {
+        std::cerr << "error: '-sprite' must be between 0 (16x16) and 15.\n";
+        return 1;
+    }
+    if (out.empty())
+        out = std::format("{:s}-{:d}.{:s}", workload, generator.seed, generator.superchip() ? "sc8" : "ch8");
+
+    std::vector<std::uint8_t> rom {generator.generate()};
+    std::ofstream file {out, std::ios::binary};
+    file.write(reinterpret_cast<const char*>(rom.data()), static_cast<std::streamsize>(rom.size()));
+    if (!file) {
+        std::cerr << std::format("error: failed to write '{:s}'.\n", out.string());
+        return 1;
+    }
+    std::cout << std::format("wrote {:d} bytes to '{:s}'{:s}\n", rom.size(), out.string(),
+                             generator.superchip() ? ", run it with --mode superchip" : "");
+    return 0;
+}
@@ -0,0 +1,48 @@
+#include <chrono>
+#include <format>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include "../index/RomIndex.h"
+
+// schip8-index <path/to/rom/dir> [-o <index.tsv>] [-threads <n>]
+int main(int argc, char** argv)
+{
+    std::filesystem::path dir, out {RomIndex::defaultPath()};
+    unsigned threads {0};
+
+    using namespace std::string_view_literals;
+    for (int i {1}; i < argc; ++i) {
+        bool hasNext {i + 1 != argc};
+        if (argv[i] == "-o"sv and hasNext) {
+            out = argv[++i];
+        } else if (argv[i] == "-threads"sv and hasNext) {
+            try {
+                threads = std::stoul(argv[++i]);
+            } catch (std::exception& e) {
+                std::cerr << "error: failed to read integer for '-threads' option, using all cores.\n";
+            }
+        } else if (dir.empty() and argv[i][0] != '-') {
+            dir = argv[i];
+        } else {
+            std::cerr << std::format("error: unrecognized command line argument '{:s}'.\n", argv[i]);
+        }
+    }
+
+    if (dir.empty()) {
+        std::cerr << "usage: schip8-index <path/to/rom/dir> [-o <index.tsv>] [-threads <n>]\n";
+        return 1;
+    }
+
+    auto start {std::chrono::steady_clock::now()};
+    RomIndex index {RomIndex::build(dir, threads)};
+    auto elapsed {std::chrono::steady_clock::now() - start};
+
+    if (!index.save(out)) {
+        std::cerr << std::format("error: failed to write '{:s}'.\n", out.string());
+        return 1;
+    }
+    std::cout << std::format("indexed {:d} roms in {:d}ms, written to '{:s}'\n", index.entries().size(),
+                             std::chrono::duration_cast<std::chrono::milliseconds>(elapsed).count(), out.string());
+    return 0;
+}
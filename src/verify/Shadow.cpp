@@ -0,0 +1,184 @@
+#include "Shadow.h"
+#include <algorithm>
+#include <deque>
+#include <experimental/random>
+#include <format>
+#include <stack>
+#include <utility>
+#include "../analysis/Disassembler.h"
+
+namespace {
+    std::string stackString(std::stack<std::uint16_t> stack)
+    {
+        std::string out;
+        for (; !stack.empty(); stack.pop())
+            out = std::format(" {:#x}", stack.top()) + out;
+        return out.empty() ? "empty" : out.substr(1);
+    }
+
+    // what differs between the machines, fast first
+    std::vector<std::string> differences(const Machine& fast, const Machine& reference)
+    {
+        std::vector<std::string> out;
+        auto differ {[&out](const std::string& name, unsigned long a, unsigned long b) {
+            if (a != b)
+                out.push_back(std::format("{:s} {:#x}, reference {:#x}", name, a, b));
+        }};
+        const Interpreter& f {fast.interpreter};
+        const Interpreter& r {reference.interpreter};
+        differ("pc", f.pc, r.pc);
+        differ("i", f.i, r.i);
+        for (int x {0}; x != 16; ++x)
+            differ(std::format("v{:X}", x), f.v[x], r.v[x]);
+        differ("dt", f.dt, r.dt);
+        differ("st", f.st, r.st);
+        differ("waiting", f.waiting, r.waiting);
+        if (fast.memory.stack != reference.memory.stack)
+            out.push_back(std::format("stack {:s}, reference {:s}", stackString(fast.memory.stack), stackString(reference.memory.stack)));
+
+        if (fast.memory.stateHash() != reference.memory.stateHash()) {
+            differ("ram size", fast.memory.size(), reference.memory.size());
+            std::size_t first {0};
+            std::size_t count {0};
+            for (std::size_t addr {0}; addr != std::min(fast.memory.size(), reference.memory.size()); ++addr) {
+                if (fast.memory.read(addr) != reference.memory.read(addr) and count++ == 0)
+                    first = addr;
+            }
+            if (count != 0) {
+                out.push_back(std::format("ram[{:#x}] {:#x}, reference {:#x}{:s}", first, fast.memory.read(first),
+                                          reference.memory.read(first), count > 1 ? std::format(" and {:d} more bytes", count - 1) : ""));
+            }
+        }
+        if (fast.display.stateHash() != reference.display.stateHash())
+            out.push_back(std::format("screen hash {:016x}, reference {:016x}", fast.display.stateHash(), reference.display.stateHash()));
+        if (out.empty()) // flag registers or audio
+            out.push_back(std::format("state hash {:016x}, reference {:016x}", f.stateHash(), r.stateHash()));
+        return out;
+    }
+}
+
+std::string Shadow::Divergence::report() const
+{
+    std::string out;
+    if (!exact)
+        out = std::format("diverged after instruction {:d}, but not again when run one step at a time\n", instruction);
+    else if (count == 0)
+        out = std::format("diverged in the end of frame work after instruction {:d}\n", instruction);
+    else if (count == 1)
+        out = std::format("diverged at instruction {:d}\n", instruction);
+    else
+        out = std::format("diverged in a step of {:d} instructions from instruction {:d}\n", count, instruction);
+    for (const std::string& difference : differences)
+        out += std::format("  {:s}\n", difference);
+    for (std::size_t t {0}; t != trace.size(); ++t) {
+        // the instructions of the step that differs are marked
+        bool step {t + count >= trace.size()};
+        out += std::format("{:s} {:04x}: {:04x}  {:s}\n", step ? ">" : " ", trace[t].pc, trace[t].opcode,
+                           Disassembler::mnemonic(trace[t].opcode));
+    }
+    return out;
+}
+
+Shadow::Shadow(Machine& machine, Fast fast, int stride)
+    : machine_{machine}, fast_{std::move(fast)}, stride_{std::max(stride, 1)}
+{
+    machine_.keyboard.setHostKeys(false);
+    reference_ = machine_.fork();
+    agreed_ = machine_.fork();
+}
+
+int Shadow::runFast_(Machine& machine, int cycles)
+{
+    int n {0};
+    while (n < cycles) {
+        n += std::max(fast_(machine, cycles - n), 1);
+        if (machine.interpreter.waiting or machine.interpreter.vblank)
+            break; // the rest of the frame would only poll the keyboard again, or waits for the display
+    }
+    return n;
+}
+
+bool Shadow::frame(int cycles, std::uint64_t seed)
+{
+    if (divergence_)
+        return false;
+
+    machine_.keyboard.setMask(keys_);
+    reference_->keyboard.setMask(keys_);
+    std::experimental::reseed(seed);
+    int n {runFast_(machine_, cycles)};
+    std::experimental::reseed(seed);
+    for (int k {0}; k != n; ++k)
+        reference_->step();
+    machine_.interpreter.endOfFrame();
+    reference_->interpreter.endOfFrame();
+
+    frames_.push_back({cycles, seed, keys_});
+    instructions_ += n;
+    sinceCheck_ += n;
+    if (sinceCheck_ >= static_cast<unsigned long long>(stride_))
+        check_();
+    return !divergence_;
+}
+
+void Shadow::check_()
+{
+    ++checks_;
+    sinceCheck_ = 0;
+    if (machine_.interpreter.stateHash() == reference_->interpreter.stateHash()) {
+        agreed_ = machine_.fork();
+        agreedAt_ = instructions_;
+        frames_.clear();
+        return;
+    }
+
+    divergence_ = locate_();
+    if (!divergence_) // the fast way only goes wrong when it runs more than a step at a time
+        divergence_ = Divergence {agreedAt_, 0, false, differences(machine_, *reference_), {}};
+}
+
+std::optional<Shadow::Divergence> Shadow::locate_() const
+{
+    std::unique_ptr<Machine> fast {agreed_->fork()};
+    std::unique_ptr<Machine> reference {agreed_->fork()};
+    std::deque<Traced> trace;
+    unsigned long long at {agreedAt_};
+    auto diverged {[&](const Machine& state, int count) {
+        return Divergence {at, count, true, differences(state, *reference), {trace.begin(), trace.end()}};
+    }};
+
+    for (const Frame& frame : frames_) {
+        fast->keyboard.setMask(frame.keys);
+        reference->keyboard.setMask(frame.keys);
+
+        // the fast way first, as the reference would draw other random numbers in between
+        std::vector<std::pair<int, std::unique_ptr<Machine>>> steps;
+        std::experimental::reseed(frame.seed);
+        auto waits {[&fast] { return fast->interpreter.waiting or fast->interpreter.vblank; }};
+        for (int n {0}; n < frame.cycles and (steps.empty() or !waits());) {
+            int count {std::max(fast_(*fast, 1), 1)};
+            n += count;
+            steps.emplace_back(count, fast->fork());
+        }
+
+        std::experimental::reseed(frame.seed);
+        for (const auto& [count, state] : steps) {
+            for (int k {0}; k != count; ++k) {
+                std::uint16_t pc {reference->interpreter.pc};
+                trace.push_back({pc, static_cast<std::uint16_t>(reference->memory.read(pc) << 8 | reference->memory.read(pc + 1))});
+                if (trace.size() > traceLength)
+                    trace.pop_front();
+                reference->step();
+            }
+            if (state->interpreter.stateHash() != reference->interpreter.stateHash())
+                return diverged(*state, count);
+            at += count;
+        }
+
+        fast->interpreter.endOfFrame();
+        reference->interpreter.endOfFrame();
+        if (fast->interpreter.stateHash() != reference->interpreter.stateHash())
+            return diverged(*fast, 0);
+    }
+    return std::nullopt;
+}
@@ -0,0 +1,88 @@
+#ifndef CHIP_8_SHADOW_H
+#define CHIP_8_SHADOW_H
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+#include "../machine/Machine.h"
+
+// Runs a fast way of executing instructions, such as Interpreter::run() or translated code, in lockstep with a
+// reference machine that executes the same instructions one at a time with Interpreter::cycle(). The two are
+// compared by their state hashes every stride instructions, which costs a hash and a fork of the machine, so it
+// is cheap enough to leave on for whole corpus runs. Once they differ, the frames since they last agreed are run
+// again one step at a time to find the first step that differs.
+class Shadow {
+public:
+    // Runs up to budget instructions of machine the fast way and returns how many it ran, at least one. It may run
+    // more than budget when it can't stop sooner, like a translated block, and stops early on a key wait or vblank.
+    using Fast = std::function<int(Machine&, int budget)>;
+
+    struct Traced {
+        std::uint16_t pc;
+        std::uint16_t opcode;
+    };
+
+    struct Divergence {
+        unsigned long long instruction {0}; // instructions both ran before the step that differs
+        // instructions in that step, more than one when the fast way can't run fewer, 0 for the end of frame work
+        int count {0};
+        // False when running the same frames again one step at a time didn't differ, then instruction is the last
+        // check they agreed at and the trace is empty.
+        bool exact {false};
+        std::vector<std::string> differences; // the fast way's value first, the reference's second
+        std::vector<Traced> trace; // the reference's last instructions up to the ones of the step, oldest first
+
+        [[nodiscard]] std::string report() const;
+    };
+
+    static constexpr std::size_t traceLength {32};
+
+    // Machine must outlive the shadow and the reference starts as a fork of it. Both only see the keys setKeys()
+    // holds from now on, so that frames can be run again.
+    Shadow(Machine& machine, Fast fast, int stride = 1000);
+
+    // the fast way Machine::frame() runs
+    static int interpreted(Machine& machine, int budget) { return machine.interpreter.run(budget).cycles; }
+
+    // Keys held on both machines from the next frame on, see Keyboard::setMask().
+    void setKeys(std::uint16_t mask) { keys_ = mask; }
+    // Runs up to cycles instructions on both machines with Cxnn seeded from seed, see std::experimental::reseed(),
+    // and the end of frame work, like Machine::frame(). Checks are made at the end of a frame once stride
+    // instructions ran since the last one. Does nothing and returns false once the machines diverged.
+    bool frame(int cycles, std::uint64_t seed);
+
+    [[nodiscard]] const std::optional<Divergence>& divergence() const { return divergence_; }
+    [[nodiscard]] const Machine& reference() const { return *reference_; }
+    [[nodiscard]] unsigned long long instructions() const { return instructions_; }
+    [[nodiscard]] unsigned long long checks() const { return checks_; }
+private:
+    struct Frame {
+        int cycles;
+        std::uint64_t seed;
+        std::uint16_t keys;
+    };
+
+    int runFast_(Machine& machine, int cycles);
+    void check_();
+    // runs the frames since the last check again, comparing after every step
+    [[nodiscard]] std::optional<Divergence> locate_() const;
+
+    Machine& machine_;
+    Fast fast_;
+    int stride_;
+    std::unique_ptr<Machine> reference_;
+    std::unique_ptr<Machine> agreed_; // the state both had at the last check
+    unsigned long long agreedAt_ {0};
+    std::vector<Frame> frames_; // run since the last check
+    std::uint16_t keys_ {0};
+    unsigned long long instructions_ {0};
+    unsigned long long sinceCheck_ {0};
+    unsigned long long checks_ {0};
+    std::optional<Divergence> divergence_;
+};
+
+
+#endif //CHIP_8_SHADOW_H
@@ -0,0 +1,95 @@
+#include <gtest/gtest.h>
+#include "Shadow.h"
+
+class ShadowTest : public testing::Test {
+protected:
+    ShadowTest() {
+        machine.interpreter.setLogging(false);
+        machine.interpreter.setQuirk("display_wait=false"); // so that frames run all 20 instructions
+        machine.memory.load(rom);
+    }
+
+    // 200: v1 := random 0xFF, 202: v0 += 1, 204: v1 += v0, 206: i := 210, 208: sprite v0 v1 4, 20A: jump 200
+    std::vector<std::uint8_t> rom {0xC1, 0xFF, 0x70, 0x01, 0x81, 0x04, 0xA2, 0x10, 0xD0, 0x14, 0x12, 0x00,
+                                   0x00, 0x00, 0x00, 0x00, 0xF0, 0x90, 0x90, 0xF0};
+    Machine machine;
+};
+
+TEST_F(ShadowTest, interpreterAgreesWithItself)
+{
+    Shadow shadow {machine, Shadow::interpreted, 1};
+    for (int f {0}; f != 300; ++f) {
+        shadow.setKeys(f % 7 == 0 ? 1 << (f % 16) : 0);
+        ASSERT_TRUE(shadow.frame(20, f));
+    }
+
+    EXPECT_EQ(shadow.checks(), 300);
+    EXPECT_EQ(shadow.instructions(), 6000);
+    EXPECT_EQ(shadow.reference().interpreter.stateHash(), machine.interpreter.stateHash());
+}
+
+TEST_F(ShadowTest, superinstructionsAgreeWithTheReference)
+{
+    // what translated code runs for an i := followed by a sprite
+    auto fused {[](Machine& m, int budget) {
+        std::uint16_t pc {m.interpreter.pc};
+        std::uint16_t annn {static_cast<std::uint16_t>(m.memory.read(pc) << 8 | m.memory.read(pc + 1))};
+        std::uint16_t dxyn {static_cast<std::uint16_t>(m.memory.read(pc + 2) << 8 | m.memory.read(pc + 3))};
+        if (annn >> 12 == 0xA and dxyn >> 12 == 0xD)
+            return m.interpreter.executeLoadDraw(annn, dxyn);
+        return m.interpreter.run(1).cycles;
+    }};
+    Shadow shadow {machine, fused, 100};
+    for (int f {0}; f != 300; ++f)
+        ASSERT_TRUE(shadow.frame(20, f)) << shadow.divergence()->report();
+}
+
+TEST_F(ShadowTest, findsTheFirstInstructionThatDiffers)
+{
+    // adds 2 for 7001 once v0 is 50
+    auto wrong {[](Machine& m, int budget) {
+        int n {0};
+        for (; n != budget and !m.interpreter.waiting; ++n) {
+            std::uint16_t pc {m.interpreter.pc};
+            if (m.memory.read(pc) == 0x70 and m.memory.read(pc + 1) == 0x01 and m.interpreter.v[0] == 50)
+                m.interpreter.execute(0x7002);
+            else
+                m.interpreter.cycle();
+        }
+        return n;
+    }};
+    Shadow shadow {machine, wrong, 100};
+    int f {0};
+    while (shadow.frame(20, f))
+        ++f;
+
+    const Shadow::Divergence& divergence {*shadow.divergence()};
+    EXPECT_EQ(f, 19); // checked at 400 instructions
+    EXPECT_TRUE(divergence.exact);
+    EXPECT_EQ(divergence.instruction, 50 * 6 + 1);
+    EXPECT_EQ(divergence.count, 1);
+    EXPECT_EQ(divergence.differences.front(), "v0 0x34, reference 0x33");
+    ASSERT_FALSE(divergence.trace.empty());
+    EXPECT_EQ(divergence.trace.back().pc, 0x202);
+    EXPECT_EQ(divergence.trace.back().opcode, 0x7001);
+    EXPECT_NE(divergence.report().find("> 0202: 7001"), std::string::npos);
+    EXPECT_FALSE(shadow.frame(20, f));
+}
+
+TEST_F(ShadowTest, reportsDivergencesThatOnlyLongRunsShow)
+{
+    auto wrong {[](Machine& m, int budget) {
+        int n {m.interpreter.run(budget).cycles};
+        if (budget > 1 and m.interpreter.v[0] >= 50)
+            m.memory.write(1, 0x300);
+        return n;
+    }};
+    Shadow shadow {machine, wrong, 100};
+    for (int f {0}; shadow.frame(20, f); ++f) {}
+
+    const Shadow::Divergence& divergence {*shadow.divergence()};
+    EXPECT_FALSE(divergence.exact);
+    EXPECT_EQ(divergence.instruction, 200); // v0 is 50 by the end of the check at 300
+    EXPECT_TRUE(divergence.trace.empty());
+    EXPECT_EQ(divergence.differences.front(), "ram[0x300] 0x1, reference 0x0");
+}